@@ -33,6 +33,7 @@
 #include "ExampleActionsECS.h"
 #include "ActionFactory.h"
 #include "ActionSequence.h"
+#include "SceneCache.h"
 #include "HardwareComponent.h"
 
 #include <EventGui.h>
@@ -214,9 +215,18 @@ ExampleActionsECS::ExampleActionsECS(int argc, char** argv) :
   unittest = false;
   withRobot = false;
   singleThreaded = false;
+  parallelHardware = false;
+  virtualTime = false;
+  revalidationPeriod = 0.0;
+  overlapTime = 0.0;
+  renderRate = 0.0;
+  perceptionRate = 0.0;
+  nextActionStarted = false;
 
   dtProcess = 0.0;
   dtEvents = 0.0;
+  stepProfileId = entity.getProfiler()->addSubscriber("Loop", "step");
+  eventsProfileId = entity.getProfiler()->addSubscriber("Loop", "events");
   failCount = 0;
 
   updateGraph = NULL;
@@ -226,10 +236,17 @@ ExampleActionsECS::ExampleActionsECS(int argc, char** argv) :
   setTaskCommand = NULL;
   setJointCommand = NULL;
   setRenderCommand = NULL;
+  setTextLine = NULL;
 }
 
 ExampleActionsECS::~ExampleActionsECS()
 {
+  if (!profileFile.empty())
+  {
+    entity.getProfiler()->print();
+    entity.getProfiler()->writeChromeTrace(profileFile);
+  }
+
   for (size_t i = 0; i < hwc.size(); ++i)
   {
     delete hwc[i];
@@ -280,7 +297,26 @@ bool ExampleActionsECS::parseArgs(Rcs::CmdLineParser* parser)
   parser->getArgument("-valgrind", &valgrind, "Valgrind mode without graphics and Gui");
   parser->getArgument("-unittest", &unittest, "Run unit tests");
   parser->getArgument("-singleThreaded", &singleThreaded, "Run predictions sequentially");
+  parser->getArgument("-parallelHardware", &parallelHardware, "Update the "
+                      "hardware components with disjoint joints concurrently");
+  parser->getArgument("-virtualTime", &virtualTime, "Run as fast as possible "
+                      "and skip the phases without motion and events");
+  parser->getArgument("-revalidate", &revalidationPeriod, "Period for re-checking "
+                      "the executed trajectory in seconds (default: %f)",
+                      revalidationPeriod);
+  parser->getArgument("-overlap", &overlapTime, "Time in seconds before the end "
+                      "of a motion at which the next action is started "
+                      "(default: %f)", overlapTime);
+  parser->getArgument("-renderRate", &renderRate, "Rate of rendering in Hz "
+                      "(default: %f, 0 is each step)", renderRate);
+  parser->getArgument("-perceptionRate", &perceptionRate, "Rate of the "
+                      "PostUpdateGraph stage in Hz (default: %f, 0 is each "
+                      "step)", perceptionRate);
   parser->getArgument("-sequence", &sequenceCommand, "Sequence command to start with");
+  parser->getArgument("-profile", &profileFile, "Record the event timings and "
+                      "write them in Chrome's trace format to the given file");
+  parser->getArgument("-sceneCache", &sceneCacheDir, "Directory for caching "
+                      "the parsed scene description (default: disabled)");
 
   // This is just for pupulating the parsed command line arguments for the help
   // functions / help window.
@@ -296,6 +332,11 @@ bool ExampleActionsECS::initAlgo()
   Rcs_addResourcePath(RCS_CONFIG_DIR);
   Rcs_addResourcePath(config_directory.c_str());
 
+  if (!sceneCacheDir.empty())
+  {
+    SceneCache::setDirectory(sceneCacheDir);
+  }
+
   if (noLimits)
   {
     noSpeedCheck = true;
@@ -309,6 +350,9 @@ bool ExampleActionsECS::initAlgo()
   entity.subscribe("Quit", &ExampleActionsECS::onQuit, this);
   entity.subscribe("Print", &ExampleActionsECS::onPrint, this);
   entity.subscribe("TrajectoryMoving", &ExampleActionsECS::onTrajectoryMoving, this);
+  entity.subscribe("TrajectoryOverlap", &ExampleActionsECS::onTrajectoryOverlap, this);
+  entity.subscribe("TrajectoryWarning", &ExampleActionsECS::onTrajectoryWarning, this);
+  entity.subscribe("SetTrajectory", &ExampleActionsECS::onSetTrajectory, this);
   entity.subscribe("ActionSequence", &ExampleActionsECS::onActionSequence, this);
   entity.subscribe("TextCommand", &ExampleActionsECS::onTextCommand, this);
 
@@ -320,6 +364,40 @@ bool ExampleActionsECS::initAlgo()
   setJointCommand = entity.registerEvent<const MatNd*>("SetJointCommand");
   setRenderCommand = entity.registerEvent<>("Render");
   postUpdateGraph = entity.registerEvent<RcsGraph*, RcsGraph*>("PostUpdateGraph");
+  setTextLine = entity.getEventHandle<std::string, int>("SetTextLine");
+
+  // The control stages run at the loop's rate 1/dt, since the trajectory
+  // and the IK advance by dt in each call.
+  scheduler.addStage("UpdateGraph", [this]()
+  {
+    updateGraph->call(graphC->getGraph());
+    hwDispatcher.join();
+  });
+  scheduler.addStage("ComputeKinematics", [this]()
+  {
+    computeKinematics->call(graphC->getGraph());
+  });
+  scheduler.addStage("PostUpdateGraph", [this]()
+  {
+    postUpdateGraph->call(ikc->getGraph(), graphC->getGraph());
+  }, perceptionRate);
+  scheduler.addStage("ComputeTrajectory", [this]()
+  {
+    computeTrajectory->call(ikc->getGraph());
+  });
+  scheduler.addStage("SetTaskCommand", [this]()
+  {
+    setTaskCommand->call(trajC->getActivationPtr(), trajC->getTaskCommandPtr());
+  });
+  scheduler.addStage("SetJointCommand", [this]()
+  {
+    setJointCommand->call(ikc->getJointCommandPtr());
+    hwDispatcher.join();
+  });
+  scheduler.addStage("Render", [this]()
+  {
+    setRenderCommand->call();
+  }, renderRate);
 
   if (pause)
   {
@@ -383,11 +461,23 @@ bool ExampleActionsECS::initAlgo()
   actionC = std::make_unique<aff::ActionComponent>(&entity, controller->getGraph(), controller->getBroadPhase());
   actionC->setLimitCheck(!noLimits);
   actionC->setMultiThreaded(!singleThreaded);
+  actionC->setSnapshotBuffer(&snapshots);
+  snapshots.setRequestCallback([this]()
+  {
+    entity.wakeUp();
+  });
   graphC = std::make_unique<aff::GraphComponent>(&entity, controller->getGraph());
   graphC->setEnableRender(false);//\todo MG CHECK
   trajC = std::make_unique<aff::TrajectoryComponent>(&entity, controller.get(), !zigzag, 1.0,
                                                      !noTrajCheck);
   trajC->enableDebugRendering(false);
+  if (!profileFile.empty())
+  {
+    entity.setProfiling(true);
+  }
+  trajC->setRevalidation(revalidationPeriod);
+  trajC->setOverlapTime(overlapTime);
+  actionC->setBlending(overlapTime > 0.0);
 
   // Inverse kinematics controller, no constraints, right inverse
   ikc = std::make_unique<aff::IKComponent>(&entity, controller.get(), ikType);
@@ -412,8 +502,13 @@ bool ExampleActionsECS::initAlgo()
     setEnableRobot(true);
   }
 
+  if (parallelHardware)
+  {
+    hwcToDispatch = hwc;
+  }
+
   // Initialization sequence to initialize all graphs from the sensory state
-  entity.initialize(graphC->getGraph());
+  initializeEntity();
 
   return true;
 }
@@ -712,11 +807,15 @@ void ExampleActionsECS::run()
     entity.publish("ActionSequence", sequenceCommand);
   }
 
+  snapshots.setActive(true);
+
   while (runLoop)
   {
     step();
   }
 
+  snapshots.setActive(false);
+
   // The runLoop is ended with ExampleBase::stop(). We still need to call each
   // component's stop event.
   entity.publish("Stop");
@@ -725,16 +824,22 @@ void ExampleActionsECS::run()
 
 void ExampleActionsECS::step()
 {
+  // In virtual time, phases without motion and events are not stepped
+  // through. Nothing is scheduled by time then, so that we can wait for the
+  // next event without changing the outcome. The time does not advance.
+  // Snapshot requests wake us up and are served without stepping.
+  if (virtualTime && (trajC->getMotionEndTime() <= 0.0) &&
+      (entity.queueSize() == 0) && !entity.waitForEvent(0.1))
+  {
+    std::lock_guard<std::mutex> lock(stepMtx);
+    snapshots.publish(controller->getGraph(), *getScene(), entity.getTime());
+    return;
+  }
+
   dtProcess = Timer_getSystemTime();
 
   stepMtx.lock();
-  updateGraph->call(graphC->getGraph());
-  computeKinematics->call(graphC->getGraph());
-  postUpdateGraph->call(ikc->getGraph(), graphC->getGraph());
-  computeTrajectory->call(ikc->getGraph());
-  setTaskCommand->call(trajC->getActivationPtr(), trajC->getTaskCommandPtr());
-  setJointCommand->call(ikc->getJointCommandPtr());
-  setRenderCommand->call();
+  scheduler.step(entity.getDt());
   dtEvents = Timer_getSystemTime() - dtProcess;
 
   if (withTaskGui)
@@ -744,10 +849,18 @@ void ExampleActionsECS::step()
 
   entity.process();
   entity.stepTime();
+  snapshots.publish(controller->getGraph(), *getScene(), entity.getTime());
   stepMtx.unlock();
 
+  const double stepStartTime = dtProcess;
   dtProcess = Timer_getSystemTime() - dtProcess;
 
+  if (entity.getProfiling())
+  {
+    entity.getProfiler()->record(stepProfileId, stepStartTime, dtProcess);
+    entity.getProfiler()->record(eventsProfileId, stepStartTime, dtEvents);
+  }
+
   if (entity.getTime() > 3.0)
   {
     dt_max = std::max(dt_max, dtProcess);
@@ -756,21 +869,27 @@ void ExampleActionsECS::step()
 
   loopCount++;
 
-  char timeStr[256];
   double endTime = trajC->getMotionEndTime();
-  snprintf(timeStr, 256, "Time: %.3f   dt: %.1f dt_max: %.1f %.1f msec\n"
-           "failCount: %zu queue: %zu (max: %zu)  End time: %.3f %.3f",
-           entity.getTime(), dtProcess * 1.0e3, dt_max * 1.0e3, dt_max2 * 1.0e3,
-           failCount, entity.queueSize(), entity.getMaxQueueSize(),
-           endTime, trajTime);
-  entity.publish("SetTextLine", std::string(timeStr), 0);
+
+  // The HUD text is updated at the rate of the rendering
+  if (entity.hasViewer() && scheduler.wasCalled("Render"))
+  {
+    char timeStr[256];
+    snprintf(timeStr, 256, "Time: %.3f   dt: %.1f dt_max: %.1f %.1f msec\n"
+             "failCount: %zu queue: %zu (max: %zu)  End time: %.3f %.3f  "
+             "missed: %zu",
+             entity.getTime(), dtProcess * 1.0e3, dt_max * 1.0e3, dt_max2 * 1.0e3,
+             failCount, entity.queueSize(), entity.getMaxQueueSize(),
+             endTime, trajTime, scheduler.getDeadlineMisses());
+    setTextLine->publish(std::string(timeStr), 0);
+  }
 
   if (endTime > 0.0)
   {
     trajTime += entity.getDt();
   }
 
-  if (loopCount % speedUp == 0)
+  if ((!virtualTime) && (loopCount % speedUp == 0))
   {
     Timer_waitDT(entity.getDt() - dtProcess);
   }
@@ -831,28 +950,18 @@ void ExampleActionsECS::onActionSequence(std::string text)
       return;
     }
 
-    // In case we detected a sequence, we parse the graph's configuration
-    // file again to load all available sequences. We do this here in order
-    // to allow to modify the file at run-time.
+    // In case we detected a sequence, we look it up in the registry of the
+    // graph's configuration file. It is parsed again if the file has been
+    // modified, so that sequences can be changed at run-time. Nested
+    // sequences are already expanded into individual commands.
     RLOG(1, "Detected action sequence");
-    ActionSequence seq(controller->getGraph()->cfgFile);
-    bool sequenceFound = false;
-    for (const auto& pair : seq.sequences)
-    {
-      if (words[1] == pair.first)
-      {
-        // If a valid sequence name has been found, we expand it into the text string.
-        text = pair.second;
-        sequenceFound = true;
-        RLOG_CPP(0, "Sequence expanded to '" << text << "'");
-        break;
-      }
-    }
+    auto registry = ActionSequenceRegistry::get(controller->getGraph()->cfgFile);
+    const ActionSequenceRegistry::Sequence* seq = registry->find(words[1]);
 
     // If we end up here, a sequence with a name has been given, but the
     // sequence was not specified in the configuration file. This is
     // treated as an error.
-    if (!sequenceFound)
+    if (!seq)
     {
       std::string explanation = "ERROR: Can't execute action sequence. REASON: Action sequence " +
                                 words[1] + " not found in config file DEVELOPER: '" + text + "'";
@@ -861,66 +970,32 @@ void ExampleActionsECS::onActionSequence(std::string text)
       return;
     }
 
-    // Check for cascading sequences and expand them
-    bool innerSequenceFound = true;
-    while (innerSequenceFound)
+    // Nested sequences that are not in the configuration file, or that
+    // contain themselves.
+    if (!seq->error.empty())
     {
-      // We start with the assumption that no inner sequence has been found.
-      // Split the text into its individual commands.
-      innerSequenceFound = false;
-      std::vector<std::string> textWords = Rcs::String_split(text, ";");
-
-      // Split individual commands into single words and check if they are
-      // sequences.
-      for (const auto& command : textWords)
-      {
-        std::vector<std::string> words = Rcs::String_split(command, " ");
-        if ((!words.empty()) && (words[0] == "sequence" || words[0] == "s"))
-        {
-          // If a inner sequence command is found, start the expanding process.
-          // Flag that a cascading sequence has been found, which enforces another
-          // top level loop to check for new inner sequences.
-          innerSequenceFound = true;
-          RLOG_CPP(1, "Detected cascading action sequence");
-
-          // Check if the sequence is in fact part of the configuration file.
-          bool sequenceFound = false;
-          for (const auto& pair : seq.sequences)
-          {
-            // If we find the sequence, we replace the ALL the occurences
-            // with the sequence text as it's defined in the config.
-            if (words[1] == pair.first)
-            {
-              RLOG_CPP(1, "Expanding '" << command << "' into '" << pair.second << "'");
-
-              replaceFirst(text, command, pair.second);
-
-              sequenceFound = true;
-              RLOG_CPP(1, "Sequence expanded to '" << text << "'");
-              break;
-            }
-          }
-
-          // TODO (CP) - duplicated code, refactor
-          // If we end up here, a sequence with a name has been given, but the
-          // sequence was not specified in the configuration file. This is
-          // treated as an error.
-          if (!sequenceFound)
-          {
-            std::string explanation = "ERROR: Can't execute action sequence. REASON: Action sequence " +
-                                      words[1] + " not found in config file DEVELOPER: '" + text + "'";
-            entity.publish("ActionResult", false, 0.0, explanation);
-            RLOG_CPP(0, explanation);
-            return;
-          }
-        }
-      }
+      std::string explanation = seq->error + " DEVELOPER: '" + text + "'";
+      entity.publish("ActionResult", false, 0.0, explanation);
+      RLOG_CPP(0, explanation);
+      return;
     }
-  }
 
-  RLOG_CPP(0, "Sequence expanded to '" << text << "'");
+    if (seq->commands.empty())
+    {
+      std::string explanation = "ERROR: Can't execute action sequence. REASON: Action sequence " +
+                                words[1] + " is empty DEVELOPER: '" + text + "'";
+      entity.publish("ActionResult", false, 0.0, explanation);
+      RLOG_CPP(0, explanation);
+      return;
+    }
 
-  // From here on, any sequence has been expanded
+    actionStack = seq->commands;
+    RLOG_CPP(0, "Sequence expanded to " << actionStack.size() << " commands");
+    entity.publish("TextCommand", actionStack[0]);
+    return;
+  }
+
+  // From here on, the text is a list of plain commands
   actionStack = Rcs::String_split(text, ";");
 
   // Strip individual actions from white spaces etc.
@@ -937,6 +1012,13 @@ void ExampleActionsECS::onPrint()
   RcsCollisionModel_fprint(stderr, controller->getCollisionMdl());
   ActionFactory::print();
   actionC->getDomain()->print();
+  scheduler.print();
+}
+
+void ExampleActionsECS::onTrajectoryWarning(std::string msg)
+{
+  RLOG_CPP(0, "Trajectory warning: " << msg);
+  entity.publish("SetTextLine", "WARNING: " + msg, 2);
 }
 
 void ExampleActionsECS::onTrajectoryMoving(bool isMoving)
@@ -947,6 +1029,14 @@ void ExampleActionsECS::onTrajectoryMoving(bool isMoving)
     return;
   }
 
+  // The next action has already been started during the overlap, and the
+  // success of this one has been reported there.
+  if (nextActionStarted)
+  {
+    nextActionStarted = false;
+    return;
+  }
+
   // If the trajectory has finshed, we can report success.
   entity.publish("ActionResult", true, 0.0, std::string("SUCCESS DEVELOPER: ") +
                  std::string(__FILENAME__) + " line " + std::to_string(__LINE__));
@@ -981,6 +1071,30 @@ void ExampleActionsECS::onTrajectoryMoving(bool isMoving)
   }
 }
 
+// The moving action is about to end, and we start the next one so that it can
+// be blended into the motion. The ActionComponent takes care that it doesn't
+// interfere with the manipulators of the moving action.
+void ExampleActionsECS::onTrajectoryOverlap(double remainingTime)
+{
+  if (nextActionStarted || (actionStack.size()<2))
+  {
+    return;
+  }
+
+  RLOG_CPP(0, "Starting next action " << remainingTime
+           << " sec before the motion ends: " << actionStack[1]);
+  nextActionStarted = true;
+  entity.publish("ActionResult", true, 0.0, std::string("SUCCESS DEVELOPER: ") +
+                 std::string(__FILENAME__) + " line " + std::to_string(__LINE__));
+  entity.publish("TextCommand", actionStack[1]);
+}
+
+// Once the blended action has been applied, the end of the motion belongs to it.
+void ExampleActionsECS::onSetTrajectory(tropic::TCS_sptr tSet)
+{
+  nextActionStarted = false;
+}
+
 // This only handles the "reset" keyword
 void ExampleActionsECS::onTextCommand(std::string text)
 {
@@ -1060,6 +1174,7 @@ void ExampleActionsECS::setEnableRobot(bool enable)
 {
   RMSG("***** Real Robot in the loop - speedUp resetted to 1 *****");
   speedUp = 1;
+  virtualTime = false;
   withRobot = enable;
 }
 
@@ -1077,9 +1192,28 @@ void ExampleActionsECS::addHardwareComponent(ComponentBase* component)
   {
     hwc.push_back(component);
     setEnableRobot(true);
+
+    if (parallelHardware)
+    {
+      hwcToDispatch.push_back(component);
+    }
   }
 }
 
+void ExampleActionsECS::initializeEntity()
+{
+  entity.initialize(graphC->getGraph());
+
+  // Only after the initialization sequence, since it does not join the
+  // dispatched UpdateGraph calls before ComputeKinematics.
+  for (auto c : hwcToDispatch)
+  {
+    hwDispatcher.add(c, controller->getGraph());
+  }
+
+  hwcToDispatch.clear();
+}
+
 bool ExampleActionsECS::getRobotEnabled() const
 {
   return withRobot;
@@ -56,6 +56,9 @@
 #include <JointWidget.h>
 #include <MatNdWidget.h>
 #include <ActionBase.h>
+#include <StateSnapshot.h>
+#include <LoopScheduler.h>
+#include <HardwareDispatcher.h>
 
 
 
@@ -75,15 +78,22 @@ public:
   std::string xmlFileName;
   std::string config_directory;
   std::string sequenceCommand;
+  std::string profileFile;
+  std::string sceneCacheDir;
   std::vector<std::string> actionStack;
   IKComponent::IkSolverType ikType;
-  double dt, dt_max, dt_max2, alpha, lambda;
+  double dt, dt_max, dt_max2, alpha, lambda, revalidationPeriod, overlapTime;
+  double renderRate, perceptionRate;
   unsigned int speedUp, loopCount;
   bool pause, noSpeedCheck, noJointCheck, noCollCheck, noTrajCheck;
   bool noLimits, zigzag, withEventGui, withTaskGui, noViewer, noTextGui;
   bool plot, valgrind, unittest, withRobot;
   bool singleThreaded;
+  bool parallelHardware;    // Concurrent updates of hardware components
+  bool virtualTime;         // As fast as possible, idle phases are skipped
+  bool nextActionStarted;   // During the overlap with the previous one
   double dtProcess, dtEvents;
+  size_t stepProfileId, eventsProfileId;
   size_t failCount;
 
   ES::SubscriberCollectionDecay<RcsGraph*>* updateGraph;
@@ -93,6 +103,7 @@ public:
   ES::SubscriberCollectionDecay<const MatNd*, const MatNd*>* setTaskCommand;
   ES::SubscriberCollectionDecay<const MatNd*>* setJointCommand;
   ES::SubscriberCollectionDecay<>* setRenderCommand;
+  EventHandle<std::string, int>* setTextLine;
   std::unique_ptr<Rcs::ControllerBase> controller;
   std::unique_ptr<TextEditComponent> textGui;
   std::unique_ptr<ActionComponent> actionC;
@@ -102,6 +113,9 @@ public:
   std::unique_ptr<GraphicsWindow> viewer;
   std::unique_ptr<TaskGuiComponent> taskGui;
   RcsGraph* graphToInitializeWith;
+  mutable StateSnapshotBuffer snapshots;   // Published at the end of step()
+  LoopScheduler scheduler;                 // Stages of step() and their rates
+  HardwareDispatcher hwDispatcher;         // Used if parallelHardware is true
 
   ExampleActionsECS(int argc, char** argv);
   virtual ~ExampleActionsECS();
@@ -118,14 +132,27 @@ public:
   void onPrint();
   void onActionSequence(std::string text);
   void onTrajectoryMoving(bool isMoving);
+  void onTrajectoryOverlap(double remainingTime);
+  virtual void onTrajectoryWarning(std::string msg);
+  void onSetTrajectory(tropic::TCS_sptr tSet);
   void onTextCommand(std::string text);
   void setEnableRobot(bool enable);
   bool getRobotEnabled() const;
   ActionScene* getScene();
   const ActionScene* getScene() const;
   void addComponent(ComponentBase* component);
+
+  /*! \brief Adds a hardware component. With parallel hardware, it is handed
+   *         to the dispatcher in the next initializeEntity() call, since
+   *         the initialization sequence does not join dispatched calls.
+   */
   void addHardwareComponent(ComponentBase* component);
 
+  /*! \brief Runs the entity's initialization sequence, and then dispatches
+   *         the hardware components that have been added so far.
+   */
+  void initializeEntity();
+
   std::vector<std::pair<std::string,std::string>> getCompletedActionStack() const;
 
 protected:
@@ -138,6 +165,7 @@ protected:
   mutable std::mutex stepMtx;
 
   std::vector<ComponentBase*> hwc;
+  std::vector<ComponentBase*> hwcToDispatch;   // Until initializeEntity()
   std::vector<ComponentBase*> components;
 };
 
@@ -43,6 +43,7 @@
 #include <Rcs_math.h>
 #include <Rcs_shape.h>
 #include <Rcs_timer.h>
+#include <Rcs_utilsCPP.h>
 
 #include <unordered_set>
 
@@ -171,7 +172,43 @@ bool ExampleLLMSim::initAlgo()
     this->server.set_message_handler([this](websocketpp::connection_hdl hdl, WebsocketServer::message_ptr msg)
     {
       RLOG(0, "Received msg: '%s'", msg->get_payload().c_str());
-      entity.publish("ActionSequence", msg->get_payload());
+      std::string payload = msg->get_payload();
+
+      // Validation requests are answered directly and don't go through the
+      // action sequence: "validate get cup; put cup table; ...". With
+      // "validate_full", the actions are constructed including solutions.
+      const bool validateFull = STRNEQ(payload.c_str(), "validate_full ", 14);
+      if (validateFull || STRNEQ(payload.c_str(), "validate ", 9))
+      {
+        std::vector<std::string> commands =
+          Rcs::String_split(payload.substr(validateFull ? 14 : 9), ";");
+        for (auto& c : commands)
+        {
+          c.erase(0, c.find_first_not_of(" \t\n\r"));
+          c.erase(c.find_last_not_of(" \t\n\r")+1);
+        }
+
+        // The reply is posted to the io service, so that it is sent from the
+        // thread that polls the server. The jobs are joined when the
+        // websocket is stopped.
+        validationJobs.remove_if([](const std::future<void>& job)
+        {
+          return job.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+        });
+
+        validationJobs.push_back(std::async(std::launch::async, [this, hdl, commands, validateFull]()
+        {
+          std::string res = validateCommands(commands, validateFull);
+          this->server.get_io_service().post([this, hdl, res]()
+          {
+            websocketpp::lib::error_code ec;
+            this->server.send(hdl, res, websocketpp::frame::opcode::TEXT, ec);
+          });
+        }));
+        return;
+      }
+
+      entity.publish("ActionSequence", payload);
     });
     this->server.set_fail_handler([this](websocketpp::connection_hdl hdl)
     {
@@ -274,6 +311,12 @@ void ExampleLLMSim::onStopWebSocket()
       started = false;
       bgThread.join();
     }
+
+    for (auto& job : validationJobs)
+    {
+      job.wait();
+    }
+    validationJobs.clear();
   }
   else
   {
@@ -353,15 +396,44 @@ void ExampleLLMSim::onActionResultUnittest(bool success, double quality, std::st
   failCount = numFailedActions;
 }
 
-// This only handles the "get_state" keyword
+// The action keeps running unless the trajectory has been stopped, in which
+// case a failed ActionResult follows.
+void ExampleLLMSim::onTrajectoryWarning(std::string msg)
+{
+  ExampleActionsECS::onTrajectoryWarning(msg);
+
+  if (connected && useWebsocket)
+  {
+    this->server.send(hdl, "WARNING: " + msg, websocketpp::frame::opcode::TEXT);
+  }
+}
+
+// This only handles the "get_state" keyword. With a version number
+// ("get_state 12"), only the changes since this version are sent.
 void ExampleLLMSim::onTextCommand(std::string text)
 {
   RMSG_CPP("ExampleLLMSim::onTextCommand RECEIVED: " << text);
-  if (text=="get_state")
+  if (STRNEQ(text.c_str(), "get_state", 9))
   {
-    std::thread feedbackThread([this]()
+    std::string versionStr = text.substr(9);
+    const bool versioned = !versionStr.empty();
+    size_t knownVersion = 0;
+
+    if (versioned)
+    {
+      try
+      {
+        knownVersion = std::stoul(versionStr);
+      }
+      catch (const std::exception&)
+      {
+        RLOG_CPP(1, "Invalid version in \"" << text << "\" - sending full state");
+      }
+    }
+
+    std::thread feedbackThread([this, versioned, knownVersion]()
     {
-      std::string fb = collectFeedback();
+      std::string fb = versioned ? collectFeedbackSince(knownVersion) : collectFeedback();
       if (connected && useWebsocket)
       {
         this->server.send(hdl, fb, websocketpp::frame::opcode::TEXT);
@@ -406,37 +478,73 @@ std::string ExampleLLMSim::getSceneEntities() const
   return res;
 }
 
-std::string ExampleLLMSim::collectFeedback() const
+std::shared_ptr<const StateSnapshot> ExampleLLMSim::getSnapshot() const
 {
+  const size_t prevVersion = snapshots.getVersion();
+  std::shared_ptr<const StateSnapshot> snap = snapshots.get();
 
-  double t0 = Timer_getSystemTime();
-  static RcsGraph* staticGraph = NULL;
-  static ActionScene staticScene;
-
-  stepMtx.lock();
-  if (!staticGraph)
+  // If the loop is not stepping, we publish it ourselves. The step mutex
+  // ensures that there is only one writer.
+  if (!snap || (snap->version == prevVersion))
   {
-    staticGraph = RcsGraph_clone(controller->getGraph());
-}
-  else
-  {
-    RcsGraph_copy(staticGraph, controller->getGraph());
+    std::lock_guard<std::mutex> lock(stepMtx);
+    snapshots.publish(controller->getGraph(), *getScene(), entity.getTime(), true);
+    snap = snapshots.getLatest();
   }
-  double t1 = Timer_getSystemTime();
 
-  staticScene = *getScene();
-  double t2 = Timer_getSystemTime();
-  stepMtx.unlock();
+  return snap;
+}
+
+std::string ExampleLLMSim::collectFeedback() const
+{
+  double t0 = Timer_getSystemTime();
+  std::shared_ptr<const StateSnapshot> snap = getSnapshot();
 
-  NLOG(1, "get_state took %.3f  %.3f msec (graph, actions)",
-       (t1-t0)*1.0e3, (t2-t1)*1.0e3);
+  NLOG(1, "get_state waited %.3f msec for snapshot %zu",
+       (Timer_getSystemTime()-t0)*1.0e3, snap->version);
 
   nlohmann::json stateJson;
-  getSceneState(stateJson, &staticScene, staticGraph);
+  getSceneState(stateJson, &snap->scene, snap->graph);
 
   return stateJson.dump();
 }
 
+std::string ExampleLLMSim::collectFeedbackSince(size_t knownVersion) const
+{
+  std::shared_ptr<const StateSnapshot> snap = getSnapshot();
+  return stateTracker.getState(&snap->scene, snap->graph, knownVersion);
+}
+
+std::string ExampleLLMSim::validateCommands(const std::vector<std::string>& commands,
+                                            bool construct) const
+{
+  double t0 = Timer_getSystemTime();
+
+  // All commands are validated against the same snapshot of graph and scene
+  std::shared_ptr<const StateSnapshot> snap = getSnapshot();
+
+  std::vector<ActionFactory::ValidationResult> results =
+    ActionFactory::validate(snap->scene, snap->graph, commands, 0, construct);
+
+  nlohmann::json json = nlohmann::json::array();
+
+  for (const auto& r : results)
+  {
+    nlohmann::json res;
+    res["command"] = r.command;
+    res["valid"] = r.valid;
+    res["error"] = ActionException::errorName(r.error);
+    res["explanation"] = r.explanation;
+    res["solutions"] = r.numSolutions;
+    json.push_back(res);
+  }
+
+  RLOG(1, "Validated %zu commands in %.3f msec", commands.size(),
+       1.0e3*(Timer_getSystemTime()-t0));
+
+  return json.dump();
+}
+
 void ExampleLLMSim::setUseWebsocket(bool enable)
 {
   useWebsocket = enable;
@@ -35,6 +35,7 @@
 #define AFF_EXAMPLELLMSIM_H
 
 #include "ExampleActionsECS.h"
+#include "SceneStateTracker.h"
 
 #define ASIO_STANDALONE
 
@@ -45,6 +46,8 @@
 #include <websocketpp/server.hpp>
 
 #include <thread>
+#include <future>
+#include <list>
 
 
 namespace aff
@@ -62,7 +65,11 @@ public:
   virtual void onStartWebSocket();
   virtual void onStopWebSocket();
   virtual std::string collectFeedback() const;
+  std::string collectFeedbackSince(size_t knownVersion) const;
+  std::shared_ptr<const StateSnapshot> getSnapshot() const;
   virtual std::string getSceneEntities() const;
+  virtual std::string validateCommands(const std::vector<std::string>& commands,
+                                       bool construct=false) const;
   virtual std::string help();
   virtual bool initParameters();
   virtual bool initAlgo();
@@ -77,6 +84,7 @@ public:
   virtual bool parseArgs(Rcs::CmdLineParser* parser);
   virtual void onActionResult(bool success, double quality, std::string resMsg);
   virtual void onActionResultUnittest(bool success, double quality, std::string resMsg);
+  virtual void onTrajectoryWarning(std::string msg);
   virtual void onTextCommand(std::string text);
   virtual void process();
 
@@ -90,7 +98,9 @@ public:
   unsigned int port = 35000;
   size_t numFailedActions = 0;
   std::thread bgThread;
+  std::list<std::future<void>> validationJobs;   // Accessed in the message handler
   std::string lastResultMsg;
+  mutable SceneStateTracker stateTracker;   // For get_state with a version
 };
 
 }   // namespace aff
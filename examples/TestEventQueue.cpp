@@ -0,0 +1,225 @@
+/*******************************************************************************
+
+  Copyright (c) Honda Research Institute Europe GmbH.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+  IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT,
+  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+  OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+#include <EventQueue.h>
+
+#include <Rcs_cmdLine.h>
+#include <Rcs_macros.h>
+
+#include <thread>
+#include <vector>
+
+
+
+static int testSequential()
+{
+  int nErrors = 0;
+  aff::EventQueue queue(5);
+  std::vector<int> popped;
+  aff::EventQueue::Event ev;
+
+  if (queue.capacity() != 8)
+  {
+    RLOG(0, "FAILURE: Capacity is %zu instead of 8", queue.capacity());
+    nErrors++;
+  }
+
+  if (queue.tryPop(ev))
+  {
+    RLOG(0, "FAILURE: Popped from empty queue");
+    nErrors++;
+  }
+
+  // Wraps around several times
+  for (int round=0; round<3; ++round)
+  {
+    popped.clear();
+
+    for (int i=0; i<8; ++i)
+    {
+      ev = [&popped, i]()
+      {
+        popped.push_back(i);
+      };
+
+      if (!queue.tryPush(ev))
+      {
+        RLOG(0, "FAILURE: Push %d failed in round %d", i, round);
+        nErrors++;
+      }
+    }
+
+    // A failed push must leave the event untouched
+    ev = []() {};
+    if (queue.tryPush(ev) || !ev)
+    {
+      RLOG(0, "FAILURE: Push to full queue in round %d", round);
+      nErrors++;
+    }
+
+    if (queue.size() != 8)
+    {
+      RLOG(0, "FAILURE: Size is %zu instead of 8", queue.size());
+      nErrors++;
+    }
+
+    while (queue.tryPop(ev))
+    {
+      ev();
+    }
+
+    for (size_t i=0; i<popped.size(); ++i)
+    {
+      if (popped[i] != (int)i)
+      {
+        RLOG(0, "FAILURE: Popped %d at position %zu", popped[i], i);
+        nErrors++;
+      }
+    }
+
+    if (popped.size() != 8)
+    {
+      RLOG(0, "FAILURE: Popped %zu instead of 8 events", popped.size());
+      nErrors++;
+    }
+  }
+
+  // Failed pushes are not counted
+  if ((queue.getNumPushed() != 24) || (queue.getMaxSize() != 8))
+  {
+    RLOG(0, "FAILURE: Statistics %zu pushed, max. size %zu",
+         queue.getNumPushed(), queue.getMaxSize());
+    nErrors++;
+  }
+
+  RLOG(0, "Sequential test: %d errors", nErrors);
+
+  return nErrors;
+}
+
+/*******************************************************************************
+ * Several producers push concurrently to one consumer. Each event must be
+ * popped exactly once, and the events of one producer in the order they
+ * have been pushed.
+ ******************************************************************************/
+static int testConcurrent(int numProducers, int numEvents)
+{
+  int nErrors = 0;
+  aff::EventQueue queue(64);
+  std::vector<int> lastEvent(numProducers, -1);
+  std::vector<std::thread> producers;
+
+  for (int p=0; p<numProducers; ++p)
+  {
+    producers.push_back(std::thread([&, p]()
+    {
+      for (int i=0; i<numEvents; ++i)
+      {
+        aff::EventQueue::Event ev = [&, p, i]()
+        {
+          if (lastEvent[p] != i-1)
+          {
+            RLOG(0, "FAILURE: Producer %d: event %d after %d",
+                 p, i, lastEvent[p]);
+            nErrors++;
+          }
+          lastEvent[p] = i;
+        };
+
+        while (!queue.tryPush(ev))
+        {
+          std::this_thread::yield();
+        }
+      }
+    }));
+  }
+
+  const long long total = (long long)numProducers*numEvents;
+  long long numPopped = 0;
+  aff::EventQueue::Event ev;
+
+  while (numPopped < total)
+  {
+    if (queue.tryPop(ev))
+    {
+      ev();
+      numPopped++;
+    }
+    else
+    {
+      std::this_thread::yield();
+    }
+  }
+
+  for (auto& t : producers)
+  {
+    t.join();
+  }
+
+  for (int p=0; p<numProducers; ++p)
+  {
+    if (lastEvent[p] != numEvents-1)
+    {
+      RLOG(0, "FAILURE: Producer %d: last event %d", p, lastEvent[p]);
+      nErrors++;
+    }
+  }
+
+  if (queue.tryPop(ev) || (queue.size() != 0))
+  {
+    RLOG(0, "FAILURE: Queue not empty");
+    nErrors++;
+  }
+
+  RLOG(0, "Concurrent test: %d producers, %lld events, max. size %zu, %d errors",
+       numProducers, total, queue.getMaxSize(), nErrors);
+
+  return nErrors;
+}
+
+int main(int argc, char** argv)
+{
+  int numProducers = 4, numEvents = 100000;
+  Rcs::CmdLineParser argP(argc, argv);
+  argP.getArgument("-dl", &RcsLogLevel, "Rcs log level");
+  argP.getArgument("-producers", &numProducers, "Number of producer threads");
+  argP.getArgument("-n", &numEvents, "Number of events per producer");
+
+  int nErrors = 0;
+  nErrors += testSequential();
+  nErrors += testConcurrent(numProducers, numEvents);
+
+  RLOG(0, "%d errors", nErrors);
+
+  return nErrors;
+}
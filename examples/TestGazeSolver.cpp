@@ -0,0 +1,173 @@
+/*******************************************************************************
+
+  Copyright (c) Honda Research Institute Europe GmbH.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+  IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT,
+  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+  OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+#include <GazeSolver.h>
+
+#include <Rcs_typedef.h>
+#include <Rcs_math.h>
+#include <Rcs_cmdLine.h>
+#include <Rcs_macros.h>
+
+#include <libxml/parser.h>
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+
+
+// Pan-tilt unit with a camera that is offset from both joint axes, so that
+// the analytic step alone is not exact.
+static const char* panTiltGraph =
+  "<Graph name=\"PanTilt\" >\n"
+  "  <Body name=\"base\" transform=\"0.3 0 0 0 0 10\" />\n"
+  "  <Body name=\"ptu_pan_link\" prev=\"base\" transform=\"0 0 1 0 0 0\" >\n"
+  "    <Joint name=\"ptu_pan_joint\" type=\"RotZ\" range=\"-360 10 360\" />\n"
+  "  </Body>\n"
+  "  <Body name=\"ptu_tilt_link\" prev=\"ptu_pan_link\" transform=\"0.05 0.02 0.1 0 0 0\" >\n"
+  "    <Joint name=\"ptu_tilt_joint\" type=\"RotY\" range=\"-90 -10 90\" />\n"
+  "  </Body>\n"
+  "  <Body name=\"head_kinect_rgb_link\" prev=\"ptu_tilt_link\" transform=\"0.05 -0.03 0.05 0 90 0\" />\n"
+  "  <Body name=\"target\" transform=\"1 0 0 0 0 0\" />\n"
+  "</Graph>\n";
+
+/*******************************************************************************
+ * Solves for the target at pos, and checks with the graph's forward
+ * kinematics that the target is on the camera's optical axis.
+ ******************************************************************************/
+static bool testTarget(aff::GazeSolver& solver, RcsGraph* graph,
+                       const double pos[3])
+{
+  const RcsBody* camera = RcsGraph_getBodyByName(graph, "head_kinect_rgb_link");
+  RcsBody* target = RcsGraph_getBodyByName(graph, "target");
+  const RcsJoint* pan = RcsGraph_getJointByName(graph, "ptu_pan_joint");
+  const RcsJoint* tilt = RcsGraph_getJointByName(graph, "ptu_tilt_joint");
+  RCHECK(camera && target && pan && tilt);
+
+  Vec3d_copy(target->A_BP.org, pos);
+  RcsGraph_setState(graph, NULL, NULL);
+  const double q0[2] = { graph->q->ele[pan->jointIndex],
+                         graph->q->ele[tilt->jointIndex]
+                       };
+
+  double panTilt[2], err[2];
+  int iter = solver.solve(graph, "target", panTilt, 100, 1.0e-8, err);
+
+  if ((graph->q->ele[pan->jointIndex] != q0[0]) ||
+      (graph->q->ele[tilt->jointIndex] != q0[1]))
+  {
+    RLOG(0, "FAILURE: Solver modified the graph");
+    return false;
+  }
+
+  graph->q->ele[pan->jointIndex] = panTilt[0];
+  graph->q->ele[tilt->jointIndex] = panTilt[1];
+  RcsGraph_setState(graph, NULL, NULL);
+
+  double x[3];
+  Vec3d_invTransform(x, &camera->A_BI, target->A_BI.org);
+
+  graph->q->ele[pan->jointIndex] = q0[0];
+  graph->q->ele[tilt->jointIndex] = q0[1];
+  RcsGraph_setState(graph, NULL, NULL);
+
+  const bool success = (iter >= 0) && (fabs(x[0]) < 1.0e-6) &&
+                       (fabs(x[1]) < 1.0e-6) && (x[2] > 0.0);
+
+  RLOG(0, "%s: target %.2f %.2f %.2f: %d iterations, pan=%.4f tilt=%.4f, "
+       "error=%g %g, target in camera frame: %g %g %g",
+       success ? "SUCCESS" : "FAILURE", pos[0], pos[1], pos[2], iter,
+       panTilt[0], panTilt[1], err[0], err[1], x[0], x[1], x[2]);
+
+  return success;
+}
+
+int main(int argc, char** argv)
+{
+  Rcs::CmdLineParser argP(argc, argv);
+  argP.getArgument("-dl", &RcsLogLevel, "Rcs log level");
+
+  const char* xmlFile = "TestGazeSolver.xml";
+  {
+    std::ofstream out(xmlFile);
+    out << panTiltGraph;
+  }
+
+  RcsGraph* graph = RcsGraph_create(xmlFile);
+  std::remove(xmlFile);
+  RCHECK(graph);
+
+  const double targets[][3] = { { 1.5, 0.5, 0.8 },
+    { -1.0, 0.2, 0.5 },
+    { 0.5, -1.5, 2.0 },
+    { 2.0, 0.0, 1.2 },
+    { 0.3, 1.0, 0.0 }
+  };
+
+  aff::GazeSolver solver;
+  int nErrors = 0;
+
+  // Second round starts from the last solution (warm start)
+  for (int round = 0; round < 2; ++round)
+  {
+    for (const auto& pos : targets)
+    {
+      if (!testTarget(solver, graph, pos))
+      {
+        nErrors++;
+      }
+    }
+  }
+
+  double panTilt[2];
+  if (solver.solve(graph, "no_such_body", panTilt, 10, 1.0e-8, NULL) != -1)
+  {
+    RLOG(0, "FAILURE: Unknown gaze target has been accepted");
+    nErrors++;
+  }
+
+  aff::GazeSolver wrongSolver("ptu_pan_joint", "no_such_joint");
+  if (wrongSolver.solve(graph, "target", panTilt, 10, 1.0e-8, NULL) != -1)
+  {
+    RLOG(0, "FAILURE: Unknown tilt joint has been accepted");
+    nErrors++;
+  }
+
+  RcsGraph_destroy(graph);
+  xmlCleanupParser();
+
+  RLOG(0, "%d errors", nErrors);
+
+  return nErrors;
+}
@@ -0,0 +1,265 @@
+/*******************************************************************************
+
+  Copyright (c) Honda Research Institute Europe GmbH.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+  IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT,
+  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+  OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+#include <TransformRing.h>
+
+#include <Rcs_typedef.h>
+#include <Rcs_cmdLine.h>
+#include <Rcs_macros.h>
+
+#include <libxml/parser.h>
+
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <thread>
+
+
+
+static const char* ringGraph =
+  "<Graph name=\"Ring\" >\n"
+  "  <Body name=\"base\" />\n"
+  "  <Body name=\"link1\" prev=\"base\" >\n"
+  "    <Joint name=\"joint1\" type=\"RotZ\" range=\"-360 0 360\" />\n"
+  "  </Body>\n"
+  "  <Body name=\"link2\" prev=\"link1\" >\n"
+  "    <Joint name=\"joint2\" type=\"RotY\" range=\"-360 0 360\" />\n"
+  "  </Body>\n"
+  "</Graph>\n";
+
+static RcsGraph* createGraph(const char* xml)
+{
+  const char* xmlFile = "TestTransformRing.xml";
+  {
+    std::ofstream out(xmlFile);
+    out << xml;
+  }
+
+  RcsGraph* graph = RcsGraph_create(xmlFile);
+  std::remove(xmlFile);
+  RCHECK(graph);
+
+  return graph;
+}
+
+/*******************************************************************************
+ * Writes value into all transforms and joint angles, so that a torn snapshot
+ * can be detected by comparing them.
+ ******************************************************************************/
+static void setValue(RcsGraph* graph, double value)
+{
+  for (unsigned int i=0; i<graph->nBodies; ++i)
+  {
+    graph->bodies[i].A_BI.org[0] = value;
+  }
+
+  for (unsigned int i=0; i<graph->dof; ++i)
+  {
+    graph->q->ele[i] = value;
+  }
+}
+
+static bool hasValue(const RcsGraph* graph, double value)
+{
+  for (unsigned int i=0; i<graph->nBodies; ++i)
+  {
+    if (graph->bodies[i].A_BI.org[0] != value)
+    {
+      return false;
+    }
+  }
+
+  for (unsigned int i=0; i<graph->dof; ++i)
+  {
+    if (graph->q->ele[i] != value)
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static int testSequential(RcsGraph* src, RcsGraph* dst)
+{
+  int nErrors = 0;
+  aff::TransformRing ring;
+
+  if (ring.read(dst))
+  {
+    RLOG(0, "FAILURE: Read from empty buffer");
+    nErrors++;
+  }
+
+  setValue(src, 1.0);
+  ring.write(src);
+
+  if (!ring.read(dst) || !hasValue(dst, 1.0))
+  {
+    RLOG(0, "FAILURE: Written snapshot not read");
+    nErrors++;
+  }
+
+  if (ring.read(dst))
+  {
+    RLOG(0, "FAILURE: Snapshot read twice");
+    nErrors++;
+  }
+
+  // The writer does not wait for the reader, and the newest snapshot wins
+  for (int i=2; i<=5; ++i)
+  {
+    setValue(src, i);
+    ring.write(src);
+  }
+
+  if (!ring.read(dst) || !hasValue(dst, 5.0))
+  {
+    RLOG(0, "FAILURE: Newest snapshot not read");
+    nErrors++;
+  }
+
+  if ((ring.getNumWritten() != 5) || (ring.getNumStale() != 3))
+  {
+    RLOG(0, "FAILURE: %zu written and %zu stale instead of 5 and 3",
+         ring.getNumWritten(), ring.getNumStale());
+    nErrors++;
+  }
+
+  RLOG(0, "Sequential test: %d errors", nErrors);
+
+  return nErrors;
+}
+
+static int testSizeMismatch(RcsGraph* src)
+{
+  int nErrors = 0;
+  RcsGraph* other = createGraph("<Graph name=\"Small\" >\n"
+                                "  <Body name=\"base\" />\n"
+                                "</Graph>\n");
+  aff::TransformRing ring;
+  ring.write(src);
+
+  if (ring.read(other))
+  {
+    RLOG(0, "FAILURE: Snapshot of a different graph accepted");
+    nErrors++;
+  }
+
+  RcsGraph_destroy(other);
+
+  RLOG(0, "Size mismatch test: %d errors", nErrors);
+
+  return nErrors;
+}
+
+/*******************************************************************************
+ * The reader must only see complete snapshots, in the order they have been
+ * written, and the newest one after the writer is done.
+ ******************************************************************************/
+static int testConcurrent(RcsGraph* src, RcsGraph* dst, int numWrites)
+{
+  int nErrors = 0, numReads = 0;
+  double lastValue = 0.0;
+  aff::TransformRing ring;
+  std::atomic<bool> done(false);
+
+  std::thread writer([&]()
+  {
+    for (int i=1; i<=numWrites; ++i)
+    {
+      setValue(src, i);
+      ring.write(src);
+    }
+    done = true;
+  });
+
+  bool finished = false;
+  while (!finished)
+  {
+    finished = done;
+
+    if (!ring.read(dst))
+    {
+      continue;
+    }
+
+    numReads++;
+    const double value = dst->q->ele[0];
+
+    if ((!hasValue(dst, value)) || (value <= lastValue))
+    {
+      RLOG(0, "FAILURE: Read %g after %g", value, lastValue);
+      nErrors++;
+    }
+
+    lastValue = value;
+  }
+
+  writer.join();
+
+  if (lastValue != numWrites)
+  {
+    RLOG(0, "FAILURE: Last read %g instead of %d", lastValue, numWrites);
+    nErrors++;
+  }
+
+  RLOG(0, "Concurrent test: %d reads of %d writes, %zu stale, %d errors",
+       numReads, numWrites, ring.getNumStale(), nErrors);
+
+  return nErrors;
+}
+
+int main(int argc, char** argv)
+{
+  int numWrites = 100000;
+  Rcs::CmdLineParser argP(argc, argv);
+  argP.getArgument("-dl", &RcsLogLevel, "Rcs log level");
+  argP.getArgument("-n", &numWrites, "Number of concurrent writes");
+
+  RcsGraph* src = createGraph(ringGraph);
+  RcsGraph* dst = RcsGraph_clone(src);
+
+  int nErrors = 0;
+  nErrors += testSequential(src, dst);
+  nErrors += testSizeMismatch(src);
+  nErrors += testConcurrent(src, dst, numWrites);
+
+  RcsGraph_destroy(src);
+  RcsGraph_destroy(dst);
+  xmlCleanupParser();
+
+  RLOG(0, "%d errors", nErrors);
+
+  return nErrors;
+}
@@ -159,7 +159,7 @@ PYBIND11_MODULE(pyAffaction, m)
   }, "Initializes algorithm, guis and graphics")
   .def("initHardwareComponents", [](aff::ExampleLLMSim& ex)
   {
-    ex.entity.initialize(ex.graphC->getGraph());
+    ex.initializeEntity();
   }, "Initializes hardware components")
   .def("run", &aff::ExampleLLMSim::startThreaded, py::call_guard<py::gil_scoped_release>(), "Starts endless loop")
   .def("run", [](aff::ExampleLLMSim& ex, std::string actionCommand)
@@ -216,7 +216,19 @@ PYBIND11_MODULE(pyAffaction, m)
   })
 
   .def("get_state", &aff::ExampleLLMSim::collectFeedback)
+  .def("get_state_delta", &aff::ExampleLLMSim::collectFeedbackSince, py::arg("version")=0,
+       py::call_guard<py::gil_scoped_release>(),
+       "Returns the changes of the state since the given version as json string. For version 0 or an unknown version, the full state including the static parts is returned")
   .def("get_scene_entities", &aff::ExampleLLMSim::getSceneEntities)
+  .def("validate", &aff::ExampleLLMSim::validateCommands, py::arg("commands"), py::arg("construct")=false,
+       py::call_guard<py::gil_scoped_release>(),
+       "Checks a list of action commands against the current scene without executing them. Returns a json string with one result per command. If construct is true, the actions are constructed including their solutions")
+  .def("validate", [](aff::ExampleLLMSim& ex, std::string command, bool construct)
+  {
+    py::gil_scoped_release release;
+    return ex.validateCommands(std::vector<std::string>(1, command), construct);
+  }, py::arg("command"), py::arg("construct")=false,
+  "Checks a single action command against the current scene without executing it")
   .def("step", &aff::ExampleActionsECS::step)
   .def("stop", &aff::ExampleActionsECS::stop)
   .def("isRunning", &aff::ExampleActionsECS::isRunning)
@@ -281,11 +293,33 @@ PYBIND11_MODULE(pyAffaction, m)
     return c ? true : false;
   })
   .def("getCompletedActionStack", &aff::ExampleActionsECS::getCompletedActionStack)
+  .def("setStageRate", [](aff::ExampleLLMSim& ex, std::string stage, double rate)
+  {
+    return ex.scheduler.setRate(stage, rate);
+  }, "Sets the rate of a loop stage in Hz, 0 is each step")
+  .def("setProfiling", [](aff::ExampleLLMSim& ex, bool enable)
+  {
+    ex.entity.setProfiling(enable);
+  })
+  .def("getProfile", [](aff::ExampleLLMSim& ex) -> nlohmann::json
+  {
+    return nlohmann::json::parse(ex.entity.getProfiler()->getSummary());
+  }, "Returns the per-event and per-subscriber timings")
+  .def("resetProfile", [](aff::ExampleLLMSim& ex)
+  {
+    ex.entity.getProfiler()->reset();
+  })
+  .def("writeProfileTrace", [](aff::ExampleLLMSim& ex, std::string fileName)
+  {
+    return ex.entity.getProfiler()->writeChromeTrace(fileName);
+  }, "Writes the recorded event timings in Chrome's trace-event format")
   .def_property("useWebsocket", &aff::ExampleLLMSim::getUseWebsocket, &aff::ExampleLLMSim::setUseWebsocket)
   .def_readwrite("unittest", &aff::ExampleLLMSim::unittest)
   .def_readwrite("noTextGui", &aff::ExampleLLMSim::noTextGui)
   .def_readwrite("sequenceCommand", &aff::ExampleLLMSim::sequenceCommand)
   .def_readwrite("speedUp", &aff::ExampleLLMSim::speedUp)
+  .def_readwrite("virtualTime", &aff::ExampleLLMSim::virtualTime)
+  .def_readwrite("parallelHardware", &aff::ExampleLLMSim::parallelHardware)
   .def_readwrite("xmlFileName", &aff::ExampleLLMSim::xmlFileName)
   .def_readwrite("noLimits", &aff::ExampleLLMSim::noLimits)
   .def_readwrite("noTrajCheck", &aff::ExampleLLMSim::noTrajCheck)
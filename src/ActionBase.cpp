@@ -31,6 +31,8 @@
 *******************************************************************************/
 
 #include "ActionBase.h"
+#include "BodyBVH.h"
+#include "TaskPrototypeCache.h"
 
 #include <TaskFactory.h>
 #include <Rcs_macros.h>
@@ -42,6 +44,7 @@
 #include <Rcs_parser.h>
 
 #include <ctype.h>
+#include <unordered_set>
 
 
 
@@ -84,30 +87,45 @@ double ActionBase::getDurationHint() const
   return defaultDuration;
 }
 
+std::vector<TaskDescriptor> ActionBase::createTaskDescriptors() const
+{
+  return std::vector<TaskDescriptor>();
+}
+
 size_t ActionBase::addTasks(Rcs::ControllerBase* controller) const
 {
-  std::vector<std::string> xmlTask = createTasksXML();
-  auto tasks = Rcs::TaskFactory::createTasks(xmlTask, controller->getGraph());
+  std::vector<Rcs::Task*> tasks;
+  std::vector<TaskDescriptor> descriptors = createTaskDescriptors();
+
+  if (descriptors.empty())
+  {
+    tasks = TaskPrototypeCache::createTasks(createTasksXML(), controller->getGraph());
+  }
+  else
+  {
+    tasks = TaskPrototypeCache::createTasks(descriptors, controller->getGraph());
+  }
   // std::vector<Rcs::Task*> tasks = createTasks(controller->getGraph());
 
+  std::unordered_set<std::string> taskNames;
+  for (size_t j = 0; j < controller->getNumberOfTasks(); ++j)
+  {
+    taskNames.insert(controller->getTaskName(j));
+  }
+
   // Check that all constructed tasks are valid
   size_t nTasksAdded = 0;
   for (size_t i = 0; i < tasks.size(); ++i)
   {
-    bool taskAlreadyExists = false;
-    for (size_t j = 0; j < controller->getNumberOfTasks(); ++j)
-    {
-      if (controller->getTaskName(j) == tasks[i]->getName())
-      {
-        taskAlreadyExists = true;
-      }
-    }
-
-    if (!taskAlreadyExists)
+    if (taskNames.insert(tasks[i]->getName()).second)
     {
       controller->add(tasks[i]);
       nTasksAdded++;
     }
+    else
+    {
+      delete tasks[i];
+    }
   }
 
   return nTasksAdded;
@@ -268,6 +286,30 @@ size_t ActionBase::getNumSolutions() const
   return 1;
 }
 
+double ActionBase::getSolutionCost(size_t solutionRank) const
+{
+  return (double) solutionRank;
+}
+
+bool ActionBase::getSolutionInfo(const ActionScene& domain,
+                                 const RcsGraph* graph,
+                                 size_t solutionRank,
+                                 SolutionInfo& info) const
+{
+  std::unique_ptr<ActionBase> action = clone();
+
+  if (!action->initialize(domain, graph, solutionRank))
+  {
+    return false;
+  }
+
+  info.manipulators = action->getManipulators();
+  info.objects.clear();
+  info.hasTarget = false;
+
+  return true;
+}
+
 const AffordanceEntity* ActionBase::raycastSurface(const ActionScene& domain,
                                                    const AffordanceEntity* ntt,
                                                    const RcsGraph* graph,
@@ -288,7 +330,7 @@ const AffordanceEntity* ActionBase::raycastSurface(const ActionScene& domain,
   RcsGraph_computeBodyAABB(graph, body->id, RCSSHAPE_COMPUTE_DISTANCE, xyzMin, xyzMax, NULL);
   Vec3d_set(castFrom, 0.5*(xyzMin[0]+xyzMax[0]), 0.5*(xyzMin[1]+xyzMax[1]), xyzMin[2]-1.0e-8);
   Vec3d_set(dir, 0.0, 0.0, -1.0);
-  const RcsBody* surfaceBdy = RcsBody_closestRigidBodyInDirection(graph, castFrom, dir, surfPt, &dMin);
+  const RcsBody* surfaceBdy = BodyBVH::threadInstance().raycast(graph, castFrom, dir, true, surfPt, &dMin);
 
   if (!surfaceBdy)
   {
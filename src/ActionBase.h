@@ -35,6 +35,7 @@
 
 #include "ActionScene.h"
 #include "TrajectoryPredictor.h"
+#include "TaskPrototypeCache.h"
 
 #include <ConstraintSet.h>
 #include <ControllerBase.h>
@@ -82,36 +83,36 @@ public:
     return msg.c_str();
   }
 
-  std::string err2str(ActionError e) const
+  ActionError getError() const
   {
-    // \todo(MG): somehow improve developer feeback msg.
-    return std::string();
-    std::string str;
+    return error;
+  }
 
+  static std::string errorName(ActionError e)
+  {
     switch (e)
     {
       case ParamNotFound:
-        str = "ParamNotFound: ";
-        break;
+        return "ParamNotFound";
 
       case ParamInvalid:
-        str = "ParamInvalid: ";
-        break;
+        return "ParamInvalid";
 
       case KinematicallyImpossible:
-        str = "KinematicallyImpossible: ";
-        break;
+        return "KinematicallyImpossible";
 
       case NoError:
-        str = "NoError: ";
-        break;
+        return "NoError";
 
       default:
-        str = "UnknownError: ";
-        break;
+        return "UnknownError";
     }
+  }
 
-    return str;
+  std::string err2str(ActionError) const
+  {
+    // \todo(MG): somehow improve developer feeback msg.
+    return std::string();
   }
 
 protected:
@@ -133,6 +134,11 @@ public:
   virtual std::vector<std::string> getManipulators() const = 0;
   virtual std::vector<std::string> createTasksXML() const = 0;
 
+  // Actions that describe their tasks with descriptors return them here, so
+  // that addTasks() can look them up without creating xml strings. The
+  // default returns an empty vector, and createTasksXML() is used.
+  virtual std::vector<TaskDescriptor> createTaskDescriptors() const;
+
   virtual tropic::TCS_sptr createTrajectory() const;
   virtual double getDurationHint() const;
   virtual std::string explain() const;
@@ -144,6 +150,26 @@ public:
   // Interface for prediction
   virtual bool initialize(const ActionScene& domain, const RcsGraph* graph, size_t solutionRank);
   virtual size_t getNumSolutions() const;
+  // Heuristic cost of a solution, lower is better. The solutions are
+  // already sorted by it, so the default is the rank itself.
+  virtual double getSolutionCost(size_t solutionRank) const;
+
+  // What a solution moves and where to. This is used for combining solutions
+  // of actions that are executed in parallel.
+  struct SolutionInfo
+  {
+    std::vector<std::string> manipulators;   // Moved by the solution
+    std::vector<std::string> objects;        // Bodies that are manipulated
+    bool hasTarget;                          // If targetPos is valid
+    double targetPos[3];                     // Goal of the motion in world
+  };
+
+  // The default initializes a clone with the solution and reports all its
+  // manipulators as moved. Actions with many solutions override it with a
+  // look-up of the data they computed in their constructor. Returns false
+  // if the solution is not valid.
+  virtual bool getSolutionInfo(const ActionScene& domain, const RcsGraph* graph,
+                               size_t solutionRank, SolutionInfo& info) const;
   virtual TrajectoryPredictor::PredictionResult predict(const RcsGraph* graph, const RcsBroadPhase* broadphase, double duration, double dt) const;
 
 protected:
@@ -65,7 +65,9 @@ namespace aff
 
 ActionComponent::ActionComponent(EntityBase* parent, const RcsGraph* graph_,
                                  const RcsBroadPhase* broadphase_) :
-  ComponentBase(parent), graph(graph_), broadphase(broadphase_), limitsEnabled(true),
+  ComponentBase(parent), graph(graph_), broadphase(broadphase_), snapshots(NULL),
+  limitsEnabled(true),
+  multiThreaded(true), blending(false), trajectoryMoving(false),
   animationGraph(NULL), animationTic(0), animationIdx(-1)
 {
   subscribe("TextCommand", &ActionComponent::onTextCommand);
@@ -74,6 +76,7 @@ ActionComponent::ActionComponent(EntityBase* parent, const RcsGraph* graph_,
   subscribe("ToggleFastPrediction", &ActionComponent::onToggleFastPrediction);
   subscribe("SetDebugRendering", &ActionComponent::onSetDebugRendering);
   subscribe("Stop", &ActionComponent::onStop);
+  subscribe("TrajectoryMoving", &ActionComponent::onTrajectoryMoving);
 
   this->domain = ActionScene::parse(graph->cfgFile);
   RCHECK(domain.check(graph));
@@ -94,10 +97,100 @@ ActionComponent::~ActionComponent()
 
 void ActionComponent::onStop()
 {
+  // Release an actionThread that waits for the end of a motion
+  onTrajectoryMoving(false);
+
   // Wait until the actionThread has finished
   std::lock_guard<std::mutex> lock(actionThreadMtx);
 }
 
+void ActionComponent::onTrajectoryMoving(bool isMoving)
+{
+  std::lock_guard<std::mutex> lock(motionMtx);
+  trajectoryMoving = isMoving;
+
+  if (!isMoving)
+  {
+    movingManipulators.clear();
+    motionCv.notify_all();
+  }
+}
+
+bool ActionComponent::waitForManipulators(const std::vector<std::string>& manipulators)
+{
+  std::unique_lock<std::mutex> lock(motionMtx);
+
+  auto isFree = [this, &manipulators]()
+  {
+    if (!trajectoryMoving)
+    {
+      return true;
+    }
+
+    for (const auto& m : manipulators)
+    {
+      if (movingManipulators.find(m) != movingManipulators.end())
+      {
+        return false;
+      }
+    }
+
+    return true;
+  };
+
+  if (isFree())
+  {
+    return false;
+  }
+
+  RLOG(0, "Waiting for the moving trajectory to release the manipulators");
+  motionCv.wait(lock, isFree);
+
+  return true;
+}
+
+/*******************************************************************************
+ * If the loop doesn't publish a new snapshot, it is not stepping and NULL is
+ * returned, so that the caller uses our graph.
+ ******************************************************************************/
+std::shared_ptr<const StateSnapshot> ActionComponent::getSnapshot() const
+{
+  if (!snapshots)
+  {
+    return nullptr;
+  }
+
+  const size_t prevVersion = snapshots->getVersion();
+  std::shared_ptr<const StateSnapshot> snap = snapshots->get();
+
+  if (snap && (snap->version == prevVersion))
+  {
+    snap.reset();
+  }
+
+  return snap;
+}
+
+std::unique_ptr<ActionBase> ActionComponent::createAction(const std::string& text,
+                                                          const RcsGraph* graph,
+                                                          std::string& explanation) const
+{
+  std::vector<std::string> actionStrings = Rcs::String_split(text, "+");
+
+  // We are here if a '+' has been detected in the command string. This is a
+  // parallel action where the actions that are separated by the '+' sign get
+  // instantiated by the MultiStringAction.
+  if (actionStrings.size()>1)
+  {
+    actionStrings.insert(actionStrings.begin(), "multi_string");
+    return std::unique_ptr<ActionBase>(ActionFactory::create(domain, graph, actionStrings, explanation));
+  }
+
+  // This is the "normal" action that only has space-separated words.
+  std::vector<std::string> words = Rcs::String_split(text, " ");
+  return std::unique_ptr<ActionBase>(ActionFactory::create(domain, graph, words, explanation));
+}
+
 void ActionComponent::onTextCommand(std::string text)
 {
   RMSG_CPP("RECEIVED: " << text);
@@ -108,7 +201,7 @@ void ActionComponent::onTextCommand(std::string text)
 
   // reset and get_state are taken care of somewhere else
   //if ((text!="reset") && (text!="get_state"))
-  if ((!STRNEQ(text.c_str(), "reset", 5)) && (text!="get_state"))
+  if ((!STRNEQ(text.c_str(), "reset", 5)) && (!STRNEQ(text.c_str(), "get_state", 9)))
   {
     std::thread t1(&ActionComponent::actionThread, this, text);
     t1.detach();
@@ -126,23 +219,23 @@ void ActionComponent::actionThread(std::string text)
   // Reentrancy lock
   std::lock_guard<std::mutex> lock(actionThreadMtx);
 
+  // The snapshot is kept alive until the end of this function.
+  std::shared_ptr<const StateSnapshot> snap = getSnapshot();
+  const RcsGraph* graph = snap ? snap->graph : this->graph;
+
   std::string explanation = "Success";
-  std::vector<std::string> actionStrings = Rcs::String_split(text, "+");
-  std::unique_ptr<ActionBase> action;
+  std::unique_ptr<ActionBase> action = createAction(text, graph, explanation);
 
-  // We are here if a '+' has been detected in the command string. This is a
-  // parallel action where the actions that are separated by the '+' sign get
-  // instantiated by the MultiStringAction.
-  if (actionStrings.size()>1)
-  {
-    actionStrings.insert(actionStrings.begin(), "multi_string");
-    action = std::unique_ptr<ActionBase>(ActionFactory::create(domain, graph, actionStrings, explanation));
-  }
-  // This is the "normal" action that only has space-separated words.
-  else
+  // With blending, the previous action might still be moving. If it uses our
+  // manipulators, we wait for it and create the action again from a snapshot
+  // of the state where the motion ended. This might select other
+  // manipulators.
+  while (action && getBlending() && waitForManipulators(action->getManipulators()))
   {
-    std::vector<std::string> words = Rcs::String_split(text, " ");
-    action = std::unique_ptr<ActionBase>(ActionFactory::create(domain, graph, words, explanation));
+    snap = getSnapshot();
+    graph = snap ? snap->graph : this->graph;
+    explanation = "Success";
+    action = createAction(text, graph, explanation);
   }
 
   // Early exit if the action could not be created. The particular reason
@@ -155,6 +248,7 @@ void ActionComponent::actionThread(std::string text)
 
 
   bool predictMe = true;
+  std::vector<std::string> activeJoints;   // Joints used by the best prediction
 
   if (predictMe)
   {
@@ -181,7 +275,7 @@ void ActionComponent::actionThread(std::string text)
         const ActionBase* aPtr = action.get();
 
         //futures.push_back(predictExecutor.enqueue([i, this, localAction = std::move(localAction), &predResults]
-        futures.push_back(predictExecutor.enqueue([i, this, aPtr, &predResults]
+        futures.push_back(predictExecutor.enqueue([i, this, aPtr, graph, &predResults]
         {
           auto localAction = aPtr->clone();
           RLOG_CPP(0, "Starting prediction " << i+1 << " from " << localAction->getNumSolutions());
@@ -295,6 +389,19 @@ void ActionComponent::actionThread(std::string text)
     RLOG_CPP(0, "Initializing with solution " << predResults[0].idx);
     action->initialize(domain, graph, predResults[0].idx);
 
+    // The joint mask is indexed like the Jacobian of the prediction graph,
+    // which has the topology of our graph.
+    if (predResults[0].success && (predResults[0].jMask.size()==graph->nJ))
+    {
+      RCSGRAPH_FOREACH_JOINT(graph)
+      {
+        if ((!JNT->constrained) && (predResults[0].jMask[JNT->jacobiIndex]>0.0))
+        {
+          activeJoints.push_back(JNT->name);
+        }
+      }
+    }
+
     // Memorize the predictions for debug visualization. This runs concurrently
     // with the onRender method, so we are quick about it with swapping, and
     // make it mutually exclusive.
@@ -380,6 +487,22 @@ void ActionComponent::actionThread(std::string text)
   getEntity()->publish("FreezePerception", true);
   getEntity()->publish<std::string, std::string>("RenderCommand", "BackgroundColor", "BLACK");
   getEntity()->publish("ChangeTaskVector", taskVec, action->getManipulators());
+
+  // The IK must not freeze the joints of a trajectory we blend into.
+  bool blended = false;
+  {
+    std::lock_guard<std::mutex> lock(motionMtx);
+    blended = trajectoryMoving;
+    for (const auto& m : action->getManipulators())
+    {
+      movingManipulators.insert(m);
+    }
+  }
+
+  if (!activeJoints.empty() && !blended)
+  {
+    getEntity()->publish("SetActiveJoints", activeJoints);
+  }
   getEntity()->publish("CheckAndSetTrajectory", tSet);
 }
 
@@ -413,6 +536,21 @@ bool ActionComponent::getMultiThreaded() const
   return multiThreaded;
 }
 
+void ActionComponent::setBlending(bool enable)
+{
+  blending = enable;
+}
+
+bool ActionComponent::getBlending() const
+{
+  return blending;
+}
+
+void ActionComponent::setSnapshotBuffer(StateSnapshotBuffer* snapshots_)
+{
+  snapshots = snapshots_;
+}
+
 void ActionComponent::onToggleFastPrediction()
 {
   animationTic = 0;
@@ -35,13 +35,20 @@
 
 #include "ComponentBase.h"
 #include "ActionScene.h"
+#include "StateSnapshot.h"
 
 #include <ControllerBase.h>
 #include <TrajectoryPredictor.h>
 
+#include <condition_variable>
+#include <memory>
+#include <set>
+
 namespace aff
 {
 
+class ActionBase;
+
 class ActionComponent : public ComponentBase
 {
 public:
@@ -57,6 +64,21 @@ public:
   bool getLimitCheck() const;
   bool getMultiThreaded() const;
 
+  /*! \brief Enables accepting actions while a trajectory is still moving. An
+   *         action that shares a manipulator with the moving trajectory
+   *         waits until the motion has finished, so that it is predicted
+   *         from where the previous action ended. Actions with disjoint
+   *         manipulators are predicted and started right away.
+   */
+  void setBlending(bool enable);
+  bool getBlending() const;
+
+  /*! \brief If set, the actions are created and predicted from a snapshot
+   *         of the graph instead of the graph passed to the constructor,
+   *         which is concurrently modified by the control loop.
+   */
+  void setSnapshotBuffer(StateSnapshotBuffer* snapshots);
+
 private:
 
   void onTextCommand(std::string text);
@@ -65,13 +87,27 @@ private:
   void onToggleFastPrediction();
   void onSetDebugRendering(bool enable);
   void onStop();
+  void onTrajectoryMoving(bool isMoving);
+  bool waitForManipulators(const std::vector<std::string>& manipulators);
+  std::shared_ptr<const StateSnapshot> getSnapshot() const;
+  std::unique_ptr<ActionBase> createAction(const std::string& text,
+                                           const RcsGraph* graph,
+                                           std::string& explanation) const;
 
   void actionThread(std::string text);
   ActionScene domain;
   const RcsGraph* graph;
   const RcsBroadPhase* broadphase;
+  StateSnapshotBuffer* snapshots;
   bool limitsEnabled;
   bool multiThreaded;
+  bool blending;
+
+  // Manipulators of the moving trajectory, for blending
+  std::set<std::string> movingManipulators;
+  bool trajectoryMoving;
+  std::mutex motionMtx;
+  std::condition_variable motionCv;
 
   // For animation of predictions
   std::vector<TrajectoryPredictor::PredictionResult> predictions;
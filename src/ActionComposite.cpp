@@ -49,6 +49,8 @@
 
 #include <limits>
 #include <algorithm>
+#include <queue>
+#include <set>
 
 
 namespace aff
@@ -65,7 +67,8 @@ ActionComposite::~ActionComposite()
 {
 }
 
-ActionComposite::ActionComposite(const ActionComposite& other) 
+ActionComposite::ActionComposite(const ActionComposite& other) :
+  ActionBase(other), solutions(other.solutions), conflict(other.conflict)
 {
   for (const auto& action : other.actions) {
       actions.push_back(action->clone());
@@ -146,6 +149,212 @@ std::vector<std::string> ActionComposite::getManipulators() const
   return mVec;
 }
 
+size_t ActionComposite::getNumSolutions() const
+{
+  return solutions.empty() ? 1 : solutions.size();
+}
+
+double ActionComposite::getSolutionCost(size_t solutionRank) const
+{
+  if (solutions.empty())
+  {
+    return ActionBase::getSolutionCost(solutionRank);
+  }
+
+  double cost = 0.0;
+  for (size_t i = 0; i < actions.size(); ++i)
+  {
+    cost += actions[i]->getSolutionCost(solutions[solutionRank][i]);
+  }
+
+  return cost;
+}
+
+bool ActionComposite::initialize(const ActionScene& domain,
+                                 const RcsGraph* graph,
+                                 size_t solutionRank)
+{
+  if (solutions.empty())
+  {
+    return ActionBase::initialize(domain, graph, solutionRank);
+  }
+
+  if (solutionRank >= solutions.size())
+  {
+    return false;
+  }
+
+  bool success = true;
+  for (size_t i = 0; i < actions.size(); ++i)
+  {
+    success = actions[i]->initialize(domain, graph, solutions[solutionRank][i]) && success;
+  }
+
+  return success;
+}
+
+/*******************************************************************************
+ * Best-first enumeration of the cross product of the sub-action solutions.
+ * Starting from the combination of all first-ranked solutions, each popped
+ * combination pushes its neighbors that have one sub-action rank increased
+ * by one. Since the costs are monotonic in the rank, the combinations are
+ * popped in the order of increasing summed cost without enumerating the full
+ * cross product. The SolutionInfo of each sub-action solution is looked up
+ * once. Two solutions conflict if they move a common manipulator, if they
+ * manipulate the same object (this would be a hand-over, which needs to be
+ * sequenced), or if their targets are so close that the hands would collide.
+ * Collisions along the way are left to the prediction of each combination.
+ * The conflict of the cheapest combination is kept to explain a failure.
+ ******************************************************************************/
+static std::string findConflict(const ActionBase::SolutionInfo& a,
+                                const ActionBase::SolutionInfo& b)
+{
+  // Approximate distance below which two hands collide at their targets
+  const double minTargetDistance = 0.1;
+
+  for (const auto& m : a.manipulators)
+  {
+    if (std::find(b.manipulators.begin(), b.manipulators.end(), m) != b.manipulators.end())
+    {
+      return "they both need the " + m;
+    }
+  }
+
+  for (const auto& o : a.objects)
+  {
+    if (std::find(b.objects.begin(), b.objects.end(), o) != b.objects.end())
+    {
+      return "they both manipulate the " + o;
+    }
+  }
+
+  if (a.hasTarget && b.hasTarget &&
+      (Vec3d_distance(a.targetPos, b.targetPos) < minTargetDistance))
+  {
+    return "their targets are so close to each other that the hands would collide";
+  }
+
+  return std::string();
+}
+
+size_t ActionComposite::computeSolutions(const ActionScene& domain,
+                                         const RcsGraph* graph,
+                                         size_t maxSolutions)
+{
+  typedef std::pair<double, std::vector<size_t>> Candidate;
+
+  solutions.clear();
+  conflict.clear();
+
+  if (actions.empty())
+  {
+    return 0;
+  }
+
+  // Per sub-action and rank: 0 not yet looked up, 1 valid, -1 invalid
+  std::vector<std::vector<ActionBase::SolutionInfo>> infos(actions.size());
+  std::vector<std::vector<int>> infoState(actions.size());
+  for (size_t i = 0; i < actions.size(); ++i)
+  {
+    infos[i].resize(actions[i]->getNumSolutions());
+    infoState[i].resize(infos[i].size(), 0);
+    if (infos[i].empty())
+    {
+      conflict = "one of them has no solution";
+      return 0;
+    }
+  }
+
+  auto isValid = [&](size_t i, size_t rank)
+  {
+    int& state = infoState[i][rank];
+    if (state == 0)
+    {
+      state = actions[i]->getSolutionInfo(domain, graph, rank, infos[i][rank]) ? 1 : -1;
+    }
+    return state == 1;
+  };
+
+  auto cost = [&](const std::vector<size_t>& ranks)
+  {
+    double c = 0.0;
+    for (size_t i = 0; i < ranks.size(); ++i)
+    {
+      c += actions[i]->getSolutionCost(ranks[i]);
+    }
+    return c;
+  };
+
+  std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> queue;
+  std::set<std::vector<size_t>> visited;
+  std::vector<size_t> first(actions.size(), 0);
+  queue.push(Candidate(cost(first), first));
+  visited.insert(first);
+
+  // Bounds the work if most combinations are in conflict
+  const size_t maxExpansions = 32*maxSolutions;
+  size_t numExpansions = 0;
+
+  while (!queue.empty() && (solutions.size() < maxSolutions) &&
+         (numExpansions < maxExpansions))
+  {
+    std::vector<size_t> ranks = queue.top().second;
+    queue.pop();
+    numExpansions++;
+
+    bool valid = true;
+    std::string reason;
+    for (size_t i = 0; i < ranks.size() && valid; ++i)
+    {
+      valid = isValid(i, ranks[i]);
+
+      if (!valid)
+      {
+        reason = "one of them has no valid solution";
+      }
+
+      for (size_t j = 0; j < i && valid; ++j)
+      {
+        reason = findConflict(infos[i][ranks[i]], infos[j][ranks[j]]);
+        valid = reason.empty();
+      }
+    }
+
+    if (!valid && conflict.empty())
+    {
+      conflict = reason;
+    }
+
+    if (valid)
+    {
+      solutions.push_back(ranks);
+    }
+
+    for (size_t i = 0; i < ranks.size(); ++i)
+    {
+      if (ranks[i]+1 < actions[i]->getNumSolutions())
+      {
+        std::vector<size_t> next = ranks;
+        next[i]++;
+        if (visited.insert(next).second)
+        {
+          queue.push(Candidate(cost(next), next));
+        }
+      }
+    }
+  }
+
+  RLOG(0, "Found %zu conflict-free solutions in %zu of the combinations",
+       solutions.size(), numExpansions);
+
+  return solutions.size();
+}
+
+std::string ActionComposite::getConflict() const
+{
+  return conflict.empty() ? std::string("they are in conflict") : conflict;
+}
+
 
 
 
@@ -389,6 +598,21 @@ public:
       throw std::invalid_argument("Failed to create ActionMultiString");
     }
 
+    for (const auto& a : actions)
+    {
+      if (!a)
+      {
+        throw ActionException(explanation, ActionException::ParamInvalid);
+      }
+    }
+
+    if (computeSolutions(domain, graph)==0)
+    {
+      throw ActionException("ERROR REASON: The actions can't be done at the same time, since " + getConflict() +
+                            ". SUGGESTION: Do them one after the other",
+                            ActionException::KinematicallyImpossible);
+    }
+
     explanation = "Doing parallel multi-action";
   }
 
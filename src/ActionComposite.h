@@ -56,9 +56,30 @@ public:
   void addAction(ActionBase* action);
   std::vector<std::string> getManipulators() const;
 
+  // A solution is a combination of one solution of each sub-action. Before
+  // computeSolutions() is called, there is one solution in which each
+  // sub-action keeps its own first-ranked solution.
+  size_t getNumSolutions() const;
+  double getSolutionCost(size_t solutionRank) const;
+  bool initialize(const ActionScene& domain, const RcsGraph* graph, size_t solutionRank);
+
+  // Enumerates the combinations of sub-action solutions in the order of
+  // their summed cost, and keeps the first maxSolutions ones in which no two
+  // sub-action solutions conflict, see ActionBase::SolutionInfo. Returns the
+  // number of solutions.
+  size_t computeSolutions(const ActionScene& domain, const RcsGraph* graph,
+                          size_t maxSolutions=16);
+
+  // Why the cheapest combination of the last computeSolutions() call is not
+  // possible, e.g. "they both need the hand_right". Meant to complete "The
+  // actions can't be done at the same time, since ...".
+  std::string getConflict() const;
+
 protected:
 
   std::vector<std::unique_ptr<ActionBase>> actions;
+  std::vector<std::vector<size_t>> solutions;   // Sub-action ranks per solution
+  std::string conflict;
 };
 
 }   // namespace aff
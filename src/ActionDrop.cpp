@@ -32,6 +32,7 @@
 
 #include "ActionDrop.h"
 #include "ActionFactory.h"
+#include "PlacementSampler.h"
 #include "ActivationSet.h"
 #include "VectorConstraint.h"
 #include <ConnectBodyConstraint.h>
@@ -133,17 +134,57 @@ ActionDrop::ActionDrop(const ActionScene& domain,
   // sorted in order to find out the best support surface to drop the object
   // on. It's going to be the closest one.
   auto supportSurfaces = getAffordances<Supportable>(surface);
+  if (supportSurfaces.empty())
+  {
+    throw ActionException("ActionDrop: Cannot drop object on " + surface->name,
+                          ActionException::ParamNotFound);
+  }
+
+  // The object falls straight down, so that we skip the support surfaces on
+  // which the area below the object is already occupied.
+  const RcsBody* dropBdy = RcsGraph_getBodyByName(graph, objectToDrop.c_str());
+  RCHECK(dropBdy);
+  const RcsBody* handBdy = RcsGraph_getBodyByName(graph, graspingHand->name.c_str());
+  PlacementSampler sampler(graph, dropBdy, std::vector<const RcsBody*> {handBdy});
+
+  size_t numFramesMissing = 0;
+
   for (Affordance* affordance : supportSurfaces)
   {
-    affordanceMap.emplace_back(std::make_tuple(affordance, (Capability*)graspCapability));
+    const RcsBody* supportFrame = RcsGraph_getBodyByName(graph, affordance->frame.c_str());
+
+    if (!supportFrame)
+    {
+      RLOG(1, "Support frame \"%s\" not found in graph - skipping it",
+           affordance->frame.c_str());
+      numFramesMissing++;
+      continue;
+    }
+
+    double dropPos[3];
+    Vec3d_invTransform(dropPos, &supportFrame->A_BI, dropBdy->A_BI.org);
+    dropPos[2] = 0.0;
+
+    if (sampler.isFree(supportFrame, dropPos))
+    {
+      affordanceMap.emplace_back(std::make_tuple(affordance, (Capability*)graspCapability));
+    }
   }
 
-  if (affordanceMap.empty())
+  if (numFramesMissing == supportSurfaces.size())
   {
-    throw ActionException("ActionDrop: Cannot drop object on " + surface->name,
+    throw ActionException("ERROR: Can't drop the " + objectToDrop + " REASON: The " +
+                          surface->name + " has no support surface in the scene model",
                           ActionException::ParamNotFound);
   }
 
+  if (affordanceMap.empty())
+  {
+    throw ActionException("ERROR: Can't drop the " + objectToDrop + " REASON: There is already something below it on the " +
+                          surface->name + " SUGGESTION: Move it to a free place before dropping it",
+                          ActionException::KinematicallyImpossible);
+  }
+
   // We have one or several matches and sort them according to their cost. Lower
   // costs pairs are at the beginning.
   sort(graph, affordanceMap, 1.0, 0.0);
@@ -31,10 +31,14 @@
 *******************************************************************************/
 
 #include "ActionFactory.h"
+#include "ConcurrentExecutor.h"
 
 #include <Rcs_macros.h>
 #include <Rcs_parser.h>
 #include <Rcs_stlParser.h>
+#include <Rcs_utilsCPP.h>
+
+#include <algorithm>
 
 
 namespace aff
@@ -94,8 +98,23 @@ ActionBase* ActionFactory::create(const ActionScene& domain,
                                   std::string actionName,
                                   std::vector<std::string> params,
                                   std::string& explanation)
+{
+  ActionException::ActionError error;
+  return construct(domain, graph, actionName, params, explanation, error);
+}
+
+/*******************************************************************************
+ *
+ ******************************************************************************/
+ActionBase* ActionFactory::construct(const ActionScene& domain,
+                                     const RcsGraph* graph,
+                                     std::string actionName,
+                                     std::vector<std::string> params,
+                                     std::string& explanation,
+                                     ActionException::ActionError& error)
 {
   ActionBase* action = NULL;
+  error = ActionException::NoError;
 
   std::map<std::string, ActionMaker>::iterator it;
   it = constructorMap().find(actionName);
@@ -103,6 +122,7 @@ ActionBase* ActionFactory::create(const ActionScene& domain,
   if (it == constructorMap().end())
   {
     explanation = "ERROR REASON: The action " +  actionName + " does not exist";
+    error = ActionException::ParamNotFound;
     RLOG_CPP(1, explanation);
     return NULL;
   }
@@ -113,15 +133,24 @@ ActionBase* ActionFactory::create(const ActionScene& domain,
     action->setName(actionName);
     action->setActionParams(params);
   }
+  catch (const ActionException& ex)
+  {
+    explanation = ex.what();
+    error = ex.getError();
+    RLOG_CPP(1, explanation);
+    action = NULL;
+  }
   catch (const std::exception& ex)
   {
     explanation = ex.what();
+    error = ActionException::UnknownError;
     RLOG_CPP(1, explanation);
     action = NULL;
   }
   catch (...)
   {
     explanation = "Failed to create action: unknown reason";
+    error = ActionException::UnknownError;
     RLOG_CPP(1, explanation);
     action = NULL;
   }
@@ -129,6 +158,217 @@ ActionBase* ActionFactory::create(const ActionScene& domain,
   return action;
 }
 
+/*******************************************************************************
+ * Actions such as pour modify the scene they are constructed with. Therefore
+ * the commands are always validated on a copy of the scene, which shares the
+ * affordances with the original until they are detached.
+ ******************************************************************************/
+ActionFactory::ValidationResult ActionFactory::validate(const ActionScene& domain,
+                                                        const RcsGraph* graph,
+                                                        const std::string& command,
+                                                        bool construct)
+{
+  ActionScene scene = domain;
+  return validateInScene(scene, graph, command, construct);
+}
+
+/*******************************************************************************
+ *
+ ******************************************************************************/
+ActionFactory::ValidationResult ActionFactory::validateInScene(ActionScene& scene,
+                                                               const RcsGraph* graph,
+                                                               const std::string& command,
+                                                               bool construct)
+{
+  ValidationResult res;
+  res.command = command;
+  res.valid = false;
+  res.error = ActionException::NoError;
+  res.numSolutions = 0;
+
+  // Same splitting as in ActionComponent::actionThread()
+  std::vector<std::string> words = Rcs::String_split(command, "+");
+
+  if (words.size()>1)
+  {
+    words.insert(words.begin(), "multi_string");
+  }
+  else
+  {
+    words = Rcs::String_split(command, " ");
+  }
+
+  if (words.empty())
+  {
+    res.error = ActionException::ParamInvalid;
+    res.explanation = "ERROR REASON: Received empty action command";
+    return res;
+  }
+
+  std::string actionName = words[0];
+  words.erase(words.begin());
+
+  // Fast path: Each action of a parallel command is checked on its own
+  if (!construct)
+  {
+    std::vector<std::string> actionCommands(1, command);
+
+    if (actionName == "multi_string")
+    {
+      actionCommands = words;
+    }
+
+    for (const auto& actionCommand : actionCommands)
+    {
+      std::vector<std::string> params = Rcs::String_split(actionCommand, " ");
+
+      if (params.empty())
+      {
+        res.error = ActionException::ParamInvalid;
+        res.explanation = "ERROR REASON: Received empty action command";
+        return res;
+      }
+
+      const std::string name = params[0];
+      params.erase(params.begin());
+
+      if (!check(scene, graph, name, params, res))
+      {
+        return res;
+      }
+    }
+
+    res.valid = true;
+    res.explanation = "Parameters of " + command + " are valid";
+    return res;
+  }
+
+  std::unique_ptr<ActionBase> action(ActionFactory::construct(scene, graph, actionName, words,
+                                                              res.explanation, res.error));
+
+  if (!action)
+  {
+    return res;
+  }
+
+  res.numSolutions = action->getNumSolutions();
+
+  if (res.numSolutions==0)
+  {
+    res.error = ActionException::KinematicallyImpossible;
+    res.explanation = "ERROR REASON: No solution found for " + command;
+    return res;
+  }
+
+  res.valid = true;
+  res.explanation = action->explain();
+
+  return res;
+}
+
+/*******************************************************************************
+ *
+ ******************************************************************************/
+bool ActionFactory::check(ActionScene& scene,
+                          const RcsGraph* graph,
+                          const std::string& actionName,
+                          const std::vector<std::string>& params,
+                          ValidationResult& res)
+{
+  if (constructorMap().find(actionName) == constructorMap().end())
+  {
+    res.error = ActionException::ParamNotFound;
+    res.explanation = "ERROR REASON: The action " +  actionName + " does not exist";
+    return false;
+  }
+
+  auto it = checkerMap().find(actionName);
+
+  if (it == checkerMap().end())
+  {
+    std::unique_ptr<ActionBase> action(construct(scene, graph, actionName, params,
+                                                 res.explanation, res.error));
+    return action ? true : false;
+  }
+
+  try
+  {
+    it->second(scene, graph, params);
+  }
+  catch (const ActionException& ex)
+  {
+    res.explanation = ex.what();
+    res.error = ex.getError();
+  }
+  catch (const std::exception& ex)
+  {
+    res.explanation = ex.what();
+    res.error = ActionException::ParamInvalid;
+  }
+
+  return res.explanation.empty();
+}
+
+/*******************************************************************************
+ * The commands are split into one contiguous chunk per thread. Each thread
+ * works on its own copy of the graph, and each command on its own copy of the
+ * scene, so that the results don't depend on the order of the commands.
+ ******************************************************************************/
+std::vector<ActionFactory::ValidationResult>
+ActionFactory::validate(const ActionScene& domain,
+                        const RcsGraph* graph,
+                        const std::vector<std::string>& commands,
+                        size_t numThreads,
+                        bool construct)
+{
+  std::vector<ValidationResult> results(commands.size());
+
+  if (numThreads==0)
+  {
+    numThreads = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  numThreads = std::min(numThreads, commands.size());
+
+  if (numThreads<=1)
+  {
+    for (size_t i = 0; i < commands.size(); ++i)
+    {
+      results[i] = validate(domain, graph, commands[i], construct);
+    }
+
+    return results;
+  }
+
+  ConcurrentExecutor executor(numThreads);
+  std::vector<std::future<void>> futures;
+  const size_t chunkSize = (commands.size()+numThreads-1)/numThreads;
+
+  for (size_t start = 0; start < commands.size(); start += chunkSize)
+  {
+    const size_t end = std::min(start+chunkSize, commands.size());
+
+    futures.push_back(executor.enqueue([start, end, &domain, graph, &commands, &results, construct]
+    {
+      RcsGraph* graphCopy = RcsGraph_clone(graph);
+
+      for (size_t i = start; i < end; ++i)
+      {
+        results[i] = validate(domain, graphCopy, commands[i], construct);
+      }
+
+      RcsGraph_destroy(graphCopy);
+    }));
+  }
+
+  for (auto& f : futures)
+  {
+    f.wait();
+  }
+
+  return results;
+}
+
 /*******************************************************************************
  * This function is called through the registrar class. This happens before
  * main() is entered. Therefore, logging with debug levels doesn't make sense,
@@ -146,6 +386,14 @@ void ActionFactory::registerAction(std::string name, ActionMaker createFunction)
   constructorMap()[name] = createFunction;
 }
 
+/*******************************************************************************
+ * Called before main(), see registerAction().
+ ******************************************************************************/
+void ActionFactory::registerCheck(std::string name, ActionChecker checkFunction)
+{
+  checkerMap()[name] = checkFunction;
+}
+
 /*******************************************************************************
  *
  ******************************************************************************/
@@ -155,6 +403,15 @@ std::map<std::string, ActionFactory::ActionMaker>& ActionFactory::constructorMap
   return cm;
 }
 
+/*******************************************************************************
+ *
+ ******************************************************************************/
+std::map<std::string, ActionFactory::ActionChecker>& ActionFactory::checkerMap()
+{
+  static std::map<std::string, ActionFactory::ActionChecker> cm;
+  return cm;
+}
+
 
 
 }   // namespace tropic
@@ -63,6 +63,15 @@
 #define REGISTER_ACTION(Type, Name) \
   static aff::ActionFactoryRegistrar<Type> ACTION_UNIQUE(Type, __LINE__) (Name)
 
+/*! \brief Registers the static function Type::check for the fast path of
+ *         ActionFactory::validate(). It must throw the same ActionException
+ *         as the constructor for parameters that don't resolve in the scene,
+ *         but must not do any kinematic computations:
+ *         REGISTER_ACTION_CHECK(ActionPour, "pour");
+ */
+#define REGISTER_ACTION_CHECK(Type, Name) \
+  static aff::ActionCheckRegistrar ACTION_UNIQUE(Type, __LINE__) (Name, &Type::check)
+
 
 namespace aff
 {
@@ -84,6 +93,7 @@ namespace aff
 class ActionFactory
 {
   template <class T> friend class ActionFactoryRegistrar;
+  friend class ActionCheckRegistrar;
 
 public:
 
@@ -104,6 +114,48 @@ public:
                             std::vector<std::string> params,
                             std::string& explanation);
 
+  /*! \brief Result of validating an action command, see validate().
+   */
+  struct ValidationResult
+  {
+    std::string command;
+    bool valid;
+    ActionException::ActionError error;   // NoError if valid
+    std::string explanation;
+    size_t numSolutions;                  // Only set if constructed
+  };
+
+  /*! \brief Checks if the action command can be instantiated in the given
+   *         scene and graph. By default, only the action's registered check
+   *         function is called (see REGISTER_ACTION_CHECK). It resolves the
+   *         parameters, entities and affordances and matches them with the
+   *         capabilities, but doesn't run any kinematics. Actions without a
+   *         check function are constructed. Commands with a '+' are checked
+   *         per action.
+   *
+   *         If construct is true, the action is constructed in any case in
+   *         the same way as in create(), including its solutions. Commands
+   *         with a '+' are then validated as parallel actions. The action is
+   *         constructed with a copy of the scene, so that domain is never
+   *         modified.
+   */
+  static ValidationResult validate(const ActionScene& domain,
+                                   const RcsGraph* graph,
+                                   const std::string& command,
+                                   bool construct=false);
+
+  /*! \brief Validates all commands concurrently. Each command is validated
+   *         on its own copy of the scene, and each thread on its own copy
+   *         of the graph, which must not be modified during the call. The
+   *         results have the same order as the commands. If numThreads is 0,
+   *         it is determined from the hardware concurrency.
+   */
+  static std::vector<ValidationResult> validate(const ActionScene& domain,
+                                                const RcsGraph* graph,
+                                                const std::vector<std::string>& commands,
+                                                size_t numThreads=0,
+                                                bool construct=false);
+
   /*! \brief Prints out all registered actions to the console.
    */
   static void print();
@@ -129,7 +181,44 @@ private:
    */
   static void registerAction(std::string name, ActionMaker createFunction);
 
+  /*! \brief Signature of the check functions of the validation fast path.
+   *         They throw an ActionException if the parameters are invalid.
+   */
+  typedef void (*ActionChecker)(const ActionScene& domain,
+                                const RcsGraph* graph,
+                                std::vector<std::string> params);
+
+  static void registerCheck(std::string name, ActionChecker checkFunction);
+
+  /*! \brief Validates the command in the given scene, which might be
+   *         modified by the constructed action.
+   */
+  static ValidationResult validateInScene(ActionScene& scene,
+                                          const RcsGraph* graph,
+                                          const std::string& command,
+                                          bool construct);
+
+  /*! \brief Calls the check function of the action, or constructs it if
+   *         there is none. Returns false in case of failure.
+   */
+  static bool check(ActionScene& scene,
+                    const RcsGraph* graph,
+                    const std::string& actionName,
+                    const std::vector<std::string>& params,
+                    ValidationResult& res);
+
+  /*! \brief Constructs the action and returns the ActionException error
+   *         code in case of failure.
+   */
+  static ActionBase* construct(const ActionScene& domain,
+                               const RcsGraph* graph,
+                               std::string actionName,
+                               std::vector<std::string> params,
+                               std::string& explanation,
+                               ActionException::ActionError& error);
+
   static std::map<std::string, ActionFactory::ActionMaker>& constructorMap();
+  static std::map<std::string, ActionFactory::ActionChecker>& checkerMap();
 };
 
 
@@ -179,6 +268,20 @@ private:
   }
 };
 
+/*! \brief Registrar for the check functions of actions, see the macro
+ *         REGISTER_ACTION_CHECK.
+ */
+class ActionCheckRegistrar
+{
+public:
+
+  ActionCheckRegistrar(std::string className,
+                       ActionFactory::ActionChecker checkFunction)
+  {
+    ActionFactory::registerCheck(className, checkFunction);
+  }
+};
+
 }
 
 #endif // AFF_ACTIONFACTORY_H
@@ -46,6 +46,7 @@
 namespace aff
 {
 REGISTER_ACTION(ActionGaze, "gaze");
+REGISTER_ACTION_CHECK(ActionGaze, "gaze");
 
 ActionGaze::ActionGaze(const ActionScene& scene,
                        const RcsGraph* graph,
@@ -176,6 +177,52 @@ ActionGaze::~ActionGaze()
 {
 }
 
+/*******************************************************************************
+ * Same checks as in the constructor, without resolving the camera body.
+ ******************************************************************************/
+void ActionGaze::check(const ActionScene& scene,
+                       const RcsGraph* graph,
+                       std::vector<std::string> params)
+{
+  if (params.empty())
+  {
+    throw ActionException("ERROR REASON: The object to gaze at is not specified. SUGGESTION: Use an object name that is defined in the environment", ActionException::ParamNotFound);
+  }
+
+  if (scene.getAffordanceEntities(params[0]).empty())
+  {
+    const Agent* agent = scene.getAgent(params[0]);
+
+    if (!agent)
+    {
+      throw ActionException("ERROR REASON:: The agent or object " + params[0] + " is unknown. SUGGESTION: Use an object or agent name that is defined in the environment", ActionException::ParamNotFound);
+    }
+
+    bool hasHead = false;
+    for (const auto& manipulatorName : agent->manipulators)
+    {
+      const Manipulator* manipulator = scene.getManipulator(manipulatorName);
+      hasHead = hasHead || (manipulator && manipulator->type=="head");
+    }
+
+    if (!hasHead)
+    {
+      throw ActionException("ERROR REASON:: The agent has no gazing capability. SUGGESTION: Use an agent that can do this", ActionException::ParamNotFound);
+    }
+  }
+
+  for (const auto h : scene.getManipulatorsOfType("head"))
+  {
+    if (!h->getGazingFrame().empty())
+    {
+      return;
+    }
+  }
+
+  throw ActionException("FATAL_ERROR REASON: Can't find a head with gazing capability in the scene.",
+                        ActionException::ParamNotFound);
+}
+
 std::vector<std::string> ActionGaze::createTasksXML() const
 {
   std::vector<std::string> tasks;
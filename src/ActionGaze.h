@@ -49,6 +49,13 @@ public:
              const RcsGraph* graph,
              std::vector<std::string> params);
 
+  /*! \brief Validation fast path, see ActionFactory::validate(). Throws an
+   *         ActionException if there is no object or agent to gaze at.
+   */
+  static void check(const ActionScene& domain,
+                    const RcsGraph* graph,
+                    std::vector<std::string> params);
+
   virtual ~ActionGaze();
   std::unique_ptr<ActionBase> clone() const override;
 
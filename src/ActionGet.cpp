@@ -34,6 +34,7 @@
 #include "ActionFactory.h"
 #include "TrajectoryPredictor.h"
 #include "CollisionModelConstraint.h"
+#include "BodyBVH.h"
 
 #include <ActivationSet.h>
 #include <PositionConstraint.h>
@@ -58,6 +59,10 @@
 #define DEFAULT_LIFTHEIGHT (0.12)
 #define DEFAULT_PREGRASPDIST (0.2)
 #define LIFT_SAFETY_DISTANCE (0.05)   // Safety distance before colliding with object above
+#define NUM_GRASP_SAMPLES (16)       // Samples per axis or circle affordance
+#define MAX_GRASP_SAMPLES (6)        // Samples that are kept as solutions
+#define TOPGRASP_APPROACH_TILT (RCS_DEG2RAD(30.0))
+#define RIMGRASP_APPROACH_TILT (RCS_DEG2RAD(20.0))   // Matches the 160 deg hand inclination
 
 
 
@@ -68,12 +73,18 @@ namespace aff
  ******************************************************************************/
 REGISTER_ACTION(ActionGet, "get");
 REGISTER_ACTION(ActionGet, "id_6355842184f61faabb83cb1b");
+REGISTER_ACTION_CHECK(ActionGet, "get");
+REGISTER_ACTION_CHECK(ActionGet, "id_6355842184f61faabb83cb1b");
 
 
 ActionGet::ActionGet() :
   graspType(GraspType::Other), liftHeight(DEFAULT_LIFTHEIGHT), preGraspDist(DEFAULT_PREGRASPDIST),
   shoulderBase(0.0), handOver(false), isObjCollidable(false)
 {
+  Vec3d_setZero(approachPos);
+  Vec3d_setZero(graspPos);
+  approachPolar[0] = 0.0;
+  approachPolar[1] = 0.0;
 }
 
 ActionGet::ActionGet(const ActionScene& domain,
@@ -109,6 +120,152 @@ ActionGet::ActionGet(const ActionScene& domain,
   init(domain, graph, objectToGet, manipulator, whereFrom);
 }
 
+/*******************************************************************************
+ * Same parameter checks as in init(), but without the lift height raycast and
+ * the grasp sampling.
+ ******************************************************************************/
+void ActionGet::check(const ActionScene& domain,
+                      const RcsGraph* graph,
+                      std::vector<std::string> params)
+{
+  std::string whereFrom;
+
+  for (const std::string key : { "from", "liftHeight", "duration" })
+  {
+    auto it = std::find(params.begin(), params.end(), key);
+    if (it != params.end())
+    {
+      if (it+1 == params.end())
+      {
+        throw ActionException("ERROR REASON: The value of " + key + " is missing",
+                              ActionException::ParamInvalid);
+      }
+
+      if (key == "from")
+      {
+        whereFrom = *(it+1);
+      }
+      else
+      {
+        std::stod(*(it+1));
+      }
+
+      params.erase(it+1);
+      params.erase(it);
+    }
+  }
+
+  if (params.empty())
+  {
+    throw ActionException("ERROR REASON: The object to get is not specified. SUGGESTION: Use an object name that is defined in the environment",
+                          ActionException::ParamInvalid);
+  }
+
+  const std::string& objectToGet = params[0];
+  const std::string manipulator = params.size()>1 ? params[1] : std::string();
+  std::vector<const AffordanceEntity*> ntts = domain.getAffordanceEntities(objectToGet);
+
+  if (ntts.empty())
+  {
+    throw ActionException("ERROR REASON: The " + objectToGet + " is unknown. SUGGESTION: Use an object name that is defined in the environment",
+                          ActionException::ParamNotFound);
+  }
+
+  const Manipulator* specifiedHand = domain.getManipulator(manipulator);
+
+  if ((!manipulator.empty()) && (!specifiedHand))
+  {
+    throw ActionException("ERROR REASON: Can't find a hand with the name " + manipulator +
+                          " SUGGESTION: Use a hand name that is defined in the environment",
+                          ActionException::ParamNotFound);
+  }
+
+  const AffordanceEntity* entityToGet = ntts[0];
+
+  if (!whereFrom.empty())
+  {
+    const AffordanceEntity* fromNTT = domain.getAffordanceEntity(whereFrom);
+    const Manipulator* fromHand = domain.getManipulator(whereFrom);
+
+    if ((!fromNTT) && (!fromHand))
+    {
+      throw ActionException("ERROR REASON: The " + whereFrom + " is neither a hand nor a part of the environment SUGGESTION: Use an object name or a hand that is defined in the environment",
+                            ActionException::ParamNotFound);
+    }
+
+    const std::string fromBdyName = fromNTT ? fromNTT->bdyName : fromHand->name;
+    const RcsBody* bdyFrom = RcsGraph_getBodyByName(graph, fromBdyName.c_str());
+    entityToGet = NULL;
+
+    for (auto ntt : ntts)
+    {
+      const RcsBody* bdy = RcsGraph_getBodyByName(graph, ntt->bdyName.c_str());
+      if (bdy && bdyFrom && RcsBody_isChild(graph, bdy, bdyFrom))
+      {
+        entityToGet = ntt;
+      }
+    }
+
+    if (!entityToGet)
+    {
+      throw ActionException("ERROR REASON: The " + whereFrom + " is empty SUGGESTION: Use an alternative object",
+                            ActionException::ParamNotFound);
+    }
+  }
+  else
+  {
+    // Already held in the hand: The constructor succeeds without motion
+    for (auto ntt : ntts)
+    {
+      const Manipulator* graspingHand = domain.getGraspingHand(graph, ntt);
+      if (graspingHand && ((graspingHand == specifiedHand) || (!specifiedHand)))
+      {
+        return;
+      }
+    }
+  }
+
+  if (getAffordances<Graspable>(entityToGet).empty())
+  {
+    throw ActionException("ERROR REASON: " + objectToGet + " cannot be grasped",
+                          ActionException::ParamNotFound);
+  }
+
+  std::vector<const Manipulator*> freeManipulators;
+
+  if (specifiedHand)
+  {
+    if (!specifiedHand->isEmpty(graph))
+    {
+      throw ActionException("ERROR REASON: The hand " + manipulator + " is already holding an object SUGGESTION: Free your hand before performing this command, or use another hand",
+                            ActionException::ParamNotFound);
+    }
+
+    freeManipulators.push_back(specifiedHand);
+  }
+  else
+  {
+    freeManipulators = domain.getFreeManipulators(graph);
+  }
+
+  if (freeManipulators.empty())
+  {
+    throw ActionException("ERROR REASON: All hands are already full SUGGESTION: Free one or all your hands before performing this command",
+                          ActionException::KinematicallyImpossible);
+  }
+
+  for (const Manipulator* hand : freeManipulators)
+  {
+    if (!match<Graspable>(entityToGet, hand).empty())
+    {
+      return;
+    }
+  }
+
+  throw ActionException("ERROR REASON: The " + objectToGet + " cannot be grasped with the available hands. SUGGESTION: Use another hand or another object",
+                        ActionException::KinematicallyImpossible);
+}
+
 void ActionGet::init(const ActionScene& domain,
                      const RcsGraph* graph,
                      const std::string& objectToGet,
@@ -252,7 +409,7 @@ void ActionGet::init(const ActionScene& domain,
     Vec3d_copy(castFrom, objBdy->A_BI.org);   // Body origin in case no AABB can be determined.
   }
 
-  const RcsBody* surfaceBdy = RcsBody_closestRigidBodyInDirection(graph, castFrom, Vec3d_ez(), surfPt, &dMin);
+  const RcsBody* surfaceBdy = BodyBVH::threadInstance().raycast(graph, castFrom, Vec3d_ez(), true, surfPt, &dMin);
 
   if (surfaceBdy && !RcsBody_isChild(graph, surfaceBdy, objBdy))
   {
@@ -377,6 +534,9 @@ void ActionGet::init(const ActionScene& domain,
   }
 #endif
 
+  // Additional solutions from grasp poses that are not declared as frames
+  sampleGrasps(domain, graph, objBdy);
+
   // Initialize with the best solution.
   bool successInit = initialize(domain, graph, 0);
   RCHECK(successInit);
@@ -391,9 +551,23 @@ bool ActionGet::initialize(const ActionScene& domain,
     return false;
   }
 
+  // The ranks after the affordance map refer to the grasp samples
+  size_t mapIdx = solutionRank;
+  taskHandApproach.clear();
+  taskHandApproachOri.clear();
+
+  if (solutionRank >= affordanceMap.size())
+  {
+    const GraspSample& sample = graspSamples[solutionRank-affordanceMap.size()];
+    mapIdx = sample.mapIdx;
+    Vec3d_copy(approachPos, sample.approach);
+    Vec3d_copy(graspPos, sample.grasp);
+    approachPolar[0] = sample.polar[0];
+    approachPolar[1] = sample.polar[1];
+  }
 
   // Get the frame of the capability from the first entry
-  const Capability* winningCap = std::get<1>(affordanceMap[solutionRank]);
+  const Capability* winningCap = std::get<1>(affordanceMap[mapIdx]);
   capabilityFrame = winningCap->frame;
 
   // Get the hand that corresponds to the selected capability.
@@ -405,7 +579,7 @@ bool ActionGet::initialize(const ActionScene& domain,
   handClosed = std::vector<double>(hand->getNumFingers(), fingersClosed);
 
   // Get the frame of the affordance from the second capability
-  Affordance* winningAff = std::get<0>(affordanceMap[solutionRank]);
+  Affordance* winningAff = std::get<0>(affordanceMap[mapIdx]);
   affordanceFrame = winningAff->frame;
 
   if (dynamic_cast<PowerGraspable*>(winningAff))
@@ -496,9 +670,169 @@ bool ActionGet::initialize(const ActionScene& domain,
     this->taskHandOverHand = handOverHand + "_XYZ";
   }
 
+  if (solutionRank >= affordanceMap.size())
+  {
+    this->taskHandApproach = capabilityFrame + "-" + affordanceFrame + "-APPROACH";
+    this->taskHandApproachOri = capabilityFrame + "-" + affordanceFrame + "-APPROACH-POLAR";
+  }
+
   return true;
 }
 
+/*******************************************************************************
+ * The axis and circle affordances allow a continuum of grasps, of which the
+ * affordance frame only describes one. For each of them, we generate samples
+ * of the pre-grasp hand position:
+ * - PowerGraspable: Approach from the side, rotated around the z-axis
+ * - TwistGraspable: Approach from the top on a cone around the z-axis
+ * - CircularGraspable: Approach from the top at points along the rim
+ * The grasp point is the affordance frame origin for the axes, and the
+ * sampled point on the rim for circles. Rim grasps approach from outside with
+ * the tilt of the hand inclination of the rim grasp. The hand's x-axis points
+ * along the approach direction, which is stored as polar angles with respect
+ * to the affordance frame. The samples are scored by how well
+ * the approach direction aligns with the direction from the hand to the grasp
+ * point. Samples with a blocked approach path or a pre-grasp position inside
+ * another body are discarded. The best ones are kept and are predicted like
+ * the discrete solutions.
+ ******************************************************************************/
+void ActionGet::sampleGrasps(const ActionScene& domain,
+                             const RcsGraph* graph,
+                             const RcsBody* objBdy)
+{
+  graspSamples.clear();
+
+  // Bodies of the object and of the hands don't block the approach
+  auto isIgnored = [&](const RcsBody* bdy, const RcsBody* handBdy)
+  {
+    return (bdy == objBdy) || RcsBody_isChild(graph, bdy, objBdy) ||
+           (bdy == handBdy) || RcsBody_isChild(graph, bdy, handBdy);
+  };
+
+  BodyBVH& bvh = BodyBVH::threadInstance();
+
+  for (size_t i = 0; i < affordanceMap.size(); ++i)
+  {
+    const Affordance* aff = std::get<0>(affordanceMap[i]);
+    const Capability* cap = std::get<1>(affordanceMap[i]);
+    const bool isPower = dynamic_cast<const PowerGraspable*>(aff) != nullptr;
+    const bool isTwist = dynamic_cast<const TwistGraspable*>(aff) != nullptr;
+    const CircularGraspable* circ = dynamic_cast<const CircularGraspable*>(aff);
+
+    if (!isPower && !isTwist && !circ)
+    {
+      continue;
+    }
+
+    const RcsBody* affBdy = RcsGraph_getBodyByName(graph, aff->frame.c_str());
+    const RcsBody* capBdy = RcsGraph_getBodyByName(graph, cap->frame.c_str());
+
+    if (!affBdy || !capBdy)
+    {
+      continue;
+    }
+
+    const Manipulator* hand = domain.getManipulator(cap);
+    const RcsBody* handBdy = hand ? RcsGraph_getBodyByName(graph, hand->name.c_str()) : capBdy;
+
+    for (size_t k = 0; k < NUM_GRASP_SAMPLES; ++k)
+    {
+      const double phi = 2.0*M_PI*k/NUM_GRASP_SAMPLES;
+      const double cp = cos(phi), sp = sin(phi);
+      GraspSample sample;
+      sample.mapIdx = i;
+
+      if (circ)
+      {
+        const double r = 0.5*preGraspDist*sin(RIMGRASP_APPROACH_TILT);
+        Vec3d_set(sample.grasp, circ->radius*cp, circ->radius*sp, 0.0);
+        Vec3d_set(sample.approach, sample.grasp[0]+r*cp, sample.grasp[1]+r*sp,
+                  0.5*preGraspDist*cos(RIMGRASP_APPROACH_TILT));
+      }
+      else if (isTwist)
+      {
+        const double r = 0.5*preGraspDist*sin(TOPGRASP_APPROACH_TILT);
+        Vec3d_setZero(sample.grasp);
+        Vec3d_set(sample.approach, r*cp, r*sp, 0.5*preGraspDist*cos(TOPGRASP_APPROACH_TILT));
+      }
+      else
+      {
+        Vec3d_setZero(sample.grasp);
+        Vec3d_set(sample.approach, -preGraspDist*cp, -preGraspDist*sp, 0.0);
+      }
+
+      double dirLocal[3];
+      Vec3d_sub(dirLocal, sample.grasp, sample.approach);
+      Vec3d_normalizeSelf(dirLocal);
+      sample.polar[0] = acos(Math_clip(dirLocal[2], -1.0, 1.0));
+      sample.polar[1] = atan2(dirLocal[1], dirLocal[0]);
+
+      double approachI[3], graspI[3], dir[3], handDir[3];
+      Vec3d_transform(approachI, &affBdy->A_BI, sample.approach);
+      Vec3d_transform(graspI, &affBdy->A_BI, sample.grasp);
+      Vec3d_sub(dir, graspI, approachI);
+      const double approachLen = Vec3d_normalizeSelf(dir);
+      Vec3d_sub(handDir, graspI, capBdy->A_BI.org);
+      Vec3d_normalizeSelf(handDir);
+
+      // Approach path must not be blocked. Object and hand are passed
+      // through, so that bodies behind them are found.
+      double hitDist = 0.0;
+      const RcsBody* hitBdy = bvh.raycast(graph, approachI, dir, false, NULL, &hitDist,
+                                          [&](const RcsBody* bdy)
+      {
+        return isIgnored(bdy, handBdy);
+      });
+
+      if (hitBdy && (hitDist < approachLen))
+      {
+        continue;
+      }
+
+      // Pre-grasp position must not be inside another body
+      const double margin = 0.02;
+      double xyzMin[3], xyzMax[3];
+      for (int j = 0; j < 3; ++j)
+      {
+        xyzMin[j] = approachI[j] - margin;
+        xyzMax[j] = approachI[j] + margin;
+      }
+
+      bool overlaps = false;
+      for (int id : bvh.overlap(graph, xyzMin, xyzMax))
+      {
+        if (!isIgnored(RCSBODY_BY_ID(graph, id), handBdy))
+        {
+          overlaps = true;
+          break;
+        }
+      }
+
+      if (overlaps)
+      {
+        continue;
+      }
+
+      // 0 if the hand moves straight towards the grasp point, 1 if opposite
+      sample.cost = 0.5*(1.0-Vec3d_innerProduct(dir, handDir));
+      graspSamples.push_back(sample);
+    }
+  }
+
+  std::stable_sort(graspSamples.begin(), graspSamples.end(),
+                   [](const GraspSample& a, const GraspSample& b)
+  {
+    return a.cost < b.cost;
+  });
+
+  if (graspSamples.size() > MAX_GRASP_SAMPLES)
+  {
+    graspSamples.resize(MAX_GRASP_SAMPLES);
+  }
+
+  RLOG(1, "Keeping %zu grasp samples", graspSamples.size());
+}
+
 ActionGet::~ActionGet()
 {
 }
@@ -528,6 +862,27 @@ tropic::TCS_sptr ActionGet::createTrajectory(double t_start, double t_end) const
 
   RCHECK(a1);
 
+  // Sampled grasps prescribe the pre-grasp and grasp hand positions in the
+  // affordance frame. They replace the hand position constraints of the
+  // grasp type. The hand's x-axis is aligned with the sampled approach
+  // direction so that the palm faces the grasp point.
+  if (!taskHandApproach.empty())
+  {
+    a1->addActivation(t_start, true, 0.5, taskHandApproach);
+    a1->addActivation(t_grasp, false, 0.5, taskHandApproach);
+    a1->add(std::make_shared<tropic::PositionConstraint>(t_pregrasp, approachPos[0], approachPos[1],
+                                                         approachPos[2], taskHandApproach));
+    a1->add(std::make_shared<tropic::PositionConstraint>(t_grasp, graspPos[0], graspPos[1],
+                                                         graspPos[2], taskHandApproach));
+
+    a1->addActivation(t_start, true, 0.5, taskHandApproachOri);
+    a1->addActivation(t_grasp, false, 0.5, taskHandApproachOri);
+    a1->add(std::make_shared<tropic::PolarConstraint>(t_pregrasp, approachPolar[0], approachPolar[1],
+                                                      taskHandApproachOri));
+    a1->add(std::make_shared<tropic::PolarConstraint>(t_grasp, approachPolar[0], approachPolar[1],
+                                                      taskHandApproachOri));
+  }
+
   if ((!handOpen.empty()) && (!handClosed.empty()))
   {
     a1->addActivation(t_start, true, 0.5, taskFingers);
@@ -566,14 +921,17 @@ ActionGet::createTrajectory(double t_start,
   // Grasp the object and lift it up
   auto a1 = std::make_shared<tropic::ActivationSet>();
 
-  // Hand position with respect to object
+  // Hand position with respect to object. Sampled grasps use their own task.
   const double t_pregrasp = t_start + 0.5*(t_grasp-t_start);
-  a1->addActivation(t_start, true, 0.5, taskObjHandPos);
-  a1->addActivation(t_grasp, false, 0.5, taskObjHandPos);
-  a1->add(t_pregrasp, preGraspDist, 0.0, 0.0, 1, taskObjHandPos + " 0");// some distance in front
-  a1->add(t_pregrasp, 0.0, 0.0, 0.0, 7, taskObjHandPos + " 1");// and centered
-  a1->add(t_pregrasp, 0.0, 0.0, 0.0, 7, taskObjHandPos + " 2");// and adjusted height \todo check
-  a1->add(std::make_shared<tropic::PositionConstraint>(t_grasp, 0.0, 0.0, 0.0, taskObjHandPos));
+  if (taskHandApproach.empty())
+  {
+    a1->addActivation(t_start, true, 0.5, taskObjHandPos);
+    a1->addActivation(t_grasp, false, 0.5, taskObjHandPos);
+    a1->add(t_pregrasp, preGraspDist, 0.0, 0.0, 1, taskObjHandPos + " 0");// some distance in front
+    a1->add(t_pregrasp, 0.0, 0.0, 0.0, 7, taskObjHandPos + " 1");// and centered
+    a1->add(t_pregrasp, 0.0, 0.0, 0.0, 7, taskObjHandPos + " 2");// and adjusted height \todo check
+    a1->add(std::make_shared<tropic::PositionConstraint>(t_grasp, 0.0, 0.0, 0.0, taskObjHandPos));
+  }
 
   // Hand orientation with respect to object for the approach motion
   a1->addActivation(t_start, true, 0.5, taskHandObjOri);
@@ -688,18 +1046,25 @@ ActionGet::createTrajectoryTopGrasp(double t_start,
   // Grasp the object and lift it up
   auto a1 = std::make_shared<tropic::ActivationSet>();
 
-  // Hand position with respect to object
-  const double t_pregrasp = t_start + 0.5*(t_grasp-t_start);
-  a1->addActivation(t_start, true, 0.5, taskObjHandPos);
-  a1->addActivation(t_grasp, false, 0.5, taskObjHandPos);
-  a1->add(std::make_shared<tropic::PositionConstraint>(t_pregrasp, 0.0, 0.0, 0.5*preGraspDist, taskObjHandPos));
-  a1->add(std::make_shared<tropic::PositionConstraint>(t_grasp, 0.0, 0.0, 0.0, taskObjHandPos));
+  // Hand position with respect to object. Sampled grasps use their own task.
+  if (taskHandApproach.empty())
+  {
+    const double t_pregrasp = t_start + 0.5*(t_grasp-t_start);
+    a1->addActivation(t_start, true, 0.5, taskObjHandPos);
+    a1->addActivation(t_grasp, false, 0.5, taskObjHandPos);
+    a1->add(std::make_shared<tropic::PositionConstraint>(t_pregrasp, 0.0, 0.0, 0.5*preGraspDist, taskObjHandPos));
+    a1->add(std::make_shared<tropic::PositionConstraint>(t_grasp, 0.0, 0.0, 0.0, taskObjHandPos));
+  }
 
   // Hand orientation with respect to object for the approach motion
   a1->addActivation(t_start, true, 0.5, taskHandObjOri);
   a1->addActivation(t_grasp, false, 0.5, taskHandObjOri);
 
-  a1->add(std::make_shared<tropic::PolarConstraint>(t_grasp, M_PI, 0.0, taskHandObjOri));
+  // Sampled grasps keep the tilted approach direction until grasped
+  if (taskHandApproachOri.empty())
+  {
+    a1->add(std::make_shared<tropic::PolarConstraint>(t_grasp, M_PI, 0.0, taskHandObjOri));
+  }
   a1->add(std::make_shared<tropic::PolarConstraint>(t_end, M_PI, 0.0, taskHandObjOri));
 
   // Object orientation with respect to world frame. We keep it upright, but
@@ -754,13 +1119,16 @@ ActionGet::createTrajectoryRimGrasp(double t_start,
   // Grasp the object and lift it up
   auto a1 = std::make_shared<tropic::ActivationSet>();
 
-  // Hand position with respect to object
-  const double t_pregrasp = t_start + 0.5 * (t_grasp - t_start);
-  a1->addActivation(t_start, true, 0.5, taskObjHandPos);
-  a1->addActivation(t_grasp, false, 0.5, taskObjHandPos);
-  std::vector<double> rimCoords = {0.1, 0.1, 0.0, 0.0};
-  a1->add(std::make_shared<tropic::VectorConstraint>(t_pregrasp, rimCoords, taskObjHandPos));
-  a1->add(std::make_shared<tropic::VectorConstraint>(t_grasp, rimCoords, taskObjHandPos));
+  // Hand position with respect to object. Sampled grasps use their own task.
+  if (taskHandApproach.empty())
+  {
+    const double t_pregrasp = t_start + 0.5 * (t_grasp - t_start);
+    a1->addActivation(t_start, true, 0.5, taskObjHandPos);
+    a1->addActivation(t_grasp, false, 0.5, taskObjHandPos);
+    std::vector<double> rimCoords = {0.1, 0.1, 0.0, 0.0};
+    a1->add(std::make_shared<tropic::VectorConstraint>(t_pregrasp, rimCoords, taskObjHandPos));
+    a1->add(std::make_shared<tropic::VectorConstraint>(t_grasp, rimCoords, taskObjHandPos));
+  }
 
   // Hand inclination with respect to object. \todo(MG): Make inclination depend on object
   a1->addActivation(t_start, true, 0.5, taskHandObjOri);
@@ -834,6 +1202,16 @@ void ActionGet::print() const
     //CapabilityCompare::eval(graph, gmi, 1.0, 1.0));
   }
 
+  for (size_t i=0; i<graspSamples.size(); ++i)
+  {
+    const GraspSample& gs = graspSamples[i];
+    RLOG(0, "Solution %zu: %s - %s sampled at [%.3f %.3f %.3f] cost %.3f",
+         affordanceMap.size()+i,
+         std::get<0>(affordanceMap[gs.mapIdx])->frame.c_str(),
+         std::get<1>(affordanceMap[gs.mapIdx])->frame.c_str(),
+         gs.approach[0], gs.approach[1], gs.approach[2], gs.cost);
+  }
+
 }
 
 std::vector<std::string> ActionGet::createTasksXML() const
@@ -925,6 +1303,20 @@ std::vector<std::string> ActionGet::createTasksXML() const
   }
   tasks.push_back(xmlTask);
 
+  // Pre-grasp and grasp position of sampled grasps
+  if (!taskHandApproach.empty())
+  {
+    xmlTask = "<Task name=\"" + taskHandApproach + "\" " +
+              "controlVariable=\"XYZ\" effector=\"" + capabilityFrame +
+              "\" " + "refBdy=\"" + affordanceFrame + "\" />";
+    tasks.push_back(xmlTask);
+
+    xmlTask = "<Task name=\"" + taskHandApproachOri + "\" " +
+              "controlVariable=\"POLAR\" " + "effector=\"" + capabilityFrame + "\" " +
+              "refBdy=\"" + affordanceFrame + "\" axisDirection=\"X\" />";
+    tasks.push_back(xmlTask);
+  }
+
   // Hand over hand (if any)
   if (!taskHandOverHand.empty())
   {
@@ -966,7 +1358,45 @@ std::vector<double> ActionGet::getInitOptimState(tropic::TrajectoryControllerBas
 
 size_t ActionGet::getNumSolutions() const
 {
-  return affordanceMap.size();
+  return affordanceMap.size() + graspSamples.size();
+}
+
+bool ActionGet::getSolutionInfo(const ActionScene& domain,
+                                const RcsGraph* graph,
+                                size_t solutionRank,
+                                SolutionInfo& info) const
+{
+  if (solutionRank >= getNumSolutions())
+  {
+    return false;
+  }
+
+  const size_t mapIdx = (solutionRank < affordanceMap.size()) ? solutionRank :
+                        graspSamples[solutionRank-affordanceMap.size()].mapIdx;
+  const Manipulator* hand = domain.getManipulator(std::get<1>(affordanceMap[mapIdx]));
+
+  if (!hand)
+  {
+    return false;
+  }
+
+  // The hand that holds the object during a hand-over is kept in place
+  info.manipulators.assign(1, hand->name);
+  if (!handOverHand.empty() && (handOverHand != hand->name))
+  {
+    info.manipulators.push_back(handOverHand);
+  }
+
+  info.objects.assign(1, objectName);
+
+  const RcsBody* affBdy = RcsGraph_getBodyByName(graph, std::get<0>(affordanceMap[mapIdx])->frame.c_str());
+  info.hasTarget = (affBdy != NULL);
+  if (affBdy)
+  {
+    Vec3d_copy(info.targetPos, affBdy->A_BI.org);
+  }
+
+  return true;
 }
 
 double ActionGet::getDurationHint() const
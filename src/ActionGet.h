@@ -49,6 +49,14 @@ public:
             const RcsGraph* graph,
             std::vector<std::string> params);
 
+  /*! \brief Validation fast path, see ActionFactory::validate(). Throws an
+   *         ActionException if the object or hand are unknown, or if no free
+   *         hand can grasp the object.
+   */
+  static void check(const ActionScene& domain,
+                    const RcsGraph* graph,
+                    std::vector<std::string> params);
+
   virtual ~ActionGet();
   std::unique_ptr<ActionBase> clone() const override;
 
@@ -67,6 +75,8 @@ public:
   std::vector<std::string> getManipulators() const;
   virtual size_t getNumSolutions() const;
   virtual double getDurationHint() const;
+  bool getSolutionInfo(const ActionScene& domain, const RcsGraph* graph,
+                       size_t solutionRank, SolutionInfo& info) const;
 
   // Interface for optimization
   std::vector<double> getInitOptimState(tropic::TrajectoryControllerBase* tc,
@@ -85,6 +95,23 @@ public:
 
   static std::string graspTypeToString(GraspType gType);
 
+  // Grasp pose sampled around the invariant axis of a PowerGraspable or
+  // TwistGraspable, or along the circle of a CircularGraspable. The sample
+  // determines the hand position relative to the affordance frame in the
+  // pre-grasp and in the grasp pose, and the direction the hand's x-axis
+  // points to when approaching.
+  struct GraspSample
+  {
+    size_t mapIdx;        // Index into affordanceMap
+    double approach[3];   // Pre-grasp hand position in the affordance frame
+    double grasp[3];      // Grasp hand position in the affordance frame
+    double polar[2];      // Approach direction in the affordance frame
+    double cost;
+  };
+
+  void sampleGrasps(const ActionScene& domain, const RcsGraph* graph,
+                    const RcsBody* objBdy);
+
   std::vector<std::string> createTasksXML() const;
 
   virtual std::shared_ptr<tropic::ConstraintSet>
@@ -124,9 +151,15 @@ public:
   std::string taskFingers;
   std::string handOverHand;
   std::string taskHandOverHand;
+  std::string taskHandApproach;
+  std::string taskHandApproachOri;
 
   std::vector<std::string> usedManipulators;
   std::vector<std::tuple<Affordance*, Capability*>> affordanceMap;
+  std::vector<GraspSample> graspSamples;   // Solutions after affordanceMap
+  double approachPos[3];
+  double graspPos[3];
+  double approachPolar[2];
   double liftHeight;
   double preGraspDist;
   double shoulderBase;
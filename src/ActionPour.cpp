@@ -51,6 +51,8 @@ namespace aff
 {
 REGISTER_ACTION(ActionPour, "pour");
 REGISTER_ACTION(ActionPour, "id_635640f302a8c9f3ffa00811");
+REGISTER_ACTION_CHECK(ActionPour, "pour");
+REGISTER_ACTION_CHECK(ActionPour, "id_635640f302a8c9f3ffa00811");
 
 ActionPour::ActionPour(const ActionScene& domain,
                        const RcsGraph* graph,
@@ -90,6 +92,81 @@ ActionPour::ActionPour(const ActionScene& domain,
   init(domain, graph, objectToPourFrom, objectToPourInto, amountToPour, "base_footprint");
 }
 
+/*******************************************************************************
+ * Same parameter checks as in the constructor and init(), but without the
+ * liquid transition.
+ ******************************************************************************/
+void ActionPour::check(const ActionScene& domain,
+                       const RcsGraph* graph,
+                       std::vector<std::string> params)
+{
+  auto it = std::find(params.begin(), params.end(), "duration");
+  if (it != params.end())
+  {
+    if (it+1 == params.end())
+    {
+      throw ActionException("ERROR REASON: The value of duration is missing",
+                            ActionException::ParamInvalid);
+    }
+
+    std::stod(*(it+1));
+    params.erase(it+1);
+    params.erase(it);
+  }
+
+  if (params.size()<2)
+  {
+    throw ActionException("ERROR REASON: Action has less than two parameters. At least two parameters are needed:"
+                          "The container to pour from, and the container to pour into. "
+                          "SUGGESTION: Correct action command.", ActionException::ParamInvalid);
+  }
+
+  if ((params.size()>2) && (std::stod(params[2]) < 0.0))
+  {
+    throw ActionException("ERROR REASON: The amount to pour has a negative value. It must be equal or larger than zero."
+                          "SUGGESTION: Pour only liquid amounts with positive volume.", ActionException::ParamInvalid);
+  }
+
+  const AffordanceEntity* pourFromAff = domain.getAffordanceEntity(params[0]);
+
+  if (!pourFromAff)
+  {
+    throw ActionException("ERROR REASON: The " + params[0] +
+                          " to pour from is unknown. SUGGESTION: Use an object name that is defined in the environment",
+                          ActionException::ParamNotFound);
+  }
+
+  if (getAffordances<Pourable>(pourFromAff).empty())
+  {
+    throw ActionException("ERROR REASON: The " + params[0] + " is not a container that can be poured from."
+                          "SUGGESTION: Choose another object to pour from.",
+                          ActionException::ParamNotFound);
+  }
+
+  const AffordanceEntity* pourToAff = domain.getAffordanceEntity(params[1]);
+
+  if (!pourToAff)
+  {
+    throw ActionException("ERROR REASON: The " + params[1] +
+                          " to pour into is unknown. SUGGESTION: Use an object name that is defined in the environment",
+                          ActionException::ParamNotFound);
+  }
+
+  if (getAffordances<Containable>(pourToAff).empty())
+  {
+    throw ActionException("ERROR REASON: The " + params[1] +
+                          " to pour into is not a container that can be poured into. "
+                          "SUGGESTION: Choose another object to pour into.", ActionException::ParamNotFound);
+  }
+
+  if (!domain.getGraspingHand(graph, pourFromAff))
+  {
+    throw ActionException("ERROR REASON: The " + params[0] + " to pour from is not held in a hand."
+                          " SUGGESTION: First get the object " + params[0] + " before performing this action",
+                          ActionException::ParamNotFound);
+  }
+}
+
 void ActionPour::init(const ActionScene& domain,
                       const RcsGraph* graph,
                       const std::string& objectToPourFrom,
@@ -172,8 +249,12 @@ void ActionPour::init(const ActionScene& domain,
   RCHECK(roboBaseBdy);
   this->roboBaseFrame = std::string(roboBaseBdy->name);
 
-  // Transition the liquid from bottle to glas.
-  performLiquidTransition(pourFromAff, pourToAff);
+  // Transition the liquid from bottle to glas. This changes the liquid levels
+  // of the scene the action is created on, therefore the scene must not be
+  // used by other threads (see ActionFactory::validate()).
+  ActionScene& mutableDomain = const_cast<ActionScene&>(domain);
+  performLiquidTransition(mutableDomain.getAffordanceEntity(objectToPourFrom),
+                          mutableDomain.getAffordanceEntity(objToPourInto));
 
   // Collect solid items from the pouring affordance. We don't care how it got
   // there, therefore we don't go through the Containables. But ideally, the
@@ -372,9 +453,15 @@ std::vector<std::string> ActionPour::getManipulators() const
   return usedManipulators;
 }
 
-void ActionPour::performLiquidTransition(const AffordanceEntity* pourFromAff,
-                                         const AffordanceEntity* pourToAff)
+void ActionPour::performLiquidTransition(AffordanceEntity* pourFromAff,
+                                         AffordanceEntity* pourToAff)
 {
+  // The affordances might be shared with copies of the scene (for instance
+  // the snapshot for get_state). We therefore give both entities their own
+  // affordance instances before changing the liquid levels.
+  pourFromAff->detachAffordances();
+  pourToAff->detachAffordances();
+
   auto toContainers = getAffordances<Containable>(pourToAff);
   auto fromContainers = getAffordances<Containable>(pourFromAff);
 
@@ -49,6 +49,14 @@ public:
              const RcsGraph* graph,
              std::vector<std::string> params);
 
+  /*! \brief Validation fast path, see ActionFactory::validate(). Throws an
+   *         ActionException if the containers are unknown, if they can't be
+   *         poured from or into, or if the one to pour from is not held.
+   */
+  static void check(const ActionScene& domain,
+                    const RcsGraph* graph,
+                    std::vector<std::string> params);
+
   virtual ~ActionPour();
   std::unique_ptr<ActionBase> clone() const override;
 
@@ -66,8 +74,8 @@ protected:
             const std::string& roboBase);
 
   std::vector<std::string> createTasksXML() const;
-  void performLiquidTransition(const AffordanceEntity* pourFromAff,
-                               const AffordanceEntity* pourToAff);
+  void performLiquidTransition(AffordanceEntity* pourFromAff,
+                               AffordanceEntity* pourToAff);
 
   std::string bottle;
   std::string glas;     // Name of Containable frame of receiving entity
@@ -33,6 +33,7 @@
 #include "ActionPush.h"
 #include "ActionFactory.h"
 #include "CollisionModelConstraint.h"
+#include "BodyBVH.h"
 
 #include <ActivationSet.h>
 #include <PositionConstraint.h>
@@ -251,8 +252,8 @@ ActionPush::ActionPush(const ActionScene& domain,
     double bottomPt[3];
     Vec3d_copy(bottomPt, objBottomBdy->A_BI.org);
     bottomPt[2] -= 1.0e-8;
-    surfaceBdy = RcsBody_closestInDirection(graph, bottomPt, dir,
-                                            NULL, &dMin);
+    surfaceBdy = BodyBVH::threadInstance().raycast(graph, bottomPt, dir, false,
+                                                   NULL, &dMin);
     // \todo: Check for self intersections.
     if (surfaceBdy)
     {
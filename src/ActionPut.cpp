@@ -33,6 +33,7 @@
 #include "ActionPut.h"
 #include "ActionFactory.h"
 #include "CollisionModelConstraint.h"
+#include "TaskPrototypeCache.h"
 
 #include <ActivationSet.h>
 #include <PositionConstraint.h>
@@ -44,9 +45,12 @@
 #include <Rcs_body.h>
 #include <Rcs_macros.h>
 
+#include <algorithm>
+
 #define fingersOpen   (0.01)
 #define fingersClosed (0.7)
 #define t_fingerMove  (2.0)
+#define MAX_PLACEMENTS (8)
 
 
 namespace aff
@@ -54,6 +58,9 @@ namespace aff
 REGISTER_ACTION(ActionPut, "put");
 REGISTER_ACTION(ActionPut, "power_put");
 REGISTER_ACTION(ActionPut, "id_6355823084f61faabb83cb1a");
+REGISTER_ACTION_CHECK(ActionPut, "put");
+REGISTER_ACTION_CHECK(ActionPut, "power_put");
+REGISTER_ACTION_CHECK(ActionPut, "id_6355823084f61faabb83cb1a");
 
 ActionPut::ActionPut(const ActionScene& domain,
                      const RcsGraph* graph,
@@ -88,6 +95,112 @@ ActionPut::ActionPut(const ActionScene& domain,
   init(domain, graph, params[0], params.size() > 1 ? params[1] : std::string());
 }
 
+/*******************************************************************************
+ * Same parameter checks as in init(), but without raycasting and placement
+ * sampling.
+ ******************************************************************************/
+void ActionPut::check(const ActionScene& domain,
+                      const RcsGraph* graph,
+                      std::vector<std::string> params)
+{
+  std::string whereOn;
+
+  for (const std::string key : { "frame", "duration" })
+  {
+    auto it = std::find(params.begin(), params.end(), key);
+    if (it != params.end())
+    {
+      if (it+1 == params.end())
+      {
+        throw ActionException("ERROR REASON: The value of " + key + " is missing",
+                              ActionException::ParamInvalid);
+      }
+
+      if (key == "frame")
+      {
+        whereOn = *(it+1);
+      }
+      else
+      {
+        std::stod(*(it+1));
+      }
+
+      params.erase(it+1);
+      params.erase(it);
+    }
+  }
+
+  if (params.empty())
+  {
+    throw ActionException("ERROR REASON: The object to put is not specified. SUGGESTION: Use an object name that is defined in the environment",
+                          ActionException::ParamInvalid);
+  }
+
+  const std::string& objectToPut = params[0];
+  const std::string surfaceToPutOn = params.size()>1 ? params[1] : std::string();
+  std::vector<const AffordanceEntity*> objects = domain.getAffordanceEntities(objectToPut);
+
+  if (objects.empty())
+  {
+    throw ActionException("ERROR REASON: The " + objectToPut + " is unknown. SUGGESTION: Use an object name that is defined in the environment",
+                          ActionException::ParamNotFound);
+  }
+
+  auto gPair = domain.getGraspingHand(graph, objects);
+  const AffordanceEntity* object = std::get<1>(gPair);
+
+  if (!std::get<0>(gPair))
+  {
+    throw ActionException("ERROR REASON: The " + objectToPut + " is not held in the hand. SUGGESTION: First get the " + objectToPut + " in the hand before performing this command",
+                          ActionException::KinematicallyImpossible);
+  }
+
+  if (getAffordances<Stackable>(object).empty())
+  {
+    throw ActionException("ERROR REASON: I don't know how to place the " + objectToPut + " on a surface. SUGGESTION: Try to hand it over, or try something else",
+                          ActionException::KinematicallyImpossible);
+  }
+
+  if (surfaceToPutOn.empty())
+  {
+    return;
+  }
+
+  const AffordanceEntity* surface = domain.getAffordanceEntity(surfaceToPutOn);
+
+  if (!surface)
+  {
+    throw ActionException("ERROR REASON: The surface " + surfaceToPutOn + " to put the " + objectToPut +
+                          " on is unknown. SUGGESTION: Use an object name that is defined in the environment",
+                          ActionException::ParamNotFound);
+  }
+
+  auto affordanceMap = match<Supportable, Stackable>(surface, object);
+
+  if (affordanceMap.empty())
+  {
+    throw ActionException("ERROR REASON: I can't put the " + objectToPut + " on the " + surface->name +
+                          " because it does not support it. SUGGESTION: Specify another object to put it on",
+                          ActionException::ParamNotFound);
+  }
+
+  if (whereOn.empty())
+  {
+    return;
+  }
+
+  for (const auto& pair : affordanceMap)
+  {
+    if (std::get<0>(pair)->frame == whereOn)
+    {
+      return;
+    }
+  }
+
+  throw ActionException("ERROR REASON: I can't put the " + objectToPut + " on the " + surface->name +
+                        "'s frame " + whereOn + ".", ActionException::ParamNotFound);
+}
+
 void ActionPut::init(const ActionScene& domain,
                      const RcsGraph* graph,
                      const std::string& objectToPut,
@@ -225,65 +338,79 @@ void ActionPut::init(const ActionScene& domain,
                           "'s frame " + whereOn + ".", ActionException::ParamNotFound);
   }
 
-  // Erase the Supportables that are already occupied with a collideable
+  // Erase the Supportables that are already occupied with a collideable. The
+  // hands and the objects they hold are not considered as obstacles.
+  const RcsBody* objBdy = RcsGraph_getBodyByName(graph, objName.c_str());
+  RCHECK(objBdy);
+  std::vector<const RcsBody*> ignoreBodies;
+  for (const auto& m : domain.manipulators)
   {
-    // RLOG_CPP(-1, "BEFORE: " << affordanceMap.size());
+    const RcsBody* mBdy = RcsGraph_getBodyByName(graph, m.name.c_str());
+    if (mBdy)
+    {
+      ignoreBodies.push_back(mBdy);
+    }
+  }
+
+  PlacementSampler sampler(graph, objBdy, ignoreBodies);
+  std::vector<std::vector<PlacementSampler::Placement>> regionPlacements;
+  const size_t numSupportables = affordanceMap.size();
+  size_t numFramesMissing = 0;
 
+  {
     auto it = affordanceMap.begin();
     while (it != affordanceMap.end())
     {
-      // If element is even number then delete it
-      const Affordance* supportable = std::get<0>(*it);
-      const Supportable* s = dynamic_cast<const Supportable*>(supportable);
+      const Supportable* s = dynamic_cast<const Supportable*>(std::get<0>(*it));
       RCHECK(s);
+      const RcsBody* supportFrame = RcsGraph_getBodyByName(graph, s->frame.c_str());
 
-      // \todo: Make better geometric check here
-      if (s->extentsX>0.0 || s->extentsY>0.0)
+      if (!supportFrame)
       {
-        it++;
+        RLOG(1, "Support frame \"%s\" not found in graph - skipping it",
+             s->frame.c_str());
+        numFramesMissing++;
+        it = affordanceMap.erase(it);
         continue;
       }
 
-      const RcsBody* supportFrame = RcsGraph_getBodyByName(graph, supportable->frame.c_str());
-      RCHECK(supportFrame);
-      // RLOG(-1, "Checking supportFrame %s", supportFrame->name);
-
-      // Traverse children of support frame and look for collideable entities
-      RcsBody* child = RCSBODY_BY_ID(graph, supportFrame->firstChildId);
-      bool foundCollideable = false;
-
-      while (child)
+      // Support regions are only erased if there's no free space at all. For
+      // single frames, the footprint of the object at the frame must be free.
+      bool isOccupied = false;
+      if (s->extentsX>0.0 || s->extentsY>0.0)
       {
-        const AffordanceEntity* childNTT = domain.getAffordanceEntity(child->name);
-        // RLOG(-1, "Checking  %s %s", child->name, childNTT ? childNTT->bdyName.c_str() : "NULL");
-
-        if (childNTT && childNTT->isCollideable(graph))
+        regionPlacements.push_back(sampler.sample(supportFrame, s->extentsX, s->extentsY,
+                                                  objBdy->A_BI.org, MAX_PLACEMENTS));
+        isOccupied = regionPlacements.back().empty();
+        if (isOccupied)
         {
-          foundCollideable = true;
-          // RLOG(-1, "Found collideable %s", childNTT->bdyName.c_str());
-          break;
+          regionPlacements.pop_back();
+        }
+      }
+      else
+      {
+        isOccupied = !sampler.isFree(supportFrame, Vec3d_zeroVec());
+        if (!isOccupied)
+        {
+          regionPlacements.push_back(std::vector<PlacementSampler::Placement>());
         }
-
-        child = RCSBODY_BY_ID(graph, child->nextId);
       }
 
-
-      if (foundCollideable)
+      if (isOccupied)
       {
-        // RLOG(-1, "Found collideable ntt %s - removing", child->name);
-        // Due to deletion in loop, iterator became invalidated. So reset the iterator to next item.
         it = affordanceMap.erase(it);
       }
       else
       {
         it++;
       }
-
-
-
     }
+  }
 
-    // RLOG_CPP(-1, "AFTER: " << affordanceMap.size());
+  if (numFramesMissing == numSupportables)
+  {
+    throw ActionException("ERROR REASON: I can't put the " + objectToPut + " on the " + surface->name +
+                          ". It has no support surface in the scene model.", ActionException::ParamNotFound);
   }
 
   // There's already somethin on all supportables
@@ -293,6 +420,28 @@ void ActionPut::init(const ActionScene& domain,
                           ". There is already something on it. SUGGESTION: Put the object somewhere else, or remove the blocking object. ", ActionException::ParamNotFound);
   }
 
+  // The sampled placements follow the affordances, and are sorted by their
+  // distance to the object.
+  for (size_t i = 0; i < affordanceMap.size(); ++i)
+  {
+    for (const auto& p : regionPlacements[i])
+    {
+      placements.push_back(std::make_tuple(std::get<0>(affordanceMap[i]),
+                                           std::get<1>(affordanceMap[i]), p));
+    }
+  }
+
+  std::stable_sort(placements.begin(), placements.end(),
+                   [](const PlacementSolution& a, const PlacementSolution& b)
+  {
+    return std::get<2>(a).cost < std::get<2>(b).cost;
+  });
+
+  if (placements.size() > MAX_PLACEMENTS)
+  {
+    placements.resize(MAX_PLACEMENTS);
+  }
+
   // We have one or several matches and sort them according to their cost. Lower
   // costs pairs are at the beginning.
   sort(graph, affordanceMap, 1.0, 1.0);
@@ -310,13 +459,15 @@ bool ActionPut::initialize(const ActionScene& domain,
                            const RcsGraph* graph,
                            size_t solutionRank)
 {
-  if (solutionRank >= affordanceMap.size())
+  if (solutionRank >= getNumSolutions())
   {
     return false;
   }
 
   // These are the "winning" affordances.
-  Affordance* surfaceAff = std::get<0>(affordanceMap[solutionRank]);
+  const bool isSampled = solutionRank >= affordanceMap.size();
+  const PlacementSolution* sample = isSampled ? &placements[solutionRank-affordanceMap.size()] : NULL;
+  Affordance* surfaceAff = isSampled ? std::get<0>(*sample) : std::get<0>(affordanceMap[solutionRank]);
   RCHECK_MSG(surfaceAff, "Affordance at solution index %zu is NULL", solutionRank);
   Supportable* supportable = dynamic_cast<Supportable*>(surfaceAff);
   RCHECK_MSG(supportable, "%s is not a Supportable", surfaceAff->frame.c_str());   // never happens
@@ -324,7 +475,7 @@ bool ActionPut::initialize(const ActionScene& domain,
   supportRegionX = supportable->extentsX;
   supportRegionY = supportable->extentsY;
 
-  Affordance* bottomAff = std::get<1>(affordanceMap[solutionRank]);
+  Affordance* bottomAff = isSampled ? std::get<1>(*sample) : std::get<1>(affordanceMap[solutionRank]);
   Stackable* stackable = dynamic_cast<Stackable*>(bottomAff);
   RCHECK(stackable);   // never happens
   this->polarAxisIdx = stackable->normalDir;
@@ -337,6 +488,15 @@ bool ActionPut::initialize(const ActionScene& domain,
   // This is the put position in the coordinates of the surface frame.
   Vec3d_invTransform(downProjection, &surfaceBdy->A_BI, surfaceBdy->A_BI.org);
 
+  // Sampled placements are put at a fixed position instead of anywhere
+  // within the support region.
+  if (isSampled)
+  {
+    Vec3d_copy(downProjection, std::get<2>(*sample).pos);
+    supportRegionX = 0.0;
+    supportRegionY = 0.0;
+  }
+
   // Assemble finger task name
   fingerJoints.clear();
   const Manipulator* graspingHand = domain.getManipulator(usedManipulators[0]);
@@ -367,7 +527,18 @@ bool ActionPut::initialize(const ActionScene& domain,
 
 std::vector<std::string> ActionPut::createTasksXML() const
 {
-  std::vector<std::string> tasks;
+  std::vector<std::string> xmlTasks;
+  for (const auto& t : createTaskDescriptors())
+  {
+    xmlTasks.push_back(t.toXML());
+  }
+
+  return xmlTasks;
+}
+
+std::vector<TaskDescriptor> ActionPut::createTaskDescriptors() const
+{
+  std::vector<TaskDescriptor> tasks;
 
   bool useTaskRegion = false;
   if (((supportRegionX != 0.0) || (supportRegionY != 0.0)))
@@ -376,101 +547,62 @@ std::vector<std::string> ActionPut::createTasksXML() const
   }
 
   // taskObjHandPos: XYZ-task with effector=object and refBdy=hand
-  std::string xmlTask = "<Task name=\"" + taskObjHandPos + "\" " +
-                        "controlVariable=\"XYZ\" " + "effector=\"" +
-                        objGraspFrame + "\" " + "refBdy=\"" + graspFrame + "\" />";
-  tasks.push_back(xmlTask);
+  tasks.push_back(TaskDescriptor(taskObjHandPos, "XYZ", objGraspFrame, graspFrame));
 
   // taskHandSurfacePos: XYZ-task with effector=hand, refBdy=object and refFrame=surface
   // Used for vertical retract after ballgrasp
-  xmlTask = "<Task name=\"" + taskHandSurfacePos + "\" " +
-            "controlVariable=\"XYZ\" " + "effector=\"" +
-            graspFrame + "\" " + "refBdy=\"" + objGraspFrame + "\" refFrame=\"" +
-            surfaceFrameName + "\" />";
-  tasks.push_back(xmlTask);
+  tasks.push_back(TaskDescriptor(taskHandSurfacePos, "XYZ", graspFrame,
+                                 objGraspFrame, surfaceFrameName));
 
   // taskObjSurfacePosition z and sideways velocities
-  xmlTask = "<Task name=\"" + taskObjSurfacePosX + "\" " +
-            "controlVariable=\"X\" " + "effector=\"" + objBottomName + "\" " +
-            "refBdy=\"" + surfaceFrameName + "\" >";
+  TaskDescriptor objSurfaceX(taskObjSurfacePosX, "X", objBottomName, surfaceFrameName);
+  TaskDescriptor objSurfaceY(taskObjSurfacePosY, "Y", objBottomName, surfaceFrameName);
   if (useTaskRegion)
   {
-    xmlTask += "\n<TaskRegion type=\"BoxInterval\" ";
-    xmlTask += "min=\"" + std::to_string(-0.5*supportRegionX) + "\" ";
-    xmlTask += "max=\"" + std::to_string(0.5*supportRegionX) + "\" ";
-    xmlTask += "dxScaling=\"0\" />";
+    objSurfaceX.addChild("<TaskRegion type=\"BoxInterval\" min=\"" +
+                         std::to_string(-0.5*supportRegionX) + "\" max=\"" +
+                         std::to_string(0.5*supportRegionX) + "\" dxScaling=\"0\" />");
+    objSurfaceY.addChild("<TaskRegion type=\"BoxInterval\" min=\"" +
+                         std::to_string(-0.5*supportRegionY) + "\" max=\"" +
+                         std::to_string(0.5*supportRegionY) + "\" dxScaling=\"0\" />");
   }
-  xmlTask += "</Task>";
-  tasks.push_back(xmlTask);
+  tasks.push_back(objSurfaceX);
+  tasks.push_back(objSurfaceY);
 
-  xmlTask = "<Task name=\"" + taskObjSurfacePosY+ "\" " +
-            "controlVariable=\"Y\" " + "effector=\"" + objBottomName + "\" " +
-            "refBdy=\"" + surfaceFrameName + "\" >";
-  if (useTaskRegion)
-  {
-    xmlTask += "\n<TaskRegion type=\"BoxInterval\" ";
-    xmlTask += "min=\"" + std::to_string(-0.5*supportRegionY) + "\" ";
-    xmlTask += "max=\"" + std::to_string(0.5*supportRegionY) + "\" ";
-    xmlTask += "dxScaling=\"0\" />";
-  }
-  xmlTask += "</Task>";
-  tasks.push_back(xmlTask);
-
-  xmlTask = "<Task name=\"" + taskObjSurfacePosZ + "\" " +
-            "controlVariable=\"Z\" " + "effector=\"" + objBottomName + "\" " +
-            "refBdy=\"" + surfaceFrameName + "\" />";
-  tasks.push_back(xmlTask);
+  tasks.push_back(TaskDescriptor(taskObjSurfacePosZ, "Z", objBottomName, surfaceFrameName));
 
   // taskObjSurfacePolar: Relative Polar angle orientation between
   // object and surface   polarAxisIdx
-  xmlTask = "<Task name=\"" + taskObjSurfacePolar + "\" " +
-            "controlVariable=\"POLAR\" " + "effector=\"" +
-            objBottomName + "\" refBdy=\"" + surfaceFrameName + "\" ";
-
+  TaskDescriptor objSurfacePolar(taskObjSurfacePolar, "POLAR", objBottomName, surfaceFrameName);
   if (polarAxisIdx==0)
   {
-    xmlTask += "axisDirection=\"X\" ";
+    objSurfacePolar.set("axisDirection", "X");
   }
   else if (polarAxisIdx == 1)
   {
-    xmlTask += "axisDirection=\"Y\" ";
+    objSurfacePolar.set("axisDirection", "Y");
   }
-
-  xmlTask += " />";
-
-
-  tasks.push_back(xmlTask);
+  tasks.push_back(objSurfacePolar);
 
   // taskHandPolar
-  xmlTask = "<Task name=\"" + taskHandPolar + "\" " +
-            "controlVariable=\"Inclination\" " + "effector=\"" + graspFrame + "\" axisDirection=\"X\" />";
-  tasks.push_back(xmlTask);
+  tasks.push_back(TaskDescriptor(taskHandPolar, "Inclination", graspFrame).set("axisDirection", "X"));
 
   // taskHandObjPolar
   if (isPincerGrasped)
   {
-    xmlTask = "<Task name=\"" + taskHandObjPolar + "\" " +
-              "controlVariable=\"Inclination\" " + "effector=\"" + graspFrame + "\" " +
-              "refBdy=\"" + objBottomName + "\" axisDirection=\"X\" />";
+    tasks.push_back(TaskDescriptor(taskHandObjPolar, "Inclination", graspFrame,
+                                   objBottomName).set("axisDirection", "X"));
   }
   else
   {
-    xmlTask = "<Task name=\"" + taskHandObjPolar + "\" " +
-              "controlVariable=\"POLAR\" " + "effector=\"" + graspFrame + "\" " +
-              "refBdy=\"" + objBottomName + "\" />";
+    tasks.push_back(TaskDescriptor(taskHandObjPolar, "POLAR", graspFrame, objBottomName));
   }
-  tasks.push_back(xmlTask);
 
   // Orientation of surface frame (if held in hand)
-  xmlTask = "<Task name=\"" + taskSurfaceOri + "\" " +
-            "controlVariable=\"POLAR\" " + "effector=\"" + surfaceFrameName + "\" />";
-  tasks.push_back(xmlTask);
-
+  tasks.push_back(TaskDescriptor(taskSurfaceOri, "POLAR", surfaceFrameName));
 
   // Fingers
-  xmlTask = "<Task name=\"" + taskFingers + "\" controlVariable=\"Joints\" " +
-            "jnts=\"" + fingerJoints + "\" />";
-  tasks.push_back(xmlTask);
+  tasks.push_back(TaskDescriptor(taskFingers, "Joints").set("jnts", fingerJoints));
 
   return tasks;
 }
@@ -647,11 +779,54 @@ void ActionPut::print() const
          std::get<1>(affordanceMap[i])->frame.c_str());
   }
 
+  for (size_t i = 0; i < placements.size(); ++i)
+  {
+    const PlacementSampler::Placement& p = std::get<2>(placements[i]);
+    RLOG(0, "Solution %zu: %s - %s at [%.3f %.3f]", affordanceMap.size()+i,
+         std::get<0>(placements[i])->frame.c_str(),
+         std::get<1>(placements[i])->frame.c_str(), p.pos[0], p.pos[1]);
+  }
+
 }
 
 size_t ActionPut::getNumSolutions() const
 {
-  return affordanceMap.size();
+  return affordanceMap.size() + placements.size();
+}
+
+bool ActionPut::getSolutionInfo(const ActionScene& domain,
+                                const RcsGraph* graph,
+                                size_t solutionRank,
+                                SolutionInfo& info) const
+{
+  if ((solutionRank >= getNumSolutions()) || usedManipulators.empty())
+  {
+    return false;
+  }
+
+  // The first manipulator is the one holding the object, the others are kept
+  info.manipulators.assign(1, usedManipulators[0]);
+  info.objects.assign(1, objName);
+
+  const bool isSampled = solutionRank >= affordanceMap.size();
+  const PlacementSolution* sample = isSampled ? &placements[solutionRank-affordanceMap.size()] : NULL;
+  const Affordance* surfaceAff = isSampled ? std::get<0>(*sample) : std::get<0>(affordanceMap[solutionRank]);
+  const RcsBody* surfaceBdy = RcsGraph_getBodyByName(graph, surfaceAff->frame.c_str());
+  info.hasTarget = (surfaceBdy != NULL);
+
+  if (surfaceBdy)
+  {
+    if (isSampled)
+    {
+      Vec3d_transform(info.targetPos, &surfaceBdy->A_BI, std::get<2>(*sample).pos);
+    }
+    else
+    {
+      Vec3d_copy(info.targetPos, surfaceBdy->A_BI.org);
+    }
+  }
+
+  return true;
 }
 
 std::unique_ptr<ActionBase> ActionPut::clone() const
@@ -35,6 +35,7 @@
 
 
 #include "ActionBase.h"
+#include "PlacementSampler.h"
 
 
 
@@ -49,12 +50,23 @@ public:
             const RcsGraph* graph,
             std::vector<std::string> params);
 
+  /*! \brief Validation fast path, see ActionFactory::validate(). Throws an
+   *         ActionException if the object is unknown or not held, or if the
+   *         surface doesn't support it. Without a surface, the raycast is
+   *         left to the constructor.
+   */
+  static void check(const ActionScene& domain,
+                    const RcsGraph* graph,
+                    std::vector<std::string> params);
+
   virtual ~ActionPut();
   std::unique_ptr<ActionBase> clone() const;
 
   tropic::TCS_sptr createTrajectory(double t_start, double t_end) const;
   std::string explain() const;
   std::vector<std::string> getManipulators() const;
+  bool getSolutionInfo(const ActionScene& domain, const RcsGraph* graph,
+                       size_t solutionRank, SolutionInfo& info) const;
   std::vector<double> getInitOptimState(tropic::TrajectoryControllerBase* tc,
                                         double duration) const;
 
@@ -71,6 +83,7 @@ protected:
             const std::string& surface);
 
   std::vector<std::string> createTasksXML() const;
+  std::vector<TaskDescriptor> createTaskDescriptors() const;
 
   std::shared_ptr<tropic::ConstraintSet>
   createTrajectory(double t_start,
@@ -111,6 +124,11 @@ protected:
   double downProjection[3];
 
   std::vector<std::tuple<Affordance*, Affordance*>> affordanceMap;
+
+  // Sampled placements on Supportables with extents. They are the solutions
+  // after the ones of the affordanceMap.
+  typedef std::tuple<Affordance*, Affordance*, PlacementSampler::Placement> PlacementSolution;
+  std::vector<PlacementSolution> placements;
 };
 
 }   // namespace aff
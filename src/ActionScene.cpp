@@ -31,6 +31,7 @@
 *******************************************************************************/
 
 #include "ActionScene.h"
+#include "SceneCache.h"
 
 #include <Rcs_typedef.h>
 #include <Rcs_shape.h>
@@ -55,30 +56,40 @@ These classes are independent of any action.
 namespace aff
 {
 
-ActionScene::ActionScene()
+ActionScene::ActionScene() :
+  affordanceArena(std::make_shared<AffordanceArena>()),
+  capabilityArena(std::make_shared<CapabilityArena>())
 {
 }
 
-ActionScene::ActionScene(const std::string& xmlFile)
+ActionScene::ActionScene(const std::string& xmlFile) :
+  affordanceArena(std::make_shared<AffordanceArena>()),
+  capabilityArena(std::make_shared<CapabilityArena>())
 {
   RLOG(0, "Initializing ActionScene...");
-  xmlDocPtr doc = NULL;
-  xmlNodePtr node = NULL;
+  bool success = false;
 
   if (File_exists(xmlFile.c_str()))
   {
-    node = parseXMLFile(xmlFile.c_str(), "Graph", &doc);
+    success = parseFile(xmlFile, this);
   }
   else
   {
-    node = parseXMLMemory(xmlFile.c_str(), xmlFile.length()+1, &doc);
+    xmlDocPtr doc = NULL;
+    xmlNodePtr node = parseXMLMemory(xmlFile.c_str(), xmlFile.length()+1, &doc);
+
+    if (node)
+    {
+      parseRecursive(node, this);
+      parseAgents(node, this);
+      success = true;
+    }
+
+    xmlFreeDoc(doc);
   }
 
-  if (node)
+  if (success)
   {
-    parseRecursive(node, this);
-    parseAgents(node, this);
-
     RLOG(0, "Initialized %zu agents: ", agents.size());
     for (const auto& a : agents)
     {
@@ -89,8 +100,6 @@ ActionScene::ActionScene(const std::string& xmlFile)
   {
     RLOG(4, "Failed to read xml file \"%s\"", xmlFile.c_str());
   }
-
-  xmlFreeDoc(doc);
 }
 
 ActionScene::~ActionScene()
@@ -110,6 +119,8 @@ ActionScene& ActionScene::operator= (const ActionScene& copyFromMe)
   manipulators = copyFromMe.manipulators;
   agents = copyFromMe.agents;
   foveatedEntity = copyFromMe.foveatedEntity;
+  affordanceArena = copyFromMe.affordanceArena;
+  capabilityArena = copyFromMe.capabilityArena;
 
   return *this;
 }
@@ -120,6 +131,10 @@ bool ActionScene::reload(const std::string& xmlFile)
   manipulators.clear();
   foveatedEntity.clear();
 
+  // The previous arenas might still be referenced by copies of the scene.
+  affordanceArena = std::make_shared<AffordanceArena>();
+  capabilityArena = std::make_shared<CapabilityArena>();
+
   char cfgFile[RCS_MAX_FILENAMELEN] = "";
   bool fileExists = Rcs_getAbsoluteFileName(xmlFile.c_str(), cfgFile);
 
@@ -129,27 +144,17 @@ bool ActionScene::reload(const std::string& xmlFile)
     return false;
   }
 
-  xmlDocPtr doc = NULL;
-  xmlNodePtr node = parseXMLFile(cfgFile, "Graph", &doc);
-
-  if (node)
-  {
-    parseRecursive(node, this);
-    parseAgents(node, this);
-
-    RLOG(0, "Initialized %zu agents", agents.size());
-    for (const auto& a : agents)
-    {
-      a->print();
-    }
-  }
-  else
+  if (!parseFile(cfgFile, this))
   {
     RLOG(4, "Failed to parse xml file \"%s\"", cfgFile);
     return false;
   }
 
-  xmlFreeDoc(doc);
+  RLOG(0, "Initialized %zu agents", agents.size());
+  for (const auto& a : agents)
+  {
+    a->print();
+  }
 
   return true;
 }
@@ -199,11 +204,11 @@ void ActionScene::parseRecursive(const xmlNodePtr parentNode, ActionScene* scene
 
       if (xmlStrcmp(node->name, BAD_CAST "AffordanceModel")==0)
       {
-        scene->entities.emplace_back(AffordanceEntity(node));
+        scene->entities.emplace_back(AffordanceEntity(node, scene->affordanceArena));
       }
       else if (xmlStrcmp(node->name, BAD_CAST "Manipulator")==0)
       {
-        scene->manipulators.emplace_back(Manipulator(node));
+        scene->manipulators.emplace_back(Manipulator(node, scene->capabilityArena));
       }
 
     }
@@ -229,18 +234,38 @@ void ActionScene::parseAgents(const xmlNodePtr parentNode, ActionScene* scene)
   }
 }
 
-ActionScene ActionScene::parse(const std::string& xmlFile)
+bool ActionScene::parseFile(const std::string& xmlFile, ActionScene* scene)
 {
-  ActionScene scene;
+  if (SceneCache::load(xmlFile, scene))
+  {
+    RLOG(0, "Loaded scene from cache %s",
+         SceneCache::getCacheFileName(xmlFile).c_str());
+    return true;
+  }
+
   xmlDocPtr doc = NULL;
   xmlNodePtr node = parseXMLFile(xmlFile.c_str(), "Graph", &doc);
 
-  if (node)
+  if (!node)
   {
-    parseRecursive(node, &scene);
+    xmlFreeDoc(doc);
+    return false;
+  }
+
+  parseRecursive(node, scene);
+  parseAgents(node, scene);
+  SceneCache::store(xmlFile, node);
+  xmlFreeDoc(doc);
 
-    parseAgents(node, &scene);
+  return true;
+}
 
+ActionScene ActionScene::parse(const std::string& xmlFile)
+{
+  ActionScene scene;
+
+  if (parseFile(xmlFile, &scene))
+  {
     RLOG(0, "Initialized %zu agents", scene.agents.size());
     for (const auto& a : scene.agents)
     {
@@ -252,8 +277,6 @@ ActionScene ActionScene::parse(const std::string& xmlFile)
     RLOG(4, "Failed to read xml file \"%s\"", xmlFile.c_str());
   }
 
-  xmlFreeDoc(doc);
-
   return std::move(scene);
 }
 
@@ -325,6 +348,12 @@ const AffordanceEntity* ActionScene::getAffordanceEntity(const std::string& name
   return NULL;
 }
 
+AffordanceEntity* ActionScene::getAffordanceEntity(const std::string& name)
+{
+  const ActionScene* constThis = this;
+  return const_cast<AffordanceEntity*>(constThis->getAffordanceEntity(name));
+}
+
 std::vector<const AffordanceEntity*> ActionScene::getAffordanceEntities(const std::string& name) const
 {
   std::vector<const AffordanceEntity*> foundOnes;
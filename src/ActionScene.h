@@ -53,6 +53,14 @@ public:
   std::vector<Agent*> agents;   // Pointer needed for polymorphism
   std::string foveatedEntity;
 
+  // All affordances and capabilities of the scene are allocated in these
+  // arenas in parsing order, so that the ones of an entity are contiguous in
+  // memory. The arenas are shared with the entities, manipulators and all
+  // copies of the scene, and are released in bulk once none of them is
+  // alive anymore.
+  std::shared_ptr<AffordanceArena> affordanceArena;
+  std::shared_ptr<CapabilityArena> capabilityArena;
+
   ActionScene();
   ActionScene(const std::string& xmlFile);
   virtual ~ActionScene();
@@ -63,10 +71,14 @@ public:
   static void parseRecursive(const xmlNodePtr parentNode, ActionScene* scene);
   static void parseAgents(const xmlNodePtr parentNode, ActionScene* scene);
   static ActionScene parse(const std::string& xmlFile);
+  // Parses the scene from the xml file, or from its SceneCache file if it is
+  // up to date. Returns false if the file could not be parsed.
+  static bool parseFile(const std::string& xmlFile, ActionScene* scene);
   std::string printAffordancesToString() const;
   std::vector<const Manipulator*> getFreeManipulators(const RcsGraph* graph) const;
   std::vector<const Manipulator*> getOccupiedManipulators(const RcsGraph* graph) const;
   const AffordanceEntity* getAffordanceEntity(const std::string& name) const;
+  AffordanceEntity* getAffordanceEntity(const std::string& name);
   std::vector<const AffordanceEntity*> getAffordanceEntities(const std::string& name) const;
 
   // Returns a vector of the child entities that have a parent link to the
@@ -119,12 +131,24 @@ match(const AffordanceEntity* object, const Manipulator* hand)
 {
   std::vector<std::tuple<Affordance*, Capability*>> res;
 
+  // Mask of T and all its descendents, computed at compile time. An
+  // affordance is of type T or derived from T if its type bit is in the mask.
+  // This replaces the dynamic_cast<T*>.
+  constexpr Affordance::TypeMask tMask = Affordance::descendantMask(T::staticClassType());
+
+  // Early exit if the object does not have any affordance of type T.
+  if ((object->typeMask & tMask) == 0)
+  {
+    return res;
+  }
+
   // Outer loop goes through all the object's affordances
-  for (Affordance* objAffordance : object->affordances)
+  for (size_t i = 0; i < object->affordanceMasks.size(); ++i)
   {
     // If the affordance type does not match the template argument, we continue.
-    // The dynamic_cast is true if objAffordance is of type T or derieved from T.
-    if (!dynamic_cast<T*>(objAffordance))
+    const Affordance::TypeMask affBit = object->affordanceMasks[i];
+
+    if ((affBit & tMask) == 0)
     {
       continue;
     }
@@ -133,25 +157,19 @@ match(const AffordanceEntity* object, const Manipulator* hand)
     // instance if T is Graspable, then objAffordance can be
     // Graspable or PowerGraspable.
 
-    // Middle loop goes through all the manipulator's capabilities
-    for (Capability* capability : hand->capabilities)
+    // Inner loop goes through all the manipulator's capabilities. Here we
+    // enforce a direct match between the queried affordance of type T, and
+    // the capabilitie's affordances.
+    for (size_t j = 0; j < hand->affordanceMasks.size(); ++j)
     {
-      // Inner loop: Here we enforce a direct match between the queried
-      // affordance of type T, and the capabilitie's affordance.
-      for (const auto& capAffordance : capability->affordanceTypes)
+      if (hand->affordanceMasks[j] & affBit)
       {
-        // \todo(MG): if (dynamic_cast<T*>(capAffordance)) ???
-        if (capAffordance==objAffordance->classType)
-        {
-          //std::tuple<Affordance*, Capability*> tpl(objAffordance, capability);
-          //res.insert(res.end(), tpl);
-          res.emplace_back(std::make_tuple(objAffordance, capability));
-        }
+        res.emplace_back(std::make_tuple(object->affordances[i], hand->capabilities[j]));
       }
 
-    }   // for (const Capability* ...
+    }   // for (size_t j ...
 
-  }   // for (const Affordance* ...
+  }   // for (size_t i ...
 
   return res;
 }
@@ -182,45 +200,42 @@ match(const AffordanceEntity* object1, const AffordanceEntity* object2)
 {
   std::vector<std::tuple<Affordance*, Affordance*>> res;
 
+  constexpr Affordance::TypeMask t1Mask = Affordance::descendantMask(T1::staticClassType());
+  constexpr Affordance::TypeMask t2Mask = Affordance::descendantMask(T2::staticClassType());
+
+  if (((object1->typeMask & t1Mask) == 0) || ((object2->typeMask & t2Mask) == 0))
+  {
+    return res;
+  }
+
   // Outer loop goes through all the object2's affordances
-  for (Affordance* aff2 : object2->affordances)
+  for (size_t i = 0; i < object2->affordanceMasks.size(); ++i)
   {
     // If the affordance aff2 is not instance or descendent of T2, we continue.
-    if (!dynamic_cast<T2*>(aff2))
+    if ((object2->affordanceMasks[i] & t2Mask) == 0)
     {
       continue;
     }
 
     // From here on, the aff2 is of type T2 or its children. For instance if
     // T2 is Graspable, then aff2 can be Graspable or PowerGraspable.
+    const Affordance::TypeMask reqMask = object2->requiredMasks[i];
 
-    // Middle loop goes through all the object1's affordances
-    for (Affordance* aff1 : object1->affordances)
+    // Inner loop goes through all the object1's affordances
+    for (size_t j = 0; j < object1->affordanceMasks.size(); ++j)
     {
-      // If the affordance aff1 is not instance or descendent of T1,
-      // we continue.
-      if (!dynamic_cast<T1*>(aff1))
-      {
-        continue;
-      }
+      // The affordance aff1 must be instance or descendent of T1, and
+      // directly match one of the affordances required by aff2.
+      const Affordance::TypeMask aff1Bit = object1->affordanceMasks[j];
 
-      // From here on, the aff1 is of type T1 or its children.
-      // Inner loop: Here we enforce a direct match between the queried
-      // affordances of type T, and the capabilitie's affordance.
-      for (const auto& reqAffType : aff2->requiredAffordances)
+      if ((aff1Bit & t1Mask) && (aff1Bit & reqMask))
       {
-        if (reqAffType == aff1->classType)
-        {
-          // std::tuple<Affordance*, Affordance*> tpl(aff1, aff2);
-          // res.insert(res.end(), tpl);
-          res.emplace_back(std::make_tuple(aff1, aff2));
-        }
+        res.emplace_back(std::make_tuple(object1->affordances[j], object2->affordances[i]));
       }
 
-    }   // for (const Affordance* aff1...
-
+    }   // for (size_t j ...
 
-  }   // for (const Affordance* aff2...
+  }   // for (size_t i ...
 
   return res;
 }
@@ -230,19 +245,21 @@ std::vector<T*> getAffordances(const AffordanceEntity* object)
 {
   std::vector<T*> res;
 
-  if (!object)
+  constexpr Affordance::TypeMask tMask = Affordance::descendantMask(T::staticClassType());
+
+  if ((!object) || ((object->typeMask & tMask) == 0))
   {
     return res;
   }
 
-  for (Affordance* affordance : object->affordances)
+  for (size_t i = 0; i < object->affordanceMasks.size(); ++i)
   {
     // If the affordance aff is instance or descendent of T,
-    // we add it to the result.
-    T* dst = dynamic_cast<T*>(affordance);
-    if (dst)
+    // we add it to the result. The type check has been done with the
+    // mask, so that a static_cast is sufficient.
+    if (object->affordanceMasks[i] & tMask)
     {
-      res.push_back(dst);
+      res.push_back(static_cast<T*>(object->affordances[i]));
     }
   }
 
@@ -254,19 +271,20 @@ std::vector<T*> getCapabilities(const Manipulator* effector)
 {
   std::vector<T*> res;
 
-  if (!effector)
+  constexpr Capability::TypeMask tMask = Capability::descendantMask(T::staticClassType());
+
+  if ((!effector) || ((effector->typeMask & tMask) == 0))
   {
     return res;
   }
 
-  for (Capability* capability : effector->capabilities)
+  for (size_t i = 0; i < effector->capabilityMasks.size(); ++i)
   {
-    // If the affordance aff is instance or descendent of T,
+    // If the capability is instance or descendent of T,
     // we add it to the result.
-    T* dst = dynamic_cast<T*>(capability);
-    if (dst)
+    if (effector->capabilityMasks[i] & tMask)
     {
-      res.push_back(dst);
+      res.push_back(static_cast<T*>(effector->capabilities[i]));
     }
   }
 
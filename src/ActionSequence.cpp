@@ -31,6 +31,7 @@
 *******************************************************************************/
 
 #include "ActionSequence.h"
+#include "SceneCache.h"
 
 #include <Rcs_typedef.h>
 #include <Rcs_shape.h>
@@ -45,6 +46,7 @@
 
 #include <algorithm>
 #include <exception>
+#include <mutex>
 
 namespace aff
 {
@@ -54,12 +56,18 @@ namespace aff
  ******************************************************************************/
 ActionSequence::ActionSequence(const std::string& xmlFile)
 {
+  if (SceneCache::loadSequences(xmlFile, sequences))
+  {
+    return;
+  }
+
   xmlDocPtr doc = NULL;
   xmlNodePtr node = parseXMLFile(xmlFile.c_str(), "Graph", &doc);
 
   if (node)
   {
     parseRecursive(node, *this);
+    SceneCache::store(xmlFile, node);
   }
   else
   {
@@ -121,4 +129,189 @@ std::vector<std::pair<std::string, std::string>> ActionSequence::filterByKeyword
   return res;
 }
 
+/*******************************************************************************
+ *
+ ******************************************************************************/
+static std::string trimmed(const std::string& str)
+{
+  const char* ws = " \t\n\v\f\r";
+  size_t first = str.find_first_not_of(ws);
+
+  if (first == std::string::npos)
+  {
+    return std::string();
+  }
+
+  return str.substr(first, str.find_last_not_of(ws)-first+1);
+}
+
+static bool isSequenceKeyword(const std::string& word)
+{
+  return (word == "sequence") || (word == "s");
+}
+
+/*******************************************************************************
+ *
+ ******************************************************************************/
+std::shared_ptr<const ActionSequenceRegistry> ActionSequenceRegistry::get(const std::string& xmlFile)
+{
+  static std::mutex registryMtx;
+  static std::map<std::string, std::shared_ptr<const ActionSequenceRegistry>> registries;
+
+  std::lock_guard<std::mutex> lock(registryMtx);
+  auto& registry = registries[xmlFile];
+
+  if (!registry || registry->isOutdated())
+  {
+    RLOG(1, "%s action sequences of %s", registry ? "Reloading" : "Loading",
+         xmlFile.c_str());
+    registry = std::shared_ptr<const ActionSequenceRegistry>(new ActionSequenceRegistry(xmlFile));
+  }
+
+  return registry;
+}
+
+/*******************************************************************************
+ *
+ ******************************************************************************/
+ActionSequenceRegistry::ActionSequenceRegistry(const std::string& xmlFile)
+{
+  // The file stamps are taken before parsing, so that modifications during
+  // parsing lead to a reload on the next call.
+  std::vector<std::string> fileNames = SceneCache::getIncludedFiles(xmlFile);
+
+  if (fileNames.empty())
+  {
+    fileNames.push_back(xmlFile);
+  }
+
+  for (const auto& fileName : fileNames)
+  {
+    FileStamp stamp;
+    if (stampFile(fileName, stamp))
+    {
+      files.push_back(stamp);
+    }
+  }
+
+  // Only the first of several sequences with the same name is used.
+  ActionSequence seq(xmlFile);
+  for (const auto& pair : seq.sequences)
+  {
+    if (sequences.find(pair.first) == sequences.end())
+    {
+      sequences[pair.first].text = pair.second;
+    }
+  }
+
+  for (auto& pair : sequences)
+  {
+    std::vector<std::string> visiting;
+    if (!expand(pair.first, visiting, pair.second.commands, pair.second.error))
+    {
+      pair.second.commands.clear();
+      RLOG_CPP(1, pair.second.error);
+    }
+  }
+}
+
+/*******************************************************************************
+ * Depth-first expansion. The visiting vector holds the sequences on the
+ * current path, which is short enough for a linear search.
+ ******************************************************************************/
+bool ActionSequenceRegistry::expand(const std::string& name,
+                                    std::vector<std::string>& visiting,
+                                    std::vector<std::string>& commands,
+                                    std::string& error) const
+{
+  auto it = sequences.find(name);
+
+  if (it == sequences.end())
+  {
+    error = "ERROR: Can't execute action sequence. REASON: Action sequence " +
+            name + " not found in config file";
+    return false;
+  }
+
+  if (std::find(visiting.begin(), visiting.end(), name) != visiting.end())
+  {
+    std::string cycle;
+    for (const auto& v : visiting)
+    {
+      cycle += v + " -> ";
+    }
+    error = "ERROR: Can't execute action sequence. REASON: Action sequence " +
+            name + " contains itself: " + cycle + name;
+    return false;
+  }
+
+  visiting.push_back(name);
+
+  for (const auto& command : Rcs::String_split(it->second.text, ";"))
+  {
+    std::string cmd = trimmed(command);
+    std::vector<std::string> words = Rcs::String_split(cmd, " ");
+
+    if ((!words.empty()) && isSequenceKeyword(words[0]))
+    {
+      if (words.size() != 2)
+      {
+        error = "ERROR: Can't execute action sequence. REASON: Action sequence " +
+                name + " contains invalid sequence command '" + cmd + "'";
+        return false;
+      }
+
+      if (!expand(words[1], visiting, commands, error))
+      {
+        return false;
+      }
+    }
+    else
+    {
+      commands.push_back(cmd);
+    }
+  }
+
+  visiting.pop_back();
+
+  return true;
+}
+
+/*******************************************************************************
+ *
+ ******************************************************************************/
+const ActionSequenceRegistry::Sequence* ActionSequenceRegistry::find(const std::string& name) const
+{
+  auto it = sequences.find(name);
+  return (it == sequences.end()) ? NULL : &it->second;
+}
+
+size_t ActionSequenceRegistry::size() const
+{
+  return sequences.size();
+}
+
+/*******************************************************************************
+ *
+ ******************************************************************************/
+bool ActionSequenceRegistry::stampFile(const std::string& path, FileStamp& stamp)
+{
+  stamp.path = path;
+  return SceneCache::getFileStamp(path, &stamp.mtime, &stamp.size);
+}
+
+bool ActionSequenceRegistry::isOutdated() const
+{
+  for (const auto& f : files)
+  {
+    FileStamp stamp;
+    if (!stampFile(f.path, stamp) || (stamp.mtime != f.mtime) || (stamp.size != f.size))
+    {
+      return true;
+    }
+  }
+
+  return files.empty();
+}
+
 } // namespace aff
\ No newline at end of file
@@ -40,6 +40,9 @@
 #include <string>
 #include <tuple>
 #include <map>
+#include <unordered_map>
+#include <memory>
+#include <cstdint>
 
 namespace aff 
 {
@@ -58,6 +61,49 @@ public:
   std::vector<std::pair<std::string, std::string>> sequences;
 };
 
+/*******************************************************************************
+ * Registry of the expanded action sequences of a configuration file. The file
+ * is parsed once, and again only if it or any of its included files changed.
+ * Nested sequences ("sequence name" or "s name" within a sequence) are
+ * expanded when parsing, so that a lookup is a single hash map access.
+ ******************************************************************************/
+class ActionSequenceRegistry
+{
+public:
+
+  struct Sequence
+  {
+    std::string text;                    // As given in the xml file
+    std::vector<std::string> commands;   // Expanded and trimmed commands
+    std::string error;                   // Not empty if expansion failed
+  };
+
+  // Returns the registry of the file, which is shared between all callers.
+  static std::shared_ptr<const ActionSequenceRegistry> get(const std::string& xmlFile);
+
+  // Returns NULL if no sequence with the given name exists.
+  const Sequence* find(const std::string& name) const;
+  size_t size() const;
+
+private:
+
+  struct FileStamp
+  {
+    std::string path;
+    int64_t mtime;     // Nanoseconds
+    uint64_t size;
+  };
+
+  ActionSequenceRegistry(const std::string& xmlFile);
+  bool isOutdated() const;
+  bool expand(const std::string& name, std::vector<std::string>& visiting,
+              std::vector<std::string>& commands, std::string& error) const;
+  static bool stampFile(const std::string& path, FileStamp& stamp);
+
+  std::unordered_map<std::string, Sequence> sequences;
+  std::vector<FileStamp> files;
+};
+
 } //namespace aff
 
 #endif // AFF_ACTIONSEQUENCE_H
\ No newline at end of file
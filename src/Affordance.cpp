@@ -86,6 +86,18 @@ std::string Affordance::stringFromType(Affordance::Type aType)
   return std::string();
 }
 
+Affordance::TypeMask Affordance::maskFromTypes(const std::vector<Type>& types)
+{
+  TypeMask mask = 0;
+
+  for (const auto& t : types)
+  {
+    mask |= typeBit(t);
+  }
+
+  return mask;
+}
+
 Affordance::Affordance(const xmlNodePtr node)
 {
   className = (const char*)node->name;
@@ -39,6 +39,7 @@
 #include <vector>
 #include <string>
 #include <map>
+#include <cstdint>
 
 /*
 
@@ -80,6 +81,64 @@ public:
 
   static std::map<std::string,Type> typeMap;
 
+  // Bit mask over the Type enum, one bit per type. It replaces dynamic_cast
+  // in the matching functions of ActionScene.h.
+  typedef uint32_t TypeMask;
+  static constexpr unsigned int numTypes = static_cast<unsigned int>(Type::Openable) + 1;
+  static_assert(numTypes <= 8*sizeof(TypeMask), "Too many affordance types for TypeMask");
+
+  // Direct base class of each type. This must follow the class hierarchy
+  // below, otherwise getAffordances<T>() and match<T>() return wrong results.
+  static constexpr Type parentType(Type t)
+  {
+    switch (t)
+    {
+      case Type::PowerGraspable:
+      case Type::PincerGraspable:
+      case Type::PalmGraspable:
+      case Type::BallGraspable:
+      case Type::CircularGraspable:
+      case Type::TwistGraspable:
+        return Type::Graspable;
+      case Type::Twistable:
+        return Type::TwistGraspable;
+      default:
+        return Type::Affordance;
+    }
+  }
+
+  static constexpr TypeMask typeBit(Type t)
+  {
+    return TypeMask(1) << static_cast<unsigned int>(t);
+  }
+
+  // Returns true if t is baseType, or a descendent of it.
+  static constexpr bool isA(Type t, Type baseType)
+  {
+    while ((t != baseType) && (t != Type::Affordance))
+    {
+      t = parentType(t);
+    }
+    return t == baseType;
+  }
+
+  // Mask of baseType and all its descendents. Evaluated at compile time when
+  // called with a constant argument.
+  static constexpr TypeMask descendantMask(Type baseType)
+  {
+    TypeMask mask = 0;
+    for (unsigned int i = 0; i < numTypes; ++i)
+    {
+      if (isA(static_cast<Type>(i), baseType))
+      {
+        mask |= typeBit(static_cast<Type>(i));
+      }
+    }
+    return mask;
+  }
+
+  static TypeMask maskFromTypes(const std::vector<Type>& types);
+
   std::string frame;
   std::string className;
   Type classType;
@@ -89,6 +148,7 @@ public:
   static std::string stringFromType(Type aType);
 
   Affordance(const xmlNodePtr node);
+  static constexpr Type staticClassType() { return Type::Affordance; }
   virtual ~Affordance();
   virtual Affordance* clone() const;
   virtual std::string classname() const;
@@ -101,6 +161,7 @@ class Graspable : public Affordance
 public:
 
   Graspable(const xmlNodePtr node);
+  static constexpr Type staticClassType() { return Type::Graspable; }
   virtual Affordance* clone() const;
   virtual ~Graspable();
 };
@@ -112,6 +173,7 @@ class PowerGraspable : public Graspable
 public:
 
   PowerGraspable(const xmlNodePtr node);
+  static constexpr Type staticClassType() { return Type::PowerGraspable; }
   virtual Affordance* clone() const;
   virtual ~PowerGraspable();
 
@@ -126,6 +188,7 @@ class PincerGraspable : public Graspable
 public:
 
   PincerGraspable(const xmlNodePtr node);
+  static constexpr Type staticClassType() { return Type::PincerGraspable; }
   virtual Affordance* clone() const;
   virtual ~PincerGraspable();
 
@@ -140,6 +203,7 @@ class PalmGraspable : public Graspable
 public:
 
   PalmGraspable(const xmlNodePtr node);
+  static constexpr Type staticClassType() { return Type::PalmGraspable; }
   virtual Affordance* clone() const;
   virtual ~PalmGraspable();
 
@@ -154,6 +218,7 @@ class BallGraspable : public Graspable
 public:
 
   BallGraspable(const xmlNodePtr node);
+  static constexpr Type staticClassType() { return Type::BallGraspable; }
   virtual Affordance* clone() const;
   virtual ~BallGraspable();
   virtual bool check(const RcsGraph* graph) const;
@@ -167,6 +232,7 @@ class CircularGraspable : public Graspable
 public:
 
   CircularGraspable(const xmlNodePtr node);
+  static constexpr Type staticClassType() { return Type::CircularGraspable; }
   virtual Affordance* clone() const;
   virtual ~CircularGraspable();
 
@@ -180,6 +246,7 @@ class TwistGraspable : public Graspable
 public:
 
   TwistGraspable(const xmlNodePtr node);
+  static constexpr Type staticClassType() { return Type::TwistGraspable; }
   virtual Affordance* clone() const;
   virtual ~TwistGraspable();
 
@@ -192,6 +259,7 @@ class Twistable : public TwistGraspable
 public:
 
   Twistable(const xmlNodePtr node);
+  static constexpr Type staticClassType() { return Type::Twistable; }
   virtual Affordance* clone() const;
   virtual ~Twistable();
 };
@@ -202,6 +270,7 @@ class PushSwitchable : public Affordance
 public:
 
   PushSwitchable(const xmlNodePtr node);
+  static constexpr Type staticClassType() { return Type::PushSwitchable; }
   virtual Affordance* clone() const;
   virtual ~PushSwitchable();
 
@@ -217,6 +286,7 @@ class Supportable : public Affordance
 public:
 
   Supportable(const xmlNodePtr node);
+  static constexpr Type staticClassType() { return Type::Supportable; }
   virtual Affordance* clone() const;
   virtual ~Supportable();
 
@@ -230,6 +300,7 @@ class Stackable : public Affordance
 public:
 
   Stackable(const xmlNodePtr node);
+  static constexpr Type staticClassType() { return Type::Stackable; }
   virtual Affordance* clone() const;
   virtual ~Stackable();
 
@@ -243,6 +314,7 @@ class Containable : public Affordance
 public:
 
   Containable(const xmlNodePtr node);
+  static constexpr Type staticClassType() { return Type::Containable; }
   virtual Affordance* clone() const;
   virtual ~Containable();
   virtual void print() const;
@@ -258,6 +330,7 @@ class Pourable : public Affordance
 public:
 
   Pourable(const xmlNodePtr node);
+  static constexpr Type staticClassType() { return Type::Pourable; }
   virtual Affordance* clone() const;
   virtual ~Pourable();
 };
@@ -268,6 +341,7 @@ class PointPushable : public Affordance
 public:
 
   PointPushable(const xmlNodePtr node);
+  static constexpr Type staticClassType() { return Type::PointPushable; }
   virtual Affordance* clone() const;
   virtual ~PointPushable();
 };
@@ -278,6 +352,7 @@ class PointPokable : public Affordance
 public:
 
   PointPokable(const xmlNodePtr node);
+  static constexpr Type staticClassType() { return Type::PointPokable; }
   virtual Affordance* clone() const;
   virtual ~PointPokable();
 };
@@ -288,6 +363,7 @@ class Hingeable : public Affordance
 public:
 
   Hingeable(const xmlNodePtr node);
+  static constexpr Type staticClassType() { return Type::Hingeable; }
   virtual Affordance* clone() const;
   virtual ~Hingeable();
 };
@@ -298,6 +374,7 @@ class Dispensible : public Affordance
 public:
 
   Dispensible(const xmlNodePtr node);
+  static constexpr Type staticClassType() { return Type::Dispensible; }
   virtual Affordance* clone() const;
   virtual ~Dispensible();
 };
@@ -308,6 +385,7 @@ class Wettable : public Affordance
 public:
 
   Wettable(const xmlNodePtr node);
+  static constexpr Type staticClassType() { return Type::Wettable; }
   virtual Affordance* clone() const;
   virtual ~Wettable();
 };
@@ -318,9 +396,12 @@ class Openable : public Affordance
 public:
 
   Openable(const xmlNodePtr node);
+  static constexpr Type staticClassType() { return Type::Openable; }
   virtual Affordance* clone() const;
   virtual ~Openable();
 
+  // Shared between copies of the entity, call
+  // AffordanceEntity::detachAffordances() before changing it.
   bool isOpen;
 };
 
@@ -47,6 +47,7 @@
 
 #include <algorithm>
 #include <exception>
+#include <mutex>
 
 /*
 
@@ -62,7 +63,15 @@ physically interact with an affordance model.
 namespace aff
 {
 
-AffordanceEntity::AffordanceEntity()
+// Guards the affordance pointers against detachAffordances() while copying
+static std::mutex& affordanceCopyMtx()
+{
+  static std::mutex mtx;
+  return mtx;
+}
+
+AffordanceEntity::AffordanceEntity() :
+  copyToken(std::make_shared<const int>(0)), typeMask(0)
 {
 }
 
@@ -78,22 +87,31 @@ AffordanceEntity& AffordanceEntity::operator= (const AffordanceEntity& copyFromM
   bdyName = copyFromMe.bdyName;
   id = copyFromMe.id;
   type = copyFromMe.type;
-  for (size_t i=0; i<affordances.size(); ++i)
-  {
-    delete affordances[i];
-  }
-  affordances.clear();
 
-  for (size_t i=0; i<copyFromMe.affordances.size(); ++i)
+  // Only the references are copied, the affordances are shared.
   {
-    affordances.push_back(copyFromMe.affordances[i]->clone());
+    std::lock_guard<std::mutex> lock(affordanceCopyMtx());
+    affordances = copyFromMe.affordances;
+    affordanceArena = copyFromMe.affordanceArena;
+    copyToken = copyFromMe.copyToken;
   }
+  affordanceMasks = copyFromMe.affordanceMasks;
+  requiredMasks = copyFromMe.requiredMasks;
+  typeMask = copyFromMe.typeMask;
 
   return *this;
 }
 
-AffordanceEntity::AffordanceEntity(const xmlNodePtr node)
+AffordanceEntity::AffordanceEntity(const xmlNodePtr node,
+                                   std::shared_ptr<AffordanceArena> arena) :
+  affordanceArena(arena), copyToken(std::make_shared<const int>(0)),
+  typeMask(0)
 {
+  if (!affordanceArena)
+  {
+    affordanceArena = std::make_shared<AffordanceArena>();
+  }
+
   bdyName = Rcs::getXMLNodePropertySTLString(node, "body");
   RCHECK_MSG(!bdyName.empty(), "Found AffordanceEntity without body name");
   name = bdyName;
@@ -115,76 +133,76 @@ AffordanceEntity::AffordanceEntity(const xmlNodePtr node)
   {
     if (isXMLNodeNameNoCase(child, "PowerGraspable"))
     {
-      affordances.push_back(new PowerGraspable(child));
+      affordances.push_back(affordanceArena->create<PowerGraspable>(child));
     }
     else if (isXMLNodeNameNoCase(child, "PincerGraspable"))
     {
-      affordances.push_back(new PincerGraspable(child));
+      affordances.push_back(affordanceArena->create<PincerGraspable>(child));
     }
     else if (isXMLNodeNameNoCase(child, "PalmGraspable"))
     {
-      affordances.push_back(new PalmGraspable(child));
+      affordances.push_back(affordanceArena->create<PalmGraspable>(child));
     }
     else if (isXMLNodeNameNoCase(child, "BallGraspable"))
     {
-      affordances.push_back(new BallGraspable(child));
+      affordances.push_back(affordanceArena->create<BallGraspable>(child));
     }
     else if (isXMLNodeNameNoCase(child, "CircularGraspable"))
     {
-      affordances.push_back(new CircularGraspable(child));
+      affordances.push_back(affordanceArena->create<CircularGraspable>(child));
     }
     else if (isXMLNodeNameNoCase(child, "TwistGraspable"))
     {
-      affordances.push_back(new TwistGraspable(child));
+      affordances.push_back(affordanceArena->create<TwistGraspable>(child));
     }
     else if (isXMLNodeNameNoCase(child, "Twistable"))
     {
-      affordances.push_back(new Twistable(child));
+      affordances.push_back(affordanceArena->create<Twistable>(child));
     }
     else if (isXMLNodeNameNoCase(child, "PushSwitchable"))
     {
-      affordances.push_back(new PushSwitchable(child));
+      affordances.push_back(affordanceArena->create<PushSwitchable>(child));
     }
     else if (isXMLNodeNameNoCase(child, "Supportable"))
     {
-      Supportable* s = new Supportable(child);
+      Supportable* s = affordanceArena->create<Supportable>(child);
       affordances.push_back(s);
     }
     else if (isXMLNodeNameNoCase(child, "Stackable"))
     {
-      affordances.push_back(new Stackable(child));
+      affordances.push_back(affordanceArena->create<Stackable>(child));
     }
     else if (isXMLNodeNameNoCase(child, "Containable"))
     {
-      affordances.push_back(new Containable(child));
+      affordances.push_back(affordanceArena->create<Containable>(child));
     }
     else if (isXMLNodeNameNoCase(child, "Pourable"))
     {
-      affordances.push_back(new Pourable(child));
+      affordances.push_back(affordanceArena->create<Pourable>(child));
     }
     else if (isXMLNodeNameNoCase(child, "PointPushable"))
     {
-      affordances.push_back(new PointPushable(child));
+      affordances.push_back(affordanceArena->create<PointPushable>(child));
     }
     else if (isXMLNodeNameNoCase(child, "PointPokable"))
     {
-      affordances.push_back(new PointPokable(child));
+      affordances.push_back(affordanceArena->create<PointPokable>(child));
     }
     else if (isXMLNodeNameNoCase(child, "Hingeable"))
     {
-      affordances.push_back(new Hingeable(child));
+      affordances.push_back(affordanceArena->create<Hingeable>(child));
     }
     else if (isXMLNodeNameNoCase(child, "Dispensible"))
     {
-      affordances.push_back(new Dispensible(child));
+      affordances.push_back(affordanceArena->create<Dispensible>(child));
     }
     else if (isXMLNodeNameNoCase(child, "Wettable"))
     {
-      affordances.push_back(new Wettable(child));
+      affordances.push_back(affordanceArena->create<Wettable>(child));
     }
     else if (isXMLNodeNameNoCase(child, "Openable"))
     {
-      Openable* affordance = new Openable(child);
+      Openable* affordance = affordanceArena->create<Openable>(child);
       RLOG_CPP(0, "Assigning '" << bdyName << "' to Openable");
       affordance->frame = bdyName;   // \todo(MG): fix it. We need a frame to pass the check
       affordances.push_back(affordance);
@@ -194,26 +212,44 @@ AffordanceEntity::AffordanceEntity(const xmlNodePtr node)
     child = child->next;
   }
 
+  updateTypeMasks();
 }
 
 AffordanceEntity::AffordanceEntity(const AffordanceEntity& other) :
-  name(other.name), bdyName(other.bdyName), id(other.id), type(other.type)
+  name(other.name), bdyName(other.bdyName), id(other.id), type(other.type),
+  affordanceMasks(other.affordanceMasks), requiredMasks(other.requiredMasks),
+  typeMask(other.typeMask)
 {
-  for (size_t i=0; i<other.affordances.size(); ++i)
-  {
-    Affordance* ai = other.affordances[i]->clone();
-    NLOG(0, "ai is of type %s", ai->classname().c_str());
-    affordances.push_back(ai);
-  }
+  std::lock_guard<std::mutex> lock(affordanceCopyMtx());
+  affordances = other.affordances;
+  affordanceArena = other.affordanceArena;
+  copyToken = other.copyToken;
 }
 
 AffordanceEntity::~AffordanceEntity()
 {
+}
+
+void AffordanceEntity::detachAffordances()
+{
+  std::lock_guard<std::mutex> lock(affordanceCopyMtx());
+
+  if (copyToken.use_count() <= 1)
+  {
+    return;
+  }
+
+  // The arena might be shared with the other entities of the scene. We
+  // therefore create a small one for this entity only.
+  auto arena = std::make_shared<AffordanceArena>(0);
+
   for (size_t i=0; i<affordances.size(); ++i)
   {
-    delete affordances[i];
+    affordances[i] = arena->adopt(affordances[i]->clone());
   }
 
+  affordanceArena = arena;
+  copyToken = std::make_shared<const int>(0);
 }
 
 void AffordanceEntity::print() const
@@ -228,6 +264,21 @@ void AffordanceEntity::print() const
   }
 }
 
+void AffordanceEntity::updateTypeMasks()
+{
+  affordanceMasks.clear();
+  requiredMasks.clear();
+  typeMask = 0;
+
+  for (const Affordance* a : affordances)
+  {
+    affordanceMasks.push_back(Affordance::typeBit(a->classType));
+    requiredMasks.push_back(Affordance::maskFromTypes(a->requiredAffordances));
+    typeMask |= affordanceMasks.back();
+  }
+
+}
+
 bool AffordanceEntity::check(const RcsGraph* graph) const
 {
   bool success = true;
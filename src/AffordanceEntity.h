@@ -34,6 +34,9 @@
 #define AFF_AFFORDANCEENTITY_H
 
 #include "Affordance.h"
+#include "ObjectArena.h"
+
+#include <memory>
 
 /*
 
@@ -49,6 +52,8 @@ physically interact with an affordance model.
 namespace aff
 {
 
+typedef ObjectArena<Affordance> AffordanceArena;
+
 class AffordanceEntity
 {
 public:
@@ -57,14 +62,44 @@ public:
   std::string bdyName;
   std::string id;
   std::string type;
+
+  // The affordances are owned by affordanceArena, which is shared between
+  // all copies of an entity, and usually between all entities of a scene.
+  // Copying an entity therefore does not clone the affordances. Before
+  // modifying an affordance's state (e.g. the liquid levels of a
+  // Containable), detachAffordances() must be called so that the other
+  // copies remain unchanged (copy-on-write).
   std::vector<Affordance*> affordances;
+  std::shared_ptr<AffordanceArena> affordanceArena;
+
+  // Shared by all copies of this entity that use the same affordances. The
+  // arena can't tell this, since it is shared by all entities of a scene.
+  std::shared_ptr<const int> copyToken;
+
+  // Precomputed type masks for the matching functions in ActionScene.h. The
+  // vectors have the same order as affordances. Call updateTypeMasks() after
+  // modifying the affordances.
+  std::vector<Affordance::TypeMask> affordanceMasks;   // Bit of classType
+  std::vector<Affordance::TypeMask> requiredMasks;     // requiredAffordances
+  Affordance::TypeMask typeMask;                       // Union of all classTypes
 
   AffordanceEntity();
   AffordanceEntity& operator = (const AffordanceEntity&);
-  AffordanceEntity(const xmlNodePtr node);
+  // The affordances are created in the given arena. If it is NULL, the
+  // entity creates its own one.
+  AffordanceEntity(const xmlNodePtr node,
+                   std::shared_ptr<AffordanceArena> arena=nullptr);
   AffordanceEntity(const AffordanceEntity& other);
   virtual ~AffordanceEntity();
   void print() const;
+  void updateTypeMasks();
+
+  // Clones the affordances if they are shared with another copy of this
+  // entity. Pointers to affordances obtained before this call refer to the
+  // shared instances afterwards. Copying entities and detaching them is
+  // serialized by a mutex, so that a scene can be copied (e.g. into a
+  // snapshot) while an action detaches one of its entities.
+  void detachAffordances();
   virtual bool check(const RcsGraph* graph) const;
 
   // Checks if the RcsBody matching bdyName has a collideable shape.
@@ -33,6 +33,7 @@
 #include "Agent.h"
 #include "ActionScene.h"
 #include "Manipulator.h"
+#include "GazeSolver.h"
 
 #include <Rcs_typedef.h>
 #include <Rcs_shape.h>
@@ -44,8 +45,6 @@
 #include <Rcs_math.h>
 #include <Rcs_body.h>
 #include <Rcs_resourcePath.h>
-#include <TaskFactory.h>
-#include <IkSolverRMR.h>
 
 #include <algorithm>
 #include <exception>
@@ -129,7 +128,8 @@ void Agent::print() const
   std::cout << std::endl;
 }
 
-RobotAgent::RobotAgent(const xmlNodePtr node, const ActionScene* scene) : Agent(node, scene)
+RobotAgent::RobotAgent(const xmlNodePtr node, const ActionScene* scene) :
+  Agent(node, scene), gazeSolver(new GazeSolver())
 {
   type = "robot";
 }
@@ -142,86 +142,7 @@ int RobotAgent::getPanTilt(const RcsGraph* graph, const std::string& gazeTarget,
                            double panTilt[2], size_t maxIter, double eps,
                            double err[2]) const
 {
-  // "ptu_pan_joint" "ptu_tilt_joint"
-  RcsGraph* copyOfGraph = RcsGraph_clone(graph);
-
-  if (!copyOfGraph)
-  {
-    RLOG(1, "Graph for gazing IK could not be created");
-    return -1;
-  }
-
-  const RcsBody* gazeBdy = RcsGraph_getBodyByName(copyOfGraph, gazeTarget.c_str());
-  if (!gazeBdy)
-  {
-    RLOG(1, "gaze body '%s' not found", gazeTarget.c_str());
-    return -1;
-  }
-
-  const RcsJoint* panJoint = RcsGraph_getJointByName(copyOfGraph, "ptu_pan_joint");
-  if (!panJoint)
-  {
-    RLOG(1, "Pan joint 'ptu_pan_joint' not found");
-    return -1;
-  }
-
-  const RcsJoint* tiltJoint = RcsGraph_getJointByName(copyOfGraph, "ptu_tilt_joint");
-  if (!tiltJoint)
-  {
-    RLOG(1, "Tilt joint 'ptu_tilt_joint' not found");
-    return -1;
-  }
-
-  Rcs::ControllerBase controller(copyOfGraph);   // Takes ownership of graph
-
-  std::string cameraFrame = "head_kinect_rgb_link";
-  std::string xmlTask = "<Task name=\"Gaze\" controlVariable=\"XY\" effector=\"" +
-                        gazeTarget + "\" " + "refBdy=\"" + cameraFrame + "\" />";
-
-  Rcs::Task* task = Rcs::TaskFactory::createTask(xmlTask, controller.getGraph());
-  if (!task)
-  {
-    RLOG(1, "Gazing task could not be created");
-    return -1;
-  }
-  controller.add(task);
-
-  Rcs::IkSolverRMR ikSolver(&controller);
-
-  MatNd* dq_des = MatNd_createLike(copyOfGraph->q);
-  MatNd* x_des = MatNd_create(2,1);
-  MatNd* dx_des = MatNd_create(2,1);
-  MatNd* dH = NULL;
-  MatNd* a = NULL;
-  double lambda = 1.0e-8;
-  size_t iter = 0;
-
-  for (iter=0; iter<maxIter; ++iter)
-  {
-    controller.computeDX(dx_des, x_des);
-
-    if ((fabs(dx_des->ele[0])<eps) && (fabs(dx_des->ele[1])<eps))
-    {
-      break;
-    }
-
-    ikSolver.solveRightInverse(dq_des, dx_des, dH, a, lambda);
-    MatNd_addSelf(copyOfGraph->q, dq_des);
-    RcsGraph_setState(copyOfGraph, NULL, NULL);
-  }
-
-  panTilt[0] = MatNd_get(copyOfGraph->q, panJoint->jointIndex, 0);
-  panTilt[1] = MatNd_get(copyOfGraph->q, tiltJoint->jointIndex, 0);
-
-  if (err)
-  {
-    err[0] = fabs(dx_des->ele[0]);
-    err[1] = fabs(dx_des->ele[1]);
-  }
-
-  MatNd_destroyN(3, dq_des, x_des, dx_des);
-
-  return iter;
+  return gazeSolver->solve(graph, gazeTarget, panTilt, maxIter, eps, err);
 }
 
 HumanAgent::HumanAgent(const xmlNodePtr node, const ActionScene* scene) :
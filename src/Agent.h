@@ -35,11 +35,14 @@
 
 #include "Manipulator.h"
 
+#include <memory>
+
 
 namespace aff
 {
 
 class ActionScene;
+class GazeSolver;
 
 class Agent
 {
@@ -63,6 +66,11 @@ public:
   int getPanTilt(const RcsGraph* graph, const std::string& gazeTarget,
                  double panTilt[2], size_t maxIter, double eps,
                  double err[2]) const;
+
+private:
+
+  // Keeps its state between the calls of getPanTilt(), which is thread-safe.
+  std::unique_ptr<GazeSolver> gazeSolver;
 };
 
 class HumanAgent : public Agent
@@ -0,0 +1,991 @@
+/*******************************************************************************
+
+  Copyright (c) Honda Research Institute Europe GmbH.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+  IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT,
+  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+  OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+#include "BodyBVH.h"
+
+#include <Rcs_typedef.h>
+#include <Rcs_shape.h>
+#include <Rcs_body.h>
+#include <Rcs_math.h>
+#include <Rcs_macros.h>
+
+#include <algorithm>
+#include <queue>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+
+
+namespace aff
+{
+
+/*******************************************************************************
+ * Transforms the ray into the frame A_CI. The direction is expected to be
+ * normalized, so that the ray parameter t is the same in both frames.
+ ******************************************************************************/
+static void rayToFrame(const HTr* A_CI, const double origin[3],
+                       const double dir[3], double o_C[3], double d_C[3])
+{
+  double tmp[3];
+  Vec3d_sub(tmp, origin, A_CI->org);
+  Vec3d_rotate(o_C, (double(*)[3])A_CI->rot, tmp);
+  Vec3d_rotate(d_C, (double(*)[3])A_CI->rot, dir);
+}
+
+/*******************************************************************************
+ * Slab test of a ray against an axis-aligned box. On success, the entry and
+ * exit parameters are copied to tn and tf.
+ ******************************************************************************/
+static bool intersectRayBox(const double o[3], const double d[3],
+                            const double xyzMin[3], const double xyzMax[3],
+                            double* tn, double* tf)
+{
+  double t0 = -DBL_MAX, t1 = DBL_MAX;
+
+  for (int i = 0; i < 3; ++i)
+  {
+    if (fabs(d[i]) < 1.0e-12)
+    {
+      if ((o[i] < xyzMin[i]) || (o[i] > xyzMax[i]))
+      {
+        return false;
+      }
+      continue;
+    }
+
+    double ta = (xyzMin[i] - o[i]) / d[i];
+    double tb = (xyzMax[i] - o[i]) / d[i];
+    if (ta > tb)
+    {
+      std::swap(ta, tb);
+    }
+    t0 = std::max(t0, ta);
+    t1 = std::min(t1, tb);
+
+    if (t0 > t1)
+    {
+      return false;
+    }
+  }
+
+  *tn = t0;
+  *tf = t1;
+  return true;
+}
+
+/*******************************************************************************
+ * Ray against sphere with given center and radius.
+ ******************************************************************************/
+static bool intersectRaySphere(const double o[3], const double d[3],
+                               const double center[3], double r,
+                               double* tn, double* tf)
+{
+  double oc[3];
+  Vec3d_sub(oc, o, center);
+  const double b = Vec3d_innerProduct(oc, d);
+  const double c = Vec3d_innerProduct(oc, oc) - r*r;
+  const double disc = b*b - c;
+
+  if (disc < 0.0)
+  {
+    return false;
+  }
+
+  const double sq = sqrt(disc);
+  *tn = -b - sq;
+  *tf = -b + sq;
+  return true;
+}
+
+/*******************************************************************************
+ * Ray against a z-aligned cylinder of radius r between z0 and z1.
+ ******************************************************************************/
+static bool intersectRayCylinder(const double o[3], const double d[3],
+                                 double r, double z0, double z1,
+                                 double* tn, double* tf)
+{
+  double t0 = -DBL_MAX, t1 = DBL_MAX;
+  const double a = d[0]*d[0] + d[1]*d[1];
+  const double c = o[0]*o[0] + o[1]*o[1] - r*r;
+
+  if (a < 1.0e-12)
+  {
+    // Ray parallel to the axis
+    if (c > 0.0)
+    {
+      return false;
+    }
+  }
+  else
+  {
+    const double b = o[0]*d[0] + o[1]*d[1];
+    const double disc = b*b - a*c;
+
+    if (disc < 0.0)
+    {
+      return false;
+    }
+
+    const double sq = sqrt(disc);
+    t0 = (-b - sq) / a;
+    t1 = (-b + sq) / a;
+  }
+
+  // Clip with the caps
+  if (fabs(d[2]) < 1.0e-12)
+  {
+    if ((o[2] < z0) || (o[2] > z1))
+    {
+      return false;
+    }
+  }
+  else
+  {
+    double ta = (z0 - o[2]) / d[2];
+    double tb = (z1 - o[2]) / d[2];
+    if (ta > tb)
+    {
+      std::swap(ta, tb);
+    }
+    t0 = std::max(t0, ta);
+    t1 = std::min(t1, tb);
+  }
+
+  if (t0 > t1)
+  {
+    return false;
+  }
+
+  *tn = t0;
+  *tf = t1;
+  return true;
+}
+
+/*******************************************************************************
+ * Returns the first surface crossing along the ray of a convex volume given
+ * by its entry and exit parameters. If the ray starts inside the volume, this
+ * is the exit point.
+ ******************************************************************************/
+static bool firstCrossing(double tn, double tf, double* t)
+{
+  if (tn >= 0.0)
+  {
+    *t = tn;
+    return true;
+  }
+
+  if (tf >= 0.0)
+  {
+    *t = tf;
+    return true;
+  }
+
+  return false;
+}
+
+/*******************************************************************************
+ * Moeller-Trumbore ray triangle intersection.
+ ******************************************************************************/
+static bool intersectRayTriangle(const double o[3], const double d[3],
+                                 const double* v0, const double* v1,
+                                 const double* v2, double* t)
+{
+  double e1[3], e2[3], p[3], s[3], q[3];
+  Vec3d_sub(e1, v1, v0);
+  Vec3d_sub(e2, v2, v0);
+  Vec3d_crossProduct(p, d, e2);
+  const double det = Vec3d_innerProduct(e1, p);
+
+  if (fabs(det) < 1.0e-12)
+  {
+    return false;
+  }
+
+  const double invDet = 1.0/det;
+  Vec3d_sub(s, o, v0);
+  const double u = Vec3d_innerProduct(s, p)*invDet;
+
+  if ((u < 0.0) || (u > 1.0))
+  {
+    return false;
+  }
+
+  Vec3d_crossProduct(q, s, e1);
+  const double v = Vec3d_innerProduct(d, q)*invDet;
+
+  if ((v < 0.0) || (u + v > 1.0))
+  {
+    return false;
+  }
+
+  *t = Vec3d_innerProduct(e2, q)*invDet;
+  return *t >= 0.0;
+}
+
+/*******************************************************************************
+ * Ray against a shape, all in shape coordinates. Returns false for shape types
+ * that are not supported.
+ ******************************************************************************/
+static bool intersectRayShape(const RcsShape* shape, const double o[3],
+                              const double d[3], bool* hit, double* t)
+{
+  double tn = 0.0, tf = 0.0;
+  *hit = false;
+
+  switch (shape->type)
+  {
+    case RCSSHAPE_BOX:
+    {
+      double xyzMax[3], xyzMin[3];
+      Vec3d_constMul(xyzMax, shape->extents, 0.5);
+      Vec3d_constMul(xyzMin, shape->extents, -0.5);
+      *hit = intersectRayBox(o, d, xyzMin, xyzMax, &tn, &tf) && firstCrossing(tn, tf, t);
+      return true;
+    }
+
+    case RCSSHAPE_SPHERE:
+    {
+      *hit = intersectRaySphere(o, d, Vec3d_zeroVec(), shape->extents[0], &tn, &tf) &&
+             firstCrossing(tn, tf, t);
+      return true;
+    }
+
+    case RCSSHAPE_CYLINDER:
+    {
+      const double h = 0.5*shape->extents[2];
+      *hit = intersectRayCylinder(o, d, shape->extents[0], -h, h, &tn, &tf) &&
+             firstCrossing(tn, tf, t);
+      return true;
+    }
+
+    case RCSSHAPE_SSL:
+    {
+      // Union of a cylinder and two spheres. If the ray starts outside, the
+      // first entry is the hit. Otherwise, we take the farthest exit of the
+      // parts that contain the origin.
+      const double r = shape->extents[0], len = shape->extents[2];
+      double top[3];
+      Vec3d_set(top, 0.0, 0.0, len);
+      double tIn = DBL_MAX, tOut = -DBL_MAX;
+      bool inside = false;
+
+      auto addPart = [&](bool partHit)
+      {
+        if (!partHit || (tf < 0.0))
+        {
+          return;
+        }
+
+        if (tn >= 0.0)
+        {
+          tIn = std::min(tIn, tn);
+        }
+        else
+        {
+          inside = true;
+          tOut = std::max(tOut, tf);
+        }
+      };
+
+      addPart(intersectRayCylinder(o, d, r, 0.0, len, &tn, &tf));
+      addPart(intersectRaySphere(o, d, Vec3d_zeroVec(), r, &tn, &tf));
+      addPart(intersectRaySphere(o, d, top, r, &tn, &tf));
+
+      if (inside)
+      {
+        *t = tOut;
+        *hit = true;
+      }
+      else if (tIn < DBL_MAX)
+      {
+        *t = tIn;
+        *hit = true;
+      }
+      return true;
+    }
+
+    case RCSSHAPE_MESH:
+    {
+      const RcsMeshData* mesh = shape->mesh;
+
+      if (!mesh || !mesh->faces || !mesh->vertices)
+      {
+        return false;
+      }
+
+      double tMin = DBL_MAX, ti;
+      for (unsigned int i = 0; i < mesh->nFaces; ++i)
+      {
+        const unsigned int* f = &mesh->faces[3*i];
+        if (intersectRayTriangle(o, d, &mesh->vertices[3*f[0]],
+                                 &mesh->vertices[3*f[1]],
+                                 &mesh->vertices[3*f[2]], &ti) && (ti < tMin))
+        {
+          tMin = ti;
+        }
+      }
+
+      if (tMin < DBL_MAX)
+      {
+        *t = tMin;
+        *hit = true;
+      }
+      return true;
+    }
+
+    default:
+      break;
+  }
+
+  return false;
+}
+
+/*******************************************************************************
+ *
+ ******************************************************************************/
+static double distanceToBox(const double pt[3], const double xyzMin[3],
+                            const double xyzMax[3])
+{
+  double sqrDist = 0.0;
+
+  for (int i = 0; i < 3; ++i)
+  {
+    double di = 0.0;
+    if (pt[i] < xyzMin[i])
+    {
+      di = xyzMin[i] - pt[i];
+    }
+    else if (pt[i] > xyzMax[i])
+    {
+      di = pt[i] - xyzMax[i];
+    }
+    sqrDist += di*di;
+  }
+
+  return sqrt(sqrDist);
+}
+
+/*******************************************************************************
+ *
+ ******************************************************************************/
+BodyBVH::BodyBVH() : visitStamp(0), keyGraph(NULL), keyBodies(NULL), nBodies(0),
+  signature(0), valid(false), root(-1), numRebuilds(0), numRefits(0)
+{
+}
+
+BodyBVH& BodyBVH::threadInstance()
+{
+  static thread_local BodyBVH bvh;
+  return bvh;
+}
+
+void BodyBVH::invalidate()
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  valid = false;
+}
+
+/*******************************************************************************
+ * FNV-1a hash over everything the hierarchy depends on except the transforms.
+ ******************************************************************************/
+size_t BodyBVH::computeSignature(const RcsGraph* graph)
+{
+  uint64_t hash = 14695981039346656037ULL;
+
+  auto add = [&hash](const void* data, size_t len)
+  {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < len; ++i)
+    {
+      hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    }
+  };
+
+  add(&graph->nBodies, sizeof(graph->nBodies));
+  add(&graph->dof, sizeof(graph->dof));
+
+  for (unsigned int i = 0; i < graph->nBodies; ++i)
+  {
+    const RcsBody* bdy = &graph->bodies[i];
+    add(bdy->name, strlen(bdy->name));
+    add(&bdy->id, sizeof(bdy->id));
+    add(&bdy->parentId, sizeof(bdy->parentId));
+    add(&bdy->nShapes, sizeof(bdy->nShapes));
+
+    for (unsigned int j = 0; j < bdy->nShapes; ++j)
+    {
+      const RcsShape* shape = &bdy->shapes[j];
+      const unsigned int nFaces = shape->mesh ? shape->mesh->nFaces : 0;
+      add(&shape->type, sizeof(shape->type));
+      add(&shape->computeType, sizeof(shape->computeType));
+      add(shape->extents, sizeof(shape->extents));
+      add(&shape->A_CB, sizeof(HTr));
+      add(&nFaces, sizeof(nFaces));
+    }
+  }
+
+  return (size_t) hash;
+}
+
+/*******************************************************************************
+ * Brings the hierarchy in sync with the graph. Must be called with the mutex
+ * being locked.
+ ******************************************************************************/
+void BodyBVH::update(const RcsGraph* graph_)
+{
+  const bool sameGraph = (graph_ == keyGraph) && (graph_->bodies == keyBodies) &&
+                         (graph_->nBodies == nBodies) && (graph_->dof == q.size());
+
+  if (valid && sameGraph)
+  {
+    if (!refitChanged(graph_))
+    {
+      rebuild(graph_);
+    }
+    return;
+  }
+
+  const size_t newSignature = computeSignature(graph_);
+
+  if ((!valid) || (newSignature != signature) || (!refitAll(graph_)))
+  {
+    rebuild(graph_);
+  }
+}
+
+/*******************************************************************************
+ * Returns false if a body gained or lost its distance shapes.
+ ******************************************************************************/
+bool BodyBVH::refitAll(const RcsGraph* graph_)
+{
+  for (auto& leaf : leaves)
+  {
+    Node& node = nodes[leaf.node];
+    if (!RcsGraph_computeBodyAABB(graph_, leaf.bodyId, RCSSHAPE_COMPUTE_DISTANCE,
+                                  node.xyzMin, node.xyzMax, NULL))
+    {
+      return false;
+    }
+  }
+
+  // Inner nodes are created before their children, so that going backwards
+  // visits all children before their parents.
+  for (size_t i = nodes.size(); i > 0; --i)
+  {
+    Node& node = nodes[i-1];
+
+    if (node.bodyId != -1)
+    {
+      continue;
+    }
+
+    const Node& l = nodes[node.left];
+    const Node& r = nodes[node.right];
+
+    for (int j = 0; j < 3; ++j)
+    {
+      node.xyzMin[j] = std::min(l.xyzMin[j], r.xyzMin[j]);
+      node.xyzMax[j] = std::max(l.xyzMax[j], r.xyzMax[j]);
+    }
+  }
+
+  this->keyGraph = graph_;
+  this->keyBodies = graph_->bodies;
+  q.assign(graph_->q->ele, graph_->q->ele + graph_->dof);
+  numRefits += leaves.size();
+
+  return true;
+}
+
+/*******************************************************************************
+ * Refits the bodies below the dofs that changed since the last call. Returns
+ * false if a body gained or lost its distance shapes.
+ ******************************************************************************/
+bool BodyBVH::refitChanged(const RcsGraph* graph_)
+{
+  const double* q_now = graph_->q->ele;
+
+  if (memcmp(q.data(), q_now, q.size()*sizeof(double)) == 0)
+  {
+    return true;
+  }
+
+  visitStamp++;
+
+  for (size_t i = 0; i < q.size(); ++i)
+  {
+    if (q[i] == q_now[i])
+    {
+      continue;
+    }
+
+    q[i] = q_now[i];
+
+    for (int id : bodiesOfDof[i])
+    {
+      if (visited[id] == visitStamp)
+      {
+        continue;
+      }
+
+      visited[id] = visitStamp;
+      const int leafIdx = leafOfBody[id];
+      double xyzMin[3], xyzMax[3];
+
+      if (leafIdx == -1)
+      {
+        // Bodies without shapes are skipped, unless they got some
+        if (RcsGraph_computeBodyAABB(graph_, id, RCSSHAPE_COMPUTE_DISTANCE,
+                                     xyzMin, xyzMax, NULL))
+        {
+          return false;
+        }
+        continue;
+      }
+
+      Node& node = nodes[leaves[leafIdx].node];
+      if (!RcsGraph_computeBodyAABB(graph_, id, RCSSHAPE_COMPUTE_DISTANCE,
+                                    node.xyzMin, node.xyzMax, NULL))
+      {
+        return false;
+      }
+
+      refitUpwards(node.parent);
+      numRefits++;
+    }
+  }
+
+  return true;
+}
+
+void BodyBVH::rebuild(const RcsGraph* graph_)
+{
+  nodes.clear();
+  leaves.clear();
+  leafOfBody.assign(graph_->nBodies, -1);
+  visited.assign(graph_->nBodies, 0);
+  visitStamp = 0;
+  bodiesOfDof.assign(graph_->dof, std::vector<int>());
+  root = -1;
+  numRebuilds++;
+
+  this->keyGraph = graph_;
+  this->keyBodies = graph_->bodies;
+  this->nBodies = graph_->nBodies;
+  this->signature = computeSignature(graph_);
+  this->valid = true;
+  q.assign(graph_->q->ele, graph_->q->ele + graph_->dof);
+
+  for (unsigned int i = 0; i < graph_->nBodies; ++i)
+  {
+    const RcsBody* bdy = &graph_->bodies[i];
+
+    if (bdy->id == -1)
+    {
+      continue;
+    }
+
+    // All bodies below a joint move with it
+    if (bdy->jntId != -1)
+    {
+      std::vector<int> subTree(1, bdy->id);
+      RcsBody* subTreeRoot = RcsGraph_getBodyByName(graph_, bdy->name);
+      RCSBODY_TRAVERSE_CHILD_BODIES(graph_, subTreeRoot)
+      {
+        if (BODY->id != bdy->id)
+        {
+          subTree.push_back(BODY->id);
+        }
+      }
+
+      for (const RcsJoint* jnt = RCSJOINT_BY_ID(graph_, bdy->jntId); jnt;
+           jnt = RCSJOINT_BY_ID(graph_, jnt->nextId))
+      {
+        if (jnt->jointIndex < graph_->dof)
+        {
+          auto& dofBodies = bodiesOfDof[jnt->jointIndex];
+          dofBodies.insert(dofBodies.end(), subTree.begin(), subTree.end());
+        }
+      }
+    }
+
+    Node node;
+    if (!RcsGraph_computeBodyAABB(graph_, bdy->id, RCSSHAPE_COMPUTE_DISTANCE,
+                                  node.xyzMin, node.xyzMax, NULL))
+    {
+      continue;
+    }
+
+    node.parent = -1;
+    node.left = -1;
+    node.right = -1;
+    node.bodyId = bdy->id;
+    nodes.push_back(node);
+
+    Leaf leaf;
+    leaf.bodyId = bdy->id;
+    leaf.node = (int) nodes.size() - 1;
+    leaves.push_back(leaf);
+    leafOfBody[bdy->id] = (int) leaves.size() - 1;
+  }
+
+  if (leaves.empty())
+  {
+    return;
+  }
+
+  std::vector<size_t> leafIndices(leaves.size());
+  for (size_t i = 0; i < leafIndices.size(); ++i)
+  {
+    leafIndices[i] = i;
+  }
+
+  root = buildRecursive(leafIndices, 0, leafIndices.size(), -1);
+}
+
+/*******************************************************************************
+ * Top-down construction: The leaves are split at the median of their centers
+ * along the longest axis of the node's box.
+ ******************************************************************************/
+int BodyBVH::buildRecursive(std::vector<size_t>& leafIndices, size_t begin,
+                            size_t end, int parent)
+{
+  if (end - begin == 1)
+  {
+    const int nodeIdx = leaves[leafIndices[begin]].node;
+    nodes[nodeIdx].parent = parent;
+    return nodeIdx;
+  }
+
+  Node node;
+  node.parent = parent;
+  node.bodyId = -1;
+  Vec3d_setElementsTo(node.xyzMin, DBL_MAX);
+  Vec3d_setElementsTo(node.xyzMax, -DBL_MAX);
+
+  for (size_t i = begin; i < end; ++i)
+  {
+    const Node& leafNode = nodes[leaves[leafIndices[i]].node];
+    for (int j = 0; j < 3; ++j)
+    {
+      node.xyzMin[j] = std::min(node.xyzMin[j], leafNode.xyzMin[j]);
+      node.xyzMax[j] = std::max(node.xyzMax[j], leafNode.xyzMax[j]);
+    }
+  }
+
+  int axis = 0;
+  for (int j = 1; j < 3; ++j)
+  {
+    if (node.xyzMax[j]-node.xyzMin[j] > node.xyzMax[axis]-node.xyzMin[axis])
+    {
+      axis = j;
+    }
+  }
+
+  const size_t mid = (begin + end) / 2;
+  std::nth_element(leafIndices.begin() + begin, leafIndices.begin() + mid,
+                   leafIndices.begin() + end, [&](size_t a, size_t b)
+  {
+    const Node& na = nodes[leaves[a].node];
+    const Node& nb = nodes[leaves[b].node];
+    return na.xyzMin[axis]+na.xyzMax[axis] < nb.xyzMin[axis]+nb.xyzMax[axis];
+  });
+
+  // The nodes vector might be re-allocated in the recursion, therefore we
+  // access it through indices only.
+  nodes.push_back(node);
+  const int nodeIdx = (int) nodes.size() - 1;
+  const int left = buildRecursive(leafIndices, begin, mid, nodeIdx);
+  const int right = buildRecursive(leafIndices, mid, end, nodeIdx);
+  nodes[nodeIdx].left = left;
+  nodes[nodeIdx].right = right;
+
+  return nodeIdx;
+}
+
+void BodyBVH::refitUpwards(int nodeIdx)
+{
+  while (nodeIdx != -1)
+  {
+    Node& node = nodes[nodeIdx];
+    const Node& l = nodes[node.left];
+    const Node& r = nodes[node.right];
+
+    for (int j = 0; j < 3; ++j)
+    {
+      node.xyzMin[j] = std::min(l.xyzMin[j], r.xyzMin[j]);
+      node.xyzMax[j] = std::max(l.xyzMax[j], r.xyzMax[j]);
+    }
+
+    nodeIdx = node.parent;
+  }
+}
+
+/*******************************************************************************
+ * Exact ray test against all distance shapes of the body. Shape types that
+ * are not supported are approximated by the body's bounding box.
+ ******************************************************************************/
+bool BodyBVH::rayHitsBody(const RcsBody* body, const Node& leafNode,
+                          const double origin[3], const double dir[3],
+                          double* t) const
+{
+  bool hitAny = false;
+  *t = DBL_MAX;
+
+  RCSBODY_TRAVERSE_SHAPES(body)
+  {
+    if ((SHAPE->type == RCSSHAPE_REFFRAME) ||
+        (!RcsShape_isOfComputeType(SHAPE, RCSSHAPE_COMPUTE_DISTANCE)))
+    {
+      continue;
+    }
+
+    HTr A_CI;
+    HTr_transform(&A_CI, &body->A_BI, &SHAPE->A_CB);
+    double o_C[3], d_C[3], ti = 0.0;
+    bool hit = false;
+    rayToFrame(&A_CI, origin, dir, o_C, d_C);
+
+    if (!intersectRayShape(SHAPE, o_C, d_C, &hit, &ti))
+    {
+      // Unsupported shape type: Fall back to the body's bounding box
+      double tn, tf;
+      hit = intersectRayBox(origin, dir, leafNode.xyzMin, leafNode.xyzMax, &tn, &tf) &&
+            firstCrossing(tn, tf, &ti);
+    }
+
+    if (hit && (ti < *t))
+    {
+      *t = ti;
+      hitAny = true;
+    }
+  }
+
+  return hitAny;
+}
+
+/*******************************************************************************
+ *
+ ******************************************************************************/
+const RcsBody* BodyBVH::raycast(const RcsGraph* graph, const double origin[3],
+                                const double dir_[3], bool rigidBodiesOnly,
+                                double closestLinePt[3], double* dist,
+                                const std::function<bool(const RcsBody*)>& ignore)
+{
+  double dir[3];
+  if (Vec3d_normalize(dir, dir_) == 0.0)
+  {
+    return NULL;
+  }
+
+  std::lock_guard<std::mutex> lock(mtx);
+  update(graph);
+
+  if (root == -1)
+  {
+    return NULL;
+  }
+
+  const RcsBody* closestBdy = NULL;
+  double tMin = DBL_MAX;
+  std::vector<int> stack;
+  stack.push_back(root);
+
+  while (!stack.empty())
+  {
+    const Node& node = nodes[stack.back()];
+    stack.pop_back();
+
+    // Prune sub-trees that are not hit, or that are farther away than the
+    // closest hit so far.
+    double tn, tf;
+    if ((!intersectRayBox(origin, dir, node.xyzMin, node.xyzMax, &tn, &tf)) ||
+        (tf < 0.0) || (tn > tMin))
+    {
+      continue;
+    }
+
+    if (node.bodyId == -1)
+    {
+      stack.push_back(node.left);
+      stack.push_back(node.right);
+      continue;
+    }
+
+    const RcsBody* bdy = &graph->bodies[node.bodyId];
+
+    if ((rigidBodiesOnly && (!bdy->rigid_body_joints)) || (ignore && ignore(bdy)))
+    {
+      continue;
+    }
+
+    double t;
+    if (rayHitsBody(bdy, node, origin, dir, &t) && (t < tMin))
+    {
+      tMin = t;
+      closestBdy = bdy;
+    }
+  }
+
+  if (closestBdy)
+  {
+    if (closestLinePt)
+    {
+      for (int i = 0; i < 3; ++i)
+      {
+        closestLinePt[i] = origin[i] + tMin*dir[i];
+      }
+    }
+
+    if (dist)
+    {
+      *dist = tMin;
+    }
+  }
+
+  return closestBdy;
+}
+
+std::vector<int> BodyBVH::overlap(const RcsGraph* graph,
+                                  const double xyzMin[3],
+                                  const double xyzMax[3])
+{
+  std::vector<int> res;
+  std::lock_guard<std::mutex> lock(mtx);
+  update(graph);
+
+  if (root == -1)
+  {
+    return res;
+  }
+
+  std::vector<int> stack;
+  stack.push_back(root);
+
+  while (!stack.empty())
+  {
+    const Node& node = nodes[stack.back()];
+    stack.pop_back();
+
+    bool overlaps = true;
+    for (int j = 0; j < 3; ++j)
+    {
+      if ((node.xyzMin[j] > xyzMax[j]) || (node.xyzMax[j] < xyzMin[j]))
+      {
+        overlaps = false;
+        break;
+      }
+    }
+
+    if (!overlaps)
+    {
+      continue;
+    }
+
+    if (node.bodyId == -1)
+    {
+      stack.push_back(node.left);
+      stack.push_back(node.right);
+    }
+    else
+    {
+      res.push_back(node.bodyId);
+    }
+  }
+
+  return res;
+}
+
+/*******************************************************************************
+ * Best-first search with a priority queue ordered by the distance of the
+ * point to the node's box.
+ ******************************************************************************/
+std::vector<int> BodyBVH::nearest(const RcsGraph* graph, const double pt[3],
+                                  size_t k)
+{
+  std::vector<int> res;
+  std::lock_guard<std::mutex> lock(mtx);
+  update(graph);
+
+  if ((root == -1) || (k == 0))
+  {
+    return res;
+  }
+
+  typedef std::pair<double, int> QueueEntry;   // <distance, node index>
+  std::priority_queue<QueueEntry, std::vector<QueueEntry>,
+      std::greater<QueueEntry>> queue;
+  queue.push(std::make_pair(distanceToBox(pt, nodes[root].xyzMin, nodes[root].xyzMax), root));
+
+  while ((!queue.empty()) && (res.size() < k))
+  {
+    const Node& node = nodes[queue.top().second];
+    queue.pop();
+
+    // Since the box of a parent encloses the ones of its children, leaves
+    // are popped in the order of increasing distance.
+    if (node.bodyId != -1)
+    {
+      res.push_back(node.bodyId);
+      continue;
+    }
+
+    const Node& l = nodes[node.left];
+    const Node& r = nodes[node.right];
+    queue.push(std::make_pair(distanceToBox(pt, l.xyzMin, l.xyzMax), node.left));
+    queue.push(std::make_pair(distanceToBox(pt, r.xyzMin, r.xyzMax), node.right));
+  }
+
+  return res;
+}
+
+size_t BodyBVH::getNumLeaves() const
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  return leaves.size();
+}
+
+size_t BodyBVH::getNumRebuilds() const
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  return numRebuilds;
+}
+
+size_t BodyBVH::getNumRefits() const
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  return numRefits;
+}
+
+} // namespace aff
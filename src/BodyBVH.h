@@ -0,0 +1,161 @@
+/*******************************************************************************
+
+  Copyright (c) Honda Research Institute Europe GmbH.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+  IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT,
+  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+  OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+#ifndef AFF_BODYBVH_H
+#define AFF_BODYBVH_H
+
+#include <Rcs_graph.h>
+
+#include <vector>
+#include <functional>
+#include <mutex>
+
+namespace aff
+{
+
+/*! \brief Bounding volume hierarchy over the bodies of a graph that have
+ *         shapes with the distance compute type. It accelerates geometric
+ *         queries that otherwise need to go through all bodies of the graph
+ *         (raycasts, overlap and nearest neighbor searches).
+ *
+ *         All queries take the graph as argument. The hierarchy is keyed on
+ *         the graph: If the graph or its size differs from the previous
+ *         query, a signature of the body names, parents and shapes is
+ *         computed. The hierarchy is rebuilt if it changed, otherwise all
+ *         leaves are refitted. For the same graph, only the joint angles are
+ *         compared, and only the bodies below the joints that changed are
+ *         refitted. This requires that the transforms are consistent with q
+ *         (e.g. after RcsGraph_setState()). Shapes that are changed or added
+ *         without moving their body are only noticed after invalidate(). All
+ *         methods are thread-safe.
+ *
+ *         Since predictions run concurrently on copies of the graph, the
+ *         actions use one instance per thread (see threadInstance()).
+ */
+class BodyBVH
+{
+public:
+
+  BodyBVH();
+
+  /*! \brief Returns the instance of the calling thread.
+   */
+  static BodyBVH& threadInstance();
+
+  /*! \brief Returns the closest body that is hit by the ray starting at
+   *         origin in direction dir, or NULL if no body is hit. If a body is
+   *         hit, the hit point is copied to closestLinePt (if not NULL), and
+   *         the distance between origin and hit point to dist (if not NULL).
+   *         If rigidBodiesOnly is true, only bodies with rigid body joints
+   *         are considered. Bodies for which ignore returns true are passed
+   *         through, so that the bodies behind them can be hit. This is a
+   *         replacement for RcsBody_closestInDirection() and
+   *         RcsBody_closestRigidBodyInDirection().
+   */
+  const RcsBody* raycast(const RcsGraph* graph, const double origin[3],
+                         const double dir[3], bool rigidBodiesOnly,
+                         double closestLinePt[3], double* dist,
+                         const std::function<bool(const RcsBody*)>& ignore=nullptr);
+
+  /*! \brief Returns the ids of all bodies whose axis-aligned bounding box
+   *         overlaps with the box given by xyzMin and xyzMax.
+   */
+  std::vector<int> overlap(const RcsGraph* graph, const double xyzMin[3],
+                           const double xyzMax[3]);
+
+  /*! \brief Returns the ids of the k bodies whose axis-aligned bounding boxes
+   *         are closest to the point, sorted by increasing distance.
+   */
+  std::vector<int> nearest(const RcsGraph* graph, const double pt[3], size_t k);
+
+  /*! \brief Rebuilds the hierarchy at the next query.
+   */
+  void invalidate();
+
+  size_t getNumLeaves() const;
+  size_t getNumRebuilds() const;
+  size_t getNumRefits() const;
+
+private:
+
+  struct Node
+  {
+    double xyzMin[3];
+    double xyzMax[3];
+    int parent;
+    int left;
+    int right;
+    int bodyId;   // -1 for inner nodes
+  };
+
+  struct Leaf
+  {
+    int bodyId;
+    int node;
+  };
+
+  void update(const RcsGraph* graph);
+  void rebuild(const RcsGraph* graph);
+  bool refitAll(const RcsGraph* graph);
+  bool refitChanged(const RcsGraph* graph);
+  static size_t computeSignature(const RcsGraph* graph);
+  int buildRecursive(std::vector<size_t>& leafIndices, size_t begin,
+                     size_t end, int parent);
+  void refitUpwards(int node);
+  bool rayHitsBody(const RcsBody* body, const Node& leafNode,
+                   const double origin[3], const double dir[3],
+                   double* t) const;
+
+  std::vector<Node> nodes;
+  std::vector<Leaf> leaves;
+  std::vector<int> leafOfBody;                  // -1 for bodies without leaf
+  std::vector<std::vector<int>> bodiesOfDof;    // Bodies moved by each dof
+  std::vector<size_t> visited;                  // Per body, see refitChanged()
+  size_t visitStamp;
+
+  // Key of the graph the hierarchy has been built or refitted for
+  const RcsGraph* keyGraph;
+  const RcsBody* keyBodies;
+  unsigned int nBodies;
+  size_t signature;
+  std::vector<double> q;
+  bool valid;
+
+  int root;
+  size_t numRebuilds;
+  size_t numRefits;
+  mutable std::mutex mtx;
+};
+
+} // namespace aff
+
+#endif // AFF_BODYBVH_H
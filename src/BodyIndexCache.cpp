@@ -0,0 +1,150 @@
+/*******************************************************************************
+
+  Copyright (c) Honda Research Institute Europe GmbH.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+  IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT,
+  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+  OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+#include "BodyIndexCache.h"
+
+#include <Rcs_macros.h>
+
+#include <cstring>
+
+
+namespace aff
+{
+
+static thread_local size_t numStringCompares = 0;
+
+BodyIndexCache::BodyIndexCache(const std::vector<std::string>& names_) :
+  names(names_), ids(names_.size(), -1), topologyHash(0), resolved(false),
+  keyGraph(NULL), keyBodies(NULL), keyNumBodies(0)
+{
+}
+
+void BodyIndexCache::getBodies(const RcsGraph* graph, const RcsBody* bodies[])
+{
+  const bool keyChanged = (graph != keyGraph) || (graph->bodies != keyBodies) ||
+                          (graph->nBodies != keyNumBodies);
+
+  if ((!resolved) || keyChanged)
+  {
+    const uint64_t hash = computeTopologyHash(graph);
+
+    if ((!resolved) || (hash != topologyHash))
+    {
+      RLOG(5, "Resolving %zu body names", names.size());
+
+      for (size_t i = 0; i < names.size(); ++i)
+      {
+        ids[i] = resolve(graph, names[i].c_str());
+      }
+
+      topologyHash = hash;
+      resolved = true;
+    }
+
+    keyGraph = graph;
+    keyBodies = graph->bodies;
+    keyNumBodies = graph->nBodies;
+  }
+
+  for (size_t i = 0; i < ids.size(); ++i)
+  {
+    bodies[i] = (ids[i] == -1) ? NULL : &graph->bodies[ids[i]];
+  }
+}
+
+int BodyIndexCache::resolve(const RcsGraph* graph, const char* name)
+{
+  size_t nCompares = 0;
+  int id = -1;
+
+  for (unsigned int i = 0; i < graph->nBodies; ++i)
+  {
+    const RcsBody* bdy = &graph->bodies[i];
+
+    if (bdy->id == -1)
+    {
+      continue;
+    }
+
+    nCompares++;
+    if (STREQ(bdy->name, name))
+    {
+      id = bdy->id;
+      break;
+    }
+  }
+
+  countStringCompares(nCompares);
+
+  return id;
+}
+
+uint64_t BodyIndexCache::computeTopologyHash(const RcsGraph* graph)
+{
+  uint64_t hash = 14695981039346656037ULL;
+
+  auto add = [&hash](const void* data, size_t len)
+  {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < len; ++i)
+    {
+      hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    }
+  };
+
+  add(&graph->nBodies, sizeof(graph->nBodies));
+
+  for (unsigned int i = 0; i < graph->nBodies; ++i)
+  {
+    const RcsBody* bdy = &graph->bodies[i];
+    add(bdy->name, strlen(bdy->name) + 1);
+    add(&bdy->id, sizeof(bdy->id));
+    add(&bdy->parentId, sizeof(bdy->parentId));
+  }
+
+  countStringCompares(graph->nBodies);
+
+  return hash;
+}
+
+void BodyIndexCache::countStringCompares(size_t n)
+{
+  numStringCompares += n;
+}
+
+size_t BodyIndexCache::getStringCompares()
+{
+  return numStringCompares;
+}
+
+}   // namespace aff
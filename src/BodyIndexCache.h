@@ -0,0 +1,106 @@
+/*******************************************************************************
+
+  Copyright (c) Honda Research Institute Europe GmbH.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+  IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT,
+  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+  OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+#ifndef AFF_BODYINDEXCACHE_H
+#define AFF_BODYINDEXCACHE_H
+
+#include <Rcs_graph.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace aff
+{
+
+/*! \brief Resolves a fixed set of body names to body indices of a graph, so
+ *         that code running in each control or prediction step does not
+ *         need to compare strings. The cache is keyed on the graph pointer,
+ *         its bodies array and the number of bodies, which is checked in
+ *         constant time. Only if the key changes, the topology hash of the
+ *         graph is computed, and the names are resolved again if it differs
+ *         from the one they have been resolved for (e.g. after a graph
+ *         reload). A graph that is copied in place with another model of
+ *         the same size is not detected.
+ *
+ *         All name comparisons done through this class are counted per
+ *         thread. The counter can be read once per step to track regressions
+ *         of the per-step lookup cost of that thread.
+ */
+class BodyIndexCache
+{
+public:
+
+  BodyIndexCache(const std::vector<std::string>& names);
+
+  /*! \brief Writes the body for each name into the array bodies (NULL if it
+   *         does not exist in the graph). The array must have as many
+   *         elements as there are names.
+   */
+  void getBodies(const RcsGraph* graph, const RcsBody* bodies[]);
+
+  /*! \brief Returns the index of the body with the given name, or -1 if it
+   *         does not exist. The comparisons are counted.
+   */
+  static int resolve(const RcsGraph* graph, const char* name);
+
+  /*! \brief FNV-1a hash over the body names and the body hierarchy. It
+   *         doesn't depend on the state. Since it visits each name, it is
+   *         counted like one string comparison per body.
+   */
+  static uint64_t computeTopologyHash(const RcsGraph* graph);
+
+  static void countStringCompares(size_t n);
+
+  /*! \brief Returns the number of comparisons of the calling thread. The
+   *         counter is never reset, so that several users can measure the
+   *         difference between two points in time independently.
+   */
+  static size_t getStringCompares();
+
+private:
+
+  std::vector<std::string> names;
+  std::vector<int> ids;
+  uint64_t topologyHash;
+  bool resolved;
+
+  // Key of the graph the hash has last been computed for
+  const RcsGraph* keyGraph;
+  const RcsBody* keyBodies;
+  unsigned int keyNumBodies;
+};
+
+}   // namespace aff
+
+#endif // AFF_BODYINDEXCACHE_H
@@ -58,6 +58,57 @@ public:
 
   static std::map<std::string, Type> typeMap;
 
+  // Bit mask over the Type enum, see Affordance::TypeMask.
+  typedef uint32_t TypeMask;
+  static constexpr unsigned int numTypes = static_cast<unsigned int>(Type::GazeCapability) + 1;
+  static_assert(numTypes <= 8*sizeof(TypeMask), "Too many capability types for TypeMask");
+
+  // Direct base class of each type. This must follow the class hierarchy
+  // below, otherwise getCapabilities<T>() returns wrong results.
+  static constexpr Type parentType(Type t)
+  {
+    switch (t)
+    {
+      case Type::PowergraspCapability:
+      case Type::PincergraspCapability:
+      case Type::TwistgraspCapability:
+      case Type::CirculargraspCapability:
+      case Type::PalmgraspCapability:
+        return Type::GraspCapability;
+      default:
+        return Type::Capability;
+    }
+  }
+
+  static constexpr TypeMask typeBit(Type t)
+  {
+    return TypeMask(1) << static_cast<unsigned int>(t);
+  }
+
+  // Returns true if t is baseType, or a descendent of it.
+  static constexpr bool isA(Type t, Type baseType)
+  {
+    while ((t != baseType) && (t != Type::Capability))
+    {
+      t = parentType(t);
+    }
+    return t == baseType;
+  }
+
+  // Mask of baseType and all its descendents.
+  static constexpr TypeMask descendantMask(Type baseType)
+  {
+    TypeMask mask = 0;
+    for (unsigned int i = 0; i < numTypes; ++i)
+    {
+      if (isA(static_cast<Type>(i), baseType))
+      {
+        mask |= typeBit(static_cast<Type>(i));
+      }
+    }
+    return mask;
+  }
+
   std::string frame;
   Type classType;
   std::string className;
@@ -68,6 +119,7 @@ public:
   static std::string stringFromType(Type aType);
 
   Capability(const xmlNodePtr node);
+  static constexpr Type staticClassType() { return Type::Capability; }
   virtual ~Capability();
   virtual Capability* clone() const;
   virtual void print() const;
@@ -79,6 +131,7 @@ class GraspCapability : public Capability
 public:
 
   GraspCapability(const xmlNodePtr node);
+  static constexpr Type staticClassType() { return Type::GraspCapability; }
   virtual ~GraspCapability();
   virtual Capability* clone() const;
 };
@@ -88,6 +141,7 @@ class PowergraspCapability : public GraspCapability
 public:
 
   PowergraspCapability(const xmlNodePtr node);
+  static constexpr Type staticClassType() { return Type::PowergraspCapability; }
   virtual ~PowergraspCapability();
   virtual Capability* clone() const;
 };
@@ -97,6 +151,7 @@ class PincergraspCapability : public GraspCapability
 public:
 
   PincergraspCapability(const xmlNodePtr node);
+  static constexpr Type staticClassType() { return Type::PincergraspCapability; }
   virtual ~PincergraspCapability();
   virtual Capability* clone() const;
 };
@@ -106,6 +161,7 @@ class TwistgraspCapability : public GraspCapability
 public:
 
   TwistgraspCapability(const xmlNodePtr node);
+  static constexpr Type staticClassType() { return Type::TwistgraspCapability; }
   virtual ~TwistgraspCapability();
   virtual Capability* clone() const;
 };
@@ -115,6 +171,7 @@ class CirculargraspCapability : public GraspCapability
 public:
 
   CirculargraspCapability(const xmlNodePtr node);
+  static constexpr Type staticClassType() { return Type::CirculargraspCapability; }
   virtual ~CirculargraspCapability();
   virtual Capability* clone() const;
   virtual bool check(const RcsGraph* graph) const;
@@ -127,6 +184,7 @@ class PalmgraspCapability : public GraspCapability
 public:
 
   PalmgraspCapability(const xmlNodePtr node);
+  static constexpr Type staticClassType() { return Type::PalmgraspCapability; }
   virtual ~PalmgraspCapability();
   virtual Capability* clone() const;
 };
@@ -136,6 +194,7 @@ class FingerpushCapability : public Capability
 public:
 
   FingerpushCapability(const xmlNodePtr node);
+  static constexpr Type staticClassType() { return Type::FingerpushCapability; }
   virtual ~FingerpushCapability();
   virtual Capability* clone() const;
 };
@@ -145,6 +204,7 @@ class GazeCapability : public Capability
 public:
 
   GazeCapability(const xmlNodePtr node);
+  static constexpr Type staticClassType() { return Type::GazeCapability; }
   virtual ~GazeCapability();
   virtual Capability* clone() const;
 };
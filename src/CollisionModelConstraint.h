@@ -33,6 +33,8 @@
 #ifndef TROPIC_COLLISIONMODELCONSTRAINT_H
 #define TROPIC_COLLISIONMODELCONSTRAINT_H
 
+#include "BodyIndexCache.h"
+
 #include <GraphConstraint.h>
 
 #include <Rcs_body.h>
@@ -55,7 +57,8 @@ public:
     GraphConstraint(),
     toggleTime(t),
     switchesOn(switchOn),
-    active(true)
+    active(true),
+    topologyHash(0)
   {
     setClassName("CollisionModelConstraint");
     bdyNames.push_back(bdyName);
@@ -67,7 +70,8 @@ public:
     bdyNames(names),
     toggleTime(t),
     switchesOn(switchOn),
-    active(true)
+    active(true),
+    topologyHash(0)
   {
     setClassName("CollisionModelConstraint");
   }
@@ -77,7 +81,9 @@ public:
     bdyNames(other.bdyNames),
     toggleTime(other.toggleTime),
     switchesOn(other.switchesOn),
-    active(other.active)
+    active(other.active),
+    bdyIds(other.bdyIds),
+    topologyHash(other.topologyHash)
   {
   }
 
@@ -104,39 +110,44 @@ public:
 
     if ((toggleTime<0.0) && (toggleTime>=-dt))
     {
+      // Fallback if the graph has been reloaded after setGraph()
+      if (aff::BodyIndexCache::computeTopologyHash(this->graph) != this->topologyHash)
+      {
+        resolveBodies();
+      }
 
-      RCSGRAPH_FOREACH_BODY(this->graph)
+      for (size_t i=0; i<bdyIds.size(); ++i)
       {
-        for (size_t i=0; i<bdyNames.size(); ++i)
+        if (bdyIds[i] == -1)
         {
-          if (STREQ(BODY->name, bdyNames[i].c_str()))
+          continue;
+        }
+
+        RcsBody* BODY = &this->graph->bodies[bdyIds[i]];
+        RLOG(5, "1 Body \"%s\" does %s",
+             BODY->name, switchesOn ? "collide" : "not collide");
+        for (unsigned int j=0; j<BODY->nShapes; ++j)
+        {
+          RLOG(5, "Going through shape %s", RcsShape_name(BODY->shapes[j].type));
+
+          //snprintf(BODY->shapes[j].color, RCS_MAX_NAMELEN, switchesOn ? "RED" : "GREEN");
+
+          RcsShape_setComputeType(&BODY->shapes[j], RCSSHAPE_COMPUTE_WIREFRAME, !switchesOn);
+
+          // We only switch on those shapes that have been distance shapes
+          // from the time point of initialization.
+
+          if (BODY->shapes[j].type==RCSSHAPE_MESH || BODY->shapes[j].type==RCSSHAPE_REFFRAME)
+            //if (/* switchesOn && */ (!distCalcIndices[i][j]))
           {
-            RLOG(5, "1 Body \"%s\" does %s",
-                 BODY->name, switchesOn ? "collide" : "not collide");
-            for (unsigned int j=0; j<BODY->nShapes; ++j)
-            {
-              RLOG(5, "Going through shape %s", RcsShape_name(BODY->shapes[j].type));
-
-              //snprintf(BODY->shapes[j].color, RCS_MAX_NAMELEN, switchesOn ? "RED" : "GREEN");
-
-              RcsShape_setComputeType(&BODY->shapes[j], RCSSHAPE_COMPUTE_WIREFRAME, !switchesOn);
-
-              // We only switch on those shapes that have been distance shapes
-              // from the time point of initialization.
-
-              if (BODY->shapes[j].type==RCSSHAPE_MESH || BODY->shapes[j].type==RCSSHAPE_REFFRAME)
-                //if (/* switchesOn && */ (!distCalcIndices[i][j]))
-              {
-                RLOG(5, "IGNORING shape %s", RcsShape_name(BODY->shapes[j].type));
-                continue;
-              }
-
-              RLOG(5, "2 Body \"%s\" does %s",
-                   BODY->name, switchesOn ? "collide" : "not collide");
-              RcsShape_setComputeType(&BODY->shapes[j], RCSSHAPE_COMPUTE_DISTANCE, switchesOn);
-              //snprintf(BODY->shapes[j].color, RCS_MAX_NAMELEN, switchesOn ? "RED" : "GREEN");
-            }
+            RLOG(5, "IGNORING shape %s", RcsShape_name(BODY->shapes[j].type));
+            continue;
           }
+
+          RLOG(5, "2 Body \"%s\" does %s",
+               BODY->name, switchesOn ? "collide" : "not collide");
+          RcsShape_setComputeType(&BODY->shapes[j], RCSSHAPE_COMPUTE_DISTANCE, switchesOn);
+          //snprintf(BODY->shapes[j].color, RCS_MAX_NAMELEN, switchesOn ? "RED" : "GREEN");
         }
       }
 
@@ -166,41 +177,51 @@ public:
   void setGraph(RcsGraph* newGraph)
   {
     GraphConstraint::setGraph(newGraph);
+    resolveBodies();
+  }
+
+
+
+protected:
+
+  // The body indices are resolved once when the constraint is applied to a
+  // graph, so that no names are compared during the trajectory steps.
+  void resolveBodies()
+  {
+    bdyIds.resize(bdyNames.size());
+    this->topologyHash = aff::BodyIndexCache::computeTopologyHash(this->graph);
 
     // In addition, we memorize the original distance calculation of each
     // shape so that we can reset them to their original state.
     distCalcIndices.resize(bdyNames.size());
 
-    RCSGRAPH_FOREACH_BODY(this->graph)
+    for (size_t i=0; i<bdyNames.size(); ++i)
     {
-      for (size_t i=0; i<bdyNames.size(); ++i)
-      {
-        if (STREQ(BODY->name, bdyNames[i].c_str()))
-        {
-          distCalcIndices[i].resize(BODY->nShapes);
-
-          for (unsigned int j=0; j<BODY->nShapes; ++j)
-          {
-            distCalcIndices[i][j] = RcsShape_isOfComputeType(&BODY->shapes[j], RCSSHAPE_COMPUTE_DISTANCE) ? true : false;
-          }
+      bdyIds[i] = aff::BodyIndexCache::resolve(this->graph, bdyNames[i].c_str());
 
-        }   // if (STREQ(BODY->name, bdyNames[i].c_str()))
-
-      }   // for (size_t i=0; i<bdyNames.size(); ++i)
+      if (bdyIds[i] == -1)
+      {
+        distCalcIndices[i].clear();
+        continue;
+      }
 
-    }   // RCSGRAPH_FOREACH_BODY(this->graph)
+      const RcsBody* bdy = &this->graph->bodies[bdyIds[i]];
+      distCalcIndices[i].resize(bdy->nShapes);
 
+      for (unsigned int j=0; j<bdy->nShapes; ++j)
+      {
+        distCalcIndices[i][j] = RcsShape_isOfComputeType(&bdy->shapes[j], RCSSHAPE_COMPUTE_DISTANCE) ? true : false;
+      }
+    }
   }
 
-
-
-protected:
-
   std::vector<std::string> bdyNames;
   std::vector<std::vector<bool>> distCalcIndices;
   double toggleTime;
   bool switchesOn;
   bool active;
+  std::vector<int> bdyIds;
+  uint64_t topologyHash;
 };
 
 
@@ -38,12 +38,103 @@
 #define RCS_COMPONENTBASE_H
 
 #include "EntityBase.h"
+#include "HardwareDispatcher.h"
+
+#include <Rcs_timer.h>
+
+#include <memory>
+#include <typeinfo>
 
 
 
 namespace aff
 {
 
+/*! \brief Part of the ComponentSubscriber that does not depend on the
+ *         event's arguments.
+ */
+class ComponentSubscriberBase
+{
+public:
+
+  ComponentSubscriberBase(EntityBase* entity_, const std::string& eventName_,
+                          size_t id_) :
+    entity(entity_), eventName(eventName_), id(id_), dispatcher(NULL)
+  {
+  }
+
+  virtual ~ComponentSubscriberBase()
+  {
+  }
+
+  const std::string& getEventName() const
+  {
+    return eventName;
+  }
+
+  void setDispatcher(HardwareDispatcher* dispatcher_)
+  {
+    dispatcher = dispatcher_;
+  }
+
+protected:
+
+  EntityBase* entity;
+  std::string eventName;
+  size_t id;
+  std::atomic<HardwareDispatcher*> dispatcher;
+};
+
+/*! \brief Forwards an event to the member function of a component. If
+ *         profiling is enabled, the duration of the call is recorded. If a
+ *         dispatcher is set, the member function is called in its thread
+ *         pool, and this call returns immediately.
+ */
+template<typename Obj, typename Fp, typename ...Args>
+class ComponentSubscriber : public ComponentSubscriberBase
+{
+public:
+
+  ComponentSubscriber(EntityBase* entity_, const std::string& eventName_,
+                      size_t id_, Obj* obj_, Fp fp_) :
+    ComponentSubscriberBase(entity_, eventName_, id_), obj(obj_), fp(fp_)
+  {
+  }
+
+  void call(Args... args)
+  {
+    HardwareDispatcher* d = dispatcher;
+    if (d)
+    {
+      d->dispatch([this, args...]()
+      {
+        invoke(args...);
+      });
+      return;
+    }
+
+    invoke(std::forward<Args>(args)...);
+  }
+
+private:
+
+  void invoke(Args... args)
+  {
+    if (!entity->getProfiling())
+    {
+      (obj->*fp)(std::forward<Args>(args)...);
+      return;
+    }
+
+    const double t0 = Timer_getSystemTime();
+    (obj->*fp)(std::forward<Args>(args)...);
+    entity->getProfiler()->record(id, t0, Timer_getSystemTime()-t0);
+  }
+
+  Obj* obj;
+  Fp fp;
+};
+
 /*! \brief Base class for all components. It stores a reference to the
  *         event system so that it can conveniently subscribe and publish.
  *         All subscriptions are stored in an internal vector of
@@ -75,6 +166,30 @@ public:
     return this->entity;
   }
 
+  /*! \brief Calls this component's subscribers to the event through the
+   *         dispatcher, or directly again if it is NULL.
+   */
+  void setDispatcher(const std::string& eventName, HardwareDispatcher* dispatcher)
+  {
+    for (auto& s : subscribers)
+    {
+      if (s->getEventName() == eventName)
+      {
+        s->setDispatcher(dispatcher);
+      }
+    }
+  }
+
+  /*! \brief Returns the names of the joints that this component writes into
+   *         the graph on UpdateGraph. Components returning an empty vector
+   *         (the default) are not updated concurrently to others, see
+   *         HardwareDispatcher.
+   */
+  virtual std::vector<std::string> getWrittenJoints() const
+  {
+    return std::vector<std::string>();
+  }
+
   /*! \brief Polymorphic destructor. Empties the subscriptions vector.
    */
   virtual ~ComponentBase()
@@ -98,9 +213,7 @@ protected:
     {
       throw std::invalid_argument("Passed function is not a member of this instance.");
     }
-    auto sh = this->entity->subscribe(name, fp, thisCast);
-    subscriptions.emplace_back(sh);
-    return sh;
+    return subscribeProfiled<Args...>(name, thisCast, fp);
   }
 
   template<typename ...Args, typename T>
@@ -111,9 +224,7 @@ protected:
     {
       throw std::invalid_argument("Passed function is not a member of this instance.");
     }
-    auto sh = this->entity->subscribe(name, fp, thisCast);
-    subscriptions.emplace_back(sh);
-    return sh;
+    return subscribeProfiled<Args...>(name, thisCast, fp);
   }
 
 
@@ -125,9 +236,7 @@ protected:
     {
       throw std::invalid_argument("Passed function is not a member of this instance.");
     }
-    auto sh = this->entity->subscribe(name, fp, thisCast, ES::ignore_result);
-    subscriptions.emplace_back(sh);
-    return sh;
+    return subscribeProfiled<Args...>(name, thisCast, fp);
   }
 
   template<typename ...Args, typename Return, typename T>
@@ -138,20 +247,39 @@ protected:
     {
       throw std::invalid_argument("Passed function is not a member of this instance.");
     }
-    auto sh = this->entity->subscribe(name, fp, thisCast, ES::ignore_result);
-    subscriptions.emplace_back(sh);
-    return sh;
+    return subscribeProfiled<Args...>(name, thisCast, fp);
   }
 
   virtual void unsubscribe()
   {
     subscriptions.clear();
+    this->entity->removeComponentSubscriptions(this);
   }
 
 private:
 
+  /*! \brief Subscribes through a ComponentSubscriber. The subscriber is
+   *         named after the component's class. A result of fp is ignored.
+   */
+  template<typename ...Args, typename Obj, typename Fp>
+  ES::SubscriptionHandle subscribeProfiled(const std::string& name, Obj* obj, Fp fp)
+  {
+    typedef ComponentSubscriber<Obj, Fp, Args...> Subscriber;
+    const std::string className = EventProfiler::demangle(typeid(*obj).name());
+    size_t id = this->entity->getProfiler()->addSubscriber(name, className);
+    Subscriber* subscriber = new Subscriber(this->entity, name, id, obj, fp);
+    subscribers.emplace_back(std::shared_ptr<ComponentSubscriberBase>(subscriber));
+    auto sh = this->entity->subscribe(name, &Subscriber::call, subscriber);
+    subscriptions.emplace_back(sh);
+    this->entity->addComponentSubscription(name, this);
+    return sh;
+  }
+
   EntityBase* entity;
 
+  // Outlive the subscriptions, since they are destroyed after them
+  std::vector<std::shared_ptr<ComponentSubscriberBase>> subscribers;
+
   // all subscriptions of this component
   std::vector<ES::ScopedSubscription> subscriptions;
 };
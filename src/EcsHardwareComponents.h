@@ -235,6 +235,11 @@ public:
     subscribe("SetJointCommand", &PtuComponent::setJointPosition);
   }
 
+  std::vector<std::string> getWrittenJoints() const
+  {
+    return std::vector<std::string> {panJointName, tiltJointName};
+  }
+
 private:
 
   void rosCallback(const sensor_msgs::JointState::ConstPtr& msg)
@@ -643,6 +648,7 @@ public:
       }
 
       this->jointMap[i] = jnt->jointIndex;
+      this->jointNames.push_back(jName);
     }
 
     subscribe("Start", &RoboSDHComponent::start);
@@ -655,6 +661,11 @@ public:
     subscribe("EnableCommands", &RoboSDHComponent::enableCommands);
   }
 
+  std::vector<std::string> getWrittenJoints() const
+  {
+    return jointNames;
+  }
+
 private:
 
   void start()
@@ -705,6 +716,7 @@ private:
     setFingersEnabled(false);
   }
 
+  std::vector<std::string> jointNames;
   bool eStop;
 };
 #else
@@ -743,6 +755,11 @@ public:
     RLOG(0, "Creating RoboLWAComponent");
     setUpdateFrequency(100.0);
 
+    for (size_t i=0; i<LWA_DOF; ++i)
+    {
+      jointNames.push_back(getJointName(i));
+    }
+
     subscribe("Start", &RoboLWAComponent::start);
     subscribe("Stop", &RoboLWAComponent::stop);
     subscribe("UpdateGraph", &RoboLWAComponent::updateGraph);
@@ -753,6 +770,11 @@ public:
     subscribe("EnableCommands", &RoboLWAComponent::enableCommands);
   }
 
+  std::vector<std::string> getWrittenJoints() const
+  {
+    return jointNames;
+  }
+
 private:
 
   void start()
@@ -809,6 +831,7 @@ private:
     setCommand(q_des, NULL, NULL);
   }
 
+  std::vector<std::string> jointNames;
   bool eStop;
 };
 #else
@@ -1393,10 +1416,13 @@ private:
   {
     Rcs::JacoComponent::updateSensors(graph);
 
-    char text[256];
-    snprintf(text, 256, "dt_filt: %.2f msec   dt_max: %.2f msec   force: %.3f",
-             1000.0*getDtJacoFilt(), 1000.0*getDtJacoMax(), getHandForce());
-    getEntity()->publish("SetTextLine", std::string(text), 2);
+    if (getEntity()->hasViewer())
+    {
+      char text[256];
+      snprintf(text, 256, "dt_filt: %.2f msec   dt_max: %.2f msec   force: %.3f",
+               1000.0*getDtJacoFilt(), 1000.0*getDtJacoMax(), getHandForce());
+      getEntity()->publish("SetTextLine", std::string(text), 2);
+    }
 
     const double handForce = getHandForce();
 
@@ -21,13 +21,17 @@ namespace aff
 {
 
 EntityBase::EntityBase() : dt(0.05), pause(false), timeFrozen(false),
-  eStop(false), maxQueueSize(0)
+  eStop(false), maxQueueSize(0), numViewers(0), eventQueue(1024),
+  loopThread(std::thread::id()), numEventWaiters(0), wakeRequested(false),
+  numQueueOverflows(0), numSpaceWaiters(0)
 {
   pthread_mutex_init(&mutex, NULL);
   this->time = 0.0;
   subscribe<>("TogglePause", &EntityBase::onTogglePause, this);
   subscribe<>("ToggleTimeFreeze", &EntityBase::onToggleTimeFrozen, this);
   subscribe<>("Print", &EntityBase::onPrint, this);
+  subscribe<>("PrintProfile", &EntityBase::onPrintProfile, this);
+  subscribe<std::string>("WriteProfileTrace", &EntityBase::onWriteProfileTrace, this);
   subscribe<>("EmergencyStop", &EntityBase::onEmergencyStop, this);
   subscribe<>("EmergencyRecover", &EntityBase::onEmergencyRecover, this);
 }
@@ -80,9 +84,105 @@ void EntityBase::stepTime()
   }
 }
 
+void EntityBase::enqueue(EventQueue::Event& ev)
+{
+  if (!eventQueue.tryPush(ev))
+  {
+    numQueueOverflows++;
+
+    while (!eventQueue.tryPush(ev))
+    {
+      // Make space if we are the consumer, otherwise wait for it. The fence
+      // pairs with the one in transferEvents(), so that either we see the
+      // space, or the consumer sees us waiting.
+      if (std::this_thread::get_id() == loopThread.load())
+      {
+        transferEvents();
+      }
+      else
+      {
+        std::unique_lock<std::mutex> lock(queueSpaceMtx);
+        numSpaceWaiters++;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        queueSpaceCv.wait(lock, [this]
+        {
+          return eventQueue.size() < eventQueue.capacity();
+        });
+        numSpaceWaiters--;
+      }
+    }
+  }
+
+  // Only take the lock if the loop is waiting for events. The fence pairs
+  // with the one in waitForEvent(), so that either we see the waiter, or
+  // the waiter sees the event.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (numEventWaiters.load() > 0)
+  {
+    std::lock_guard<std::mutex> lock(eventWaitMtx);
+    eventWaitCv.notify_all();
+  }
+}
+
+bool EntityBase::waitForEvent(double timeout)
+{
+  std::unique_lock<std::mutex> lock(eventWaitMtx);
+  numEventWaiters++;
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  bool hasEvents = eventWaitCv.wait_for(lock, std::chrono::duration<double>(timeout),
+                                        [this]
+  {
+    return (queueSize() > 0) || wakeRequested.exchange(false);
+  });
+  numEventWaiters--;
+
+  return hasEvents && (queueSize() > 0);
+}
+
+void EntityBase::wakeUp()
+{
+  wakeRequested = true;
+
+  // Same handshake as in publish()
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (numEventWaiters.load() > 0)
+  {
+    std::lock_guard<std::mutex> lock(eventWaitMtx);
+    eventWaitCv.notify_all();
+  }
+}
+
+void EntityBase::transferEvents()
+{
+  EventQueue::Event ev;
+  size_t numPopped = 0;
+  while (eventQueue.tryPop(ev))
+  {
+    ev();
+    numPopped++;
+  }
+
+  // Wake up publishers that are waiting for space
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if ((numPopped > 0) && (numSpaceWaiters.load() > 0))
+  {
+    std::lock_guard<std::mutex> lock(queueSpaceMtx);
+    queueSpaceCv.notify_all();
+  }
+}
+
 void EntityBase::process()
 {
+  loopThread = std::this_thread::get_id();
   maxQueueSize = (std::max)(maxQueueSize, queueSize());
+  transferEvents();
+
+  // Deliver the values that have been published through the event handles
+  for (auto& h : eventHandles)
+  {
+    h->flush();
+  }
+
   ES::EventSystem::process();
 
   if (this->pause==true)
@@ -91,14 +191,114 @@ void EntityBase::process()
   }
 }
 
+void EntityBase::setProfiling(bool enable)
+{
+  profiler.setEnabled(enable);
+}
+
+bool EntityBase::getProfiling() const
+{
+  return profiler.isEnabled();
+}
+
+EventProfiler* EntityBase::getProfiler()
+{
+  return &profiler;
+}
+
+const EventProfiler* EntityBase::getProfiler() const
+{
+  return &profiler;
+}
+
+void EntityBase::attachViewer()
+{
+  numViewers++;
+}
+
+void EntityBase::detachViewer()
+{
+  numViewers--;
+}
+
+bool EntityBase::hasViewer() const
+{
+  return numViewers > 0;
+}
+
+void EntityBase::addComponentSubscription(const std::string& eventName,
+                                          const ComponentBase* component)
+{
+  std::lock_guard<std::mutex> lock(componentMtx);
+  componentSubscriptions.insert(std::make_pair(eventName, component));
+}
+
+void EntityBase::removeComponentSubscriptions(const ComponentBase* component)
+{
+  std::lock_guard<std::mutex> lock(componentMtx);
+  auto it = componentSubscriptions.begin();
+
+  while (it != componentSubscriptions.end())
+  {
+    if (it->second == component)
+    {
+      it = componentSubscriptions.erase(it);
+    }
+    else
+    {
+      ++it;
+    }
+  }
+}
+
+std::vector<const ComponentBase*> EntityBase::getSubscribedComponents(const std::string& eventName) const
+{
+  std::lock_guard<std::mutex> lock(componentMtx);
+  std::vector<const ComponentBase*> components;
+  auto range = componentSubscriptions.equal_range(eventName);
+
+  for (auto it = range.first; it != range.second; ++it)
+  {
+    if (std::find(components.begin(), components.end(), it->second) == components.end())
+    {
+      components.push_back(it->second);
+    }
+  }
+
+  return components;
+}
+
+int EntityBase::processUntilEmpty(int maxIter)
+{
+  int iter = 0;
+
+  while ((queueSize() > 0) && (iter < maxIter))
+  {
+    process();
+    iter++;
+  }
+
+  return iter;
+}
+
 size_t EntityBase::queueSize() const
 {
-  return dynamicQueue.size();
+  return eventQueue.size() + dynamicQueue.size();
 }
 
 size_t EntityBase::getMaxQueueSize() const
 {
-  return maxQueueSize;
+  return (std::max)(maxQueueSize, eventQueue.getMaxSize());
+}
+
+size_t EntityBase::getQueueCapacity() const
+{
+  return eventQueue.capacity();
+}
+
+size_t EntityBase::getQueueOverflows() const
+{
+  return numQueueOverflows.load();
 }
 
 bool EntityBase::getTimeFrozen() const
@@ -119,8 +319,11 @@ void EntityBase::onToggleTimeFrozen()
 
 void EntityBase::onPrint()
 {
-  RLOG_CPP(0, "Dynamic queue has size " << dynamicQueue.size()
-           << " max. was " << maxQueueSize);
+  RLOG_CPP(0, "Dynamic queue has size " << queueSize()
+           << " max. was " << getMaxQueueSize() << ", "
+           << eventQueue.getNumPushed() << " events published, queue of "
+           << getQueueCapacity() << " was " << getQueueOverflows()
+           << " times full");
   auto copyOfMap = getRegisteredEvents();
   size_t count = 1;
   for (auto& entry : copyOfMap)
@@ -132,6 +335,21 @@ void EntityBase::onPrint()
   print(std::cout);
 }
 
+void EntityBase::onPrintProfile()
+{
+  if (!profiler.isEnabled())
+  {
+    RLOG(0, "Profiling is disabled");
+  }
+
+  profiler.print();
+}
+
+void EntityBase::onWriteProfileTrace(std::string fileName)
+{
+  profiler.writeChromeTrace(fileName);
+}
+
 void EntityBase::onEmergencyStop()
 {
   this->eStop = true;
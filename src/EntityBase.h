@@ -13,14 +13,99 @@
 #ifndef RCS_ENTITYBASE_H
 #define RCS_ENTITYBASE_H
 
+#include "EventQueue.h"
+#include "EventProfiler.h"
+
 #include <EventSystem.h>
 #include <Rcs_graph.h>
 
 #include <pthread.h>
 
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <vector>
+
 
 namespace aff
 {
+
+class ComponentBase;
+
+/*! \brief Base class for the event handles, so that the EntityBase can
+ *         deliver them regardless of their argument types.
+ */
+class EventHandleBase
+{
+public:
+  virtual ~EventHandleBase()
+  {
+  }
+
+  virtual void flush() = 0;
+};
+
+/*! \brief Typed event channel that is resolved once by name, see
+ *         EntityBase::getEventHandle(). Publishing through it does neither
+ *         look up the event by name nor queue a closure. The arguments are
+ *         stored in the handle and delivered to the subscribers in the next
+ *         EntityBase::process() call, before the event queue is processed.
+ *         If published several times in between, only the last arguments
+ *         are delivered. This fits values that are published in each step,
+ *         such as the blending or the phase of a trajectory.
+ *
+ *         Publishing is not thread-safe. It must be done from the thread that
+ *         calls process().
+ */
+template <typename... TArgs>
+class EventHandle : public EventHandleBase
+{
+public:
+
+  EventHandle(ES::SubscriberCollectionDecay<TArgs...>* event_) :
+    event(event_), pending(false)
+  {
+  }
+
+  void publish(const TArgs&... args_)
+  {
+    this->args = std::make_tuple(args_...);
+    this->pending = true;
+  }
+
+  /*! \brief Calls all subscribers immediately, like the event's call().
+   */
+  void call(const TArgs&... args_)
+  {
+    event->call(args_...);
+  }
+
+  void flush()
+  {
+    if (pending)
+    {
+      pending = false;
+      callWithArgs(std::index_sequence_for<TArgs...>());
+    }
+  }
+
+private:
+
+  template <size_t... I>
+  void callWithArgs(std::index_sequence<I...>)
+  {
+    event->call(std::get<I>(args)...);
+  }
+
+  ES::SubscriberCollectionDecay<TArgs...>* event;
+  std::tuple<typename std::decay<TArgs>::type...> args;
+  bool pending;
+};
+
 /*! \brief Class wrapping event-loop specific functionality, Maintains some
  *         members related to timings, such as the time step dt, a flag
  *         indicating if the loop is paused, some statistice and a mutex
@@ -39,6 +124,15 @@ namespace aff
  *                             no effect inside this class (\todo: should be
  *                             fixed)
  *         - Print: Prints some class information to the console.
+ *         - PrintProfile: Prints the subscriber timings if profiling is
+ *                         enabled, see setProfiling().
+ *         - WriteProfileTrace: Writes the recorded subscriber calls to the
+ *                              given file in Chrome's trace-event format.
+ *
+ *         Events are published into a lock-free queue (see EventQueue), so
+ *         that threads publishing concurrently don't block each other or the
+ *         loop. The process() call moves them into the event system's queue
+ *         and processes it.
  */
 class EntityBase : public ES::EventSystem
 {
@@ -79,11 +173,49 @@ public:
    */
   void process();
 
+  /*! \brief Calls process() until no events are queued any more, but at most
+   *         maxIter times. Returns the number of process() calls.
+   */
+  int processUntilEmpty(int maxIter);
+
+  /*! \brief Queues the event for the next process() call. It can be called
+   *         from any thread and does not block, unless the queue is full. In
+   *         that case, the calling thread sleeps until process() has made
+   *         space again. If it is the loop thread itself, it moves the queued
+   *         events into the event system's queue instead. Events published
+   *         from the same thread are processed in the order of publishing.
+   */
+  template <typename... TArgs>
+  void publish(const std::string& name, TArgs... args)
+  {
+    EventQueue::Event ev = [this, name, args...]() mutable
+    {
+      ES::EventSystem::publish<TArgs...>(name, std::move(args)...);
+    };
+    enqueue(ev);
+  }
+
+  /*! \brief Blocks until an event has been published, or until timeout
+   *         seconds have passed. Returns true if there are queued events.
+   */
+  bool waitForEvent(double timeout);
+
+  /*! \brief Makes a pending or the next waitForEvent() call return, even if
+   *         no event has been published. Can be called from any thread.
+   */
+  void wakeUp();
+
   /*! \brief Returns the size of the event queue at the time of the call. If
    *         it is queries right after the process() call, it will be empty.
    */
   size_t queueSize() const;
 
+  /*! \brief Returns the capacity of the lock-free event queue, and how many
+   *         publish() calls found it full and had to wait.
+   */
+  size_t getQueueCapacity() const;
+  size_t getQueueOverflows() const;
+
   /*! \brief Returns the all-time maximum queue size since construction of this
    *         class.
    */
@@ -101,11 +233,54 @@ public:
 
   bool initialize(RcsGraph* graph);
 
+  /*! \brief Returns a handle to publish the event with the given name without
+   *         looking it up by name, see EventHandle. It must be called with
+   *         the same argument types as the subscribers of the event, and
+   *         before the loop is started. The handle is owned by this class.
+   */
+  template <typename... TArgs>
+  EventHandle<TArgs...>* getEventHandle(const std::string& name)
+  {
+    EventHandle<TArgs...>* handle = new EventHandle<TArgs...>(registerEvent<TArgs...>(name));
+    eventHandles.push_back(std::unique_ptr<EventHandleBase>(handle));
+    return handle;
+  }
+
+  /*! \brief Enables or disables recording the durations of the subscriber
+   *         calls. Only subscriptions through ComponentBase are recorded.
+   */
+  void setProfiling(bool enable);
+  bool getProfiling() const;
+  EventProfiler* getProfiler();
+  const EventProfiler* getProfiler() const;
+
+  /*! \brief Viewers register themselves here, so that text that is only
+   *         displayed in a viewer's HUD needs not be formatted if there is
+   *         none.
+   */
+  void attachViewer();
+  void detachViewer();
+  bool hasViewer() const;
+
+  /*! \brief Book-keeping of the events that components are subscribed to,
+   *         see ComponentBase. This allows to find all components that are
+   *         called on an event, for instance to detect concurrent writers of
+   *         the graph (see HardwareDispatcher).
+   */
+  void addComponentSubscription(const std::string& eventName,
+                                const ComponentBase* component);
+  void removeComponentSubscriptions(const ComponentBase* component);
+  std::vector<const ComponentBase*> getSubscribedComponents(const std::string& eventName) const;
+
 private:
 
+  void enqueue(EventQueue::Event& ev);
+  void transferEvents();
   void onTogglePause();
   void onToggleTimeFrozen();
   void onPrint();
+  void onPrintProfile();
+  void onWriteProfileTrace(std::string fileName);
   void onEmergencyStop();
   void onEmergencyRecover();
 
@@ -115,6 +290,21 @@ private:
   bool timeFrozen;
   bool eStop;
   size_t maxQueueSize;
+  std::atomic<int> numViewers;
+  std::vector<std::unique_ptr<EventHandleBase>> eventHandles;
+  EventQueue eventQueue;
+  EventProfiler profiler;
+  std::atomic<std::thread::id> loopThread;
+  std::atomic<int> numEventWaiters;
+  std::atomic<bool> wakeRequested;
+  std::mutex eventWaitMtx;
+  std::condition_variable eventWaitCv;
+  std::atomic<size_t> numQueueOverflows;
+  std::atomic<int> numSpaceWaiters;
+  std::mutex queueSpaceMtx;
+  std::condition_variable queueSpaceCv;
+  std::multimap<std::string, const ComponentBase*> componentSubscriptions;
+  mutable std::mutex componentMtx;
   mutable pthread_mutex_t mutex;
 };
 
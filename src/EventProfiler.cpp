@@ -0,0 +1,339 @@
+/*******************************************************************************
+
+  Copyright (c) Honda Research Institute Europe GmbH.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+  IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT,
+  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+  OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+#include "EventProfiler.h"
+#include "json.hpp"
+
+#include <Rcs_macros.h>
+
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <map>
+#include <thread>
+
+#if defined(__GNUC__)
+#include <cxxabi.h>
+#include <cstdlib>
+#endif
+
+
+namespace aff
+{
+
+EventProfiler::EventProfiler(size_t traceCapacity_) :
+  enabled(false), traceCapacity(traceCapacity_), traceHead(0)
+{
+}
+
+void EventProfiler::setEnabled(bool enable)
+{
+  enabled = enable;
+}
+
+bool EventProfiler::isEnabled() const
+{
+  return enabled;
+}
+
+size_t EventProfiler::addSubscriber(const std::string& eventName,
+                                    const std::string& subscriberName)
+{
+  std::lock_guard<std::mutex> lock(mtx);
+
+  for (size_t i=0; i<subscribers.size(); ++i)
+  {
+    if ((subscribers[i].eventName==eventName) &&
+        (subscribers[i].name==subscriberName))
+    {
+      return i;
+    }
+  }
+
+  Subscriber s;
+  s.eventName = eventName;
+  s.name = subscriberName;
+  clear(s);
+  subscribers.push_back(s);
+
+  return subscribers.size() - 1;
+}
+
+void EventProfiler::clear(Subscriber& s) const
+{
+  s.numCalls = 0;
+  s.accumulatedTime = 0.0;
+  s.maxTime = 0.0;
+  std::fill(s.histogram, s.histogram+numBuckets, 0);
+  s.slowest.clear();
+}
+
+// Must be called with the mutex locked
+size_t EventProfiler::getThreadIndex()
+{
+  const size_t tid = std::hash<std::thread::id>()(std::this_thread::get_id());
+  auto it = std::find(threadIds.begin(), threadIds.end(), tid);
+
+  if (it != threadIds.end())
+  {
+    return it - threadIds.begin();
+  }
+
+  threadIds.push_back(tid);
+  return threadIds.size() - 1;
+}
+
+void EventProfiler::record(size_t id, double startTime, double duration)
+{
+  std::lock_guard<std::mutex> lock(mtx);
+
+  if (id >= subscribers.size())
+  {
+    return;
+  }
+
+  Subscriber& s = subscribers[id];
+  s.numCalls++;
+  s.accumulatedTime += duration;
+  s.maxTime = std::max(s.maxTime, duration);
+
+  size_t bucket = 0;
+  double usec = 1.0e6*duration;
+  while ((usec >= 1.0) && (bucket < numBuckets-1))
+  {
+    usec *= 0.5;
+    bucket++;
+  }
+  s.histogram[bucket]++;
+
+  // Keep the slowest calls sorted by descending duration
+  if ((s.slowest.size() < numSlowestCalls) ||
+      (duration > s.slowest.back().duration))
+  {
+    Sample sample;
+    sample.startTime = startTime;
+    sample.duration = duration;
+    auto pos = std::find_if(s.slowest.begin(), s.slowest.end(),
+                            [duration](const Sample& other)
+    {
+      return other.duration < duration;
+    });
+    s.slowest.insert(pos, sample);
+
+    if (s.slowest.size() > numSlowestCalls)
+    {
+      s.slowest.pop_back();
+    }
+  }
+
+  if (traceCapacity > 0)
+  {
+    TraceEvent ev;
+    ev.id = id;
+    ev.threadIdx = getThreadIndex();
+    ev.startTime = startTime;
+    ev.duration = duration;
+
+    if (trace.size() < traceCapacity)
+    {
+      trace.push_back(ev);
+    }
+    else
+    {
+      trace[traceHead] = ev;
+      traceHead = (traceHead+1) % traceCapacity;
+    }
+  }
+}
+
+void EventProfiler::reset()
+{
+  std::lock_guard<std::mutex> lock(mtx);
+
+  for (auto& s : subscribers)
+  {
+    clear(s);
+  }
+
+  trace.clear();
+  traceHead = 0;
+}
+
+std::string EventProfiler::getSummary() const
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  nlohmann::json json;
+  json["enabled"] = isEnabled();
+  json["subscribers"] = nlohmann::json::array();
+
+  struct EventStats
+  {
+    size_t numCalls, numSubscribers;
+    double accumulatedTime, maxTime;
+  };
+  std::map<std::string, EventStats> events;
+
+  for (const auto& s : subscribers)
+  {
+    if (s.numCalls == 0)
+    {
+      continue;
+    }
+
+    nlohmann::json entry;
+    entry["event"] = s.eventName;
+    entry["subscriber"] = s.name;
+    entry["calls"] = s.numCalls;
+    entry["total_ms"] = 1.0e3*s.accumulatedTime;
+    entry["mean_ms"] = 1.0e3*s.accumulatedTime/s.numCalls;
+    entry["max_ms"] = 1.0e3*s.maxTime;
+    entry["histogram_usec_log2"] = std::vector<size_t>(s.histogram, s.histogram+numBuckets);
+
+    nlohmann::json slowest = nlohmann::json::array();
+    for (const auto& sample : s.slowest)
+    {
+      slowest.push_back({{"time", sample.startTime},
+        {"ms", 1.0e3*sample.duration}
+      });
+    }
+    entry["slowest"] = slowest;
+    json["subscribers"].push_back(entry);
+
+    auto it = events.find(s.eventName);
+    if (it == events.end())
+    {
+      events[s.eventName] = EventStats{s.numCalls, 1, s.accumulatedTime, s.maxTime};
+    }
+    else
+    {
+      it->second.numCalls += s.numCalls;
+      it->second.numSubscribers++;
+      it->second.accumulatedTime += s.accumulatedTime;
+      it->second.maxTime = std::max(it->second.maxTime, s.maxTime);
+    }
+  }
+
+  json["events"] = nlohmann::json::object();
+  for (const auto& ev : events)
+  {
+    json["events"][ev.first] = {{"calls", ev.second.numCalls},
+      {"subscribers", ev.second.numSubscribers},
+      {"total_ms", 1.0e3*ev.second.accumulatedTime},
+      {"max_ms", 1.0e3*ev.second.maxTime}
+    };
+  }
+
+  return json.dump();
+}
+
+void EventProfiler::print() const
+{
+  nlohmann::json summary = nlohmann::json::parse(getSummary());
+
+  std::vector<nlohmann::json> entries;
+  for (const auto& entry : summary["subscribers"])
+  {
+    entries.push_back(entry);
+  }
+
+  std::sort(entries.begin(), entries.end(),
+            [](const nlohmann::json& a, const nlohmann::json& b)
+  {
+    return a["total_ms"].get<double>() > b["total_ms"].get<double>();
+  });
+
+  RLOG_CPP(0, "Event profile (" << entries.size() << " subscribers):");
+  for (const auto& entry : entries)
+  {
+    RLOG_CPP(0, std::setw(24) << entry["event"].get<std::string>() << " "
+             << std::setw(32) << entry["subscriber"].get<std::string>()
+             << " calls: " << entry["calls"].get<size_t>()
+             << " mean: " << entry["mean_ms"].get<double>() << " msec"
+             << " max: " << entry["max_ms"].get<double>() << " msec");
+  }
+}
+
+bool EventProfiler::writeChromeTrace(const std::string& fileName) const
+{
+  std::ofstream fd(fileName);
+
+  if (!fd.is_open())
+  {
+    RLOG_CPP(1, "Failed to open trace file \"" << fileName << "\"");
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(mtx);
+
+  // Time stamps are in microseconds
+  fd << std::fixed << std::setprecision(3);
+  fd << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+
+  for (size_t i=0; i<trace.size(); ++i)
+  {
+    const TraceEvent& ev = trace[(traceHead+i) % trace.size()];
+    const Subscriber& s = subscribers[ev.id];
+    fd << (i==0 ? "\n" : ",\n");
+    fd << "{\"name\": " << nlohmann::json(s.eventName + " (" + s.name + ")").dump()
+       << ", \"cat\": " << nlohmann::json(s.eventName).dump()
+       << ", \"ph\": \"X\", \"pid\": 1, \"tid\": " << ev.threadIdx
+       << ", \"ts\": " << 1.0e6*ev.startTime
+       << ", \"dur\": " << 1.0e6*ev.duration << "}";
+  }
+
+  fd << "\n]}\n";
+
+  RLOG_CPP(0, "Wrote " << trace.size() << " trace events to " << fileName);
+
+  return fd.good();
+}
+
+std::string EventProfiler::demangle(const char* typeName)
+{
+#if defined(__GNUC__)
+  int status = 0;
+  char* name = abi::__cxa_demangle(typeName, NULL, NULL, &status);
+
+  if ((status==0) && name)
+  {
+    std::string res(name);
+    free(name);
+    return res;
+  }
+#endif
+
+  return std::string(typeName);
+}
+
+}   // namespace aff
@@ -0,0 +1,143 @@
+/*******************************************************************************
+
+  Copyright (c) Honda Research Institute Europe GmbH.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+  IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT,
+  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+  OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+#ifndef AFF_EVENTPROFILER_H
+#define AFF_EVENTPROFILER_H
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+namespace aff
+{
+
+/*! \brief Collects the timings of the event subscribers. Each subscriber is
+ *         registered once with addSubscriber(), and each of its calls is
+ *         recorded with the returned id. For each subscriber, the number of
+ *         calls, the accumulated and maximum duration, a histogram of the
+ *         durations and the slowest calls are kept. In addition, all calls
+ *         are stored in a bounded trace buffer (the oldest ones are
+ *         overwritten), that can be written in Chrome's trace-event format
+ *         (load it in chrome://tracing or ui.perfetto.dev).
+ *
+ *         Nothing is recorded unless enabled. All methods are thread-safe.
+ */
+class EventProfiler
+{
+public:
+
+  // Histogram buckets: [0, 1) usec, [1, 2) usec, [2, 4) usec ... >= 2^22 usec
+  static const size_t numBuckets = 24;
+  static const size_t numSlowestCalls = 5;
+
+  EventProfiler(size_t traceCapacity=100000);
+
+  void setEnabled(bool enable);
+  bool isEnabled() const;
+
+  /*! \brief Returns the id of the subscriber with the given names. If it has
+   *         already been added, its id is returned.
+   */
+  size_t addSubscriber(const std::string& eventName,
+                       const std::string& subscriberName);
+
+  /*! \brief Records a call of the subscriber with the given id. Start time
+   *         and duration are in seconds, as returned by Timer_getSystemTime().
+   */
+  void record(size_t id, double startTime, double duration);
+
+  /*! \brief Resets all statistics and clears the trace buffer.
+   */
+  void reset();
+
+  /*! \brief Returns a json string with the number of calls, the mean and
+   *         max. duration, the histogram and the slowest calls of each
+   *         subscriber, and the accumulated numbers per event. Durations
+   *         are in milliseconds.
+   */
+  std::string getSummary() const;
+  void print() const;
+
+  /*! \brief Writes the trace buffer in Chrome's trace-event json format.
+   *         Returns false if the file can't be written.
+   */
+  bool writeChromeTrace(const std::string& fileName) const;
+
+  /*! \brief Returns a readable class name for a type_info name.
+   */
+  static std::string demangle(const char* typeName);
+
+private:
+
+  struct Sample
+  {
+    double startTime;
+    double duration;
+  };
+
+  struct Subscriber
+  {
+    std::string eventName;
+    std::string name;
+    size_t numCalls;
+    double accumulatedTime;
+    double maxTime;
+    size_t histogram[numBuckets];
+    std::vector<Sample> slowest;
+  };
+
+  struct TraceEvent
+  {
+    size_t id;
+    size_t threadIdx;
+    double startTime;
+    double duration;
+  };
+
+  void clear(Subscriber& s) const;
+  size_t getThreadIndex();
+
+  std::atomic<bool> enabled;
+  mutable std::mutex mtx;
+  std::vector<Subscriber> subscribers;
+  std::vector<TraceEvent> trace;
+  size_t traceCapacity;
+  size_t traceHead;
+  std::vector<size_t> threadIds;
+};
+
+}   // namespace aff
+
+#endif // AFF_EVENTPROFILER_H
@@ -0,0 +1,160 @@
+/*******************************************************************************
+
+  Copyright (c) Honda Research Institute Europe GmbH.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+  IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT,
+  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+  OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+#include "EventQueue.h"
+
+#include <algorithm>
+#include <cstdint>
+
+
+namespace aff
+{
+
+EventQueue::EventQueue(size_t capacity_) : mask(1), enqueuePos(0),
+  dequeuePos(0), maxSize(0), numPushed(0)
+{
+  size_t n = 2;
+  while (n < capacity_)
+  {
+    n *= 2;
+  }
+
+  this->mask = n - 1;
+  this->cells.reset(new Cell[n]);
+
+  for (size_t i=0; i<n; ++i)
+  {
+    cells[i].sequence.store(i, std::memory_order_relaxed);
+  }
+}
+
+EventQueue::~EventQueue()
+{
+}
+
+bool EventQueue::tryPush(Event& ev)
+{
+  size_t pos = enqueuePos.load(std::memory_order_relaxed);
+  Cell* cell = NULL;
+
+  for (;;)
+  {
+    cell = &cells[pos & mask];
+    size_t seq = cell->sequence.load(std::memory_order_acquire);
+    intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+
+    if (diff == 0)
+    {
+      // The cell is free: Claim it by advancing the enqueue position
+      if (enqueuePos.compare_exchange_weak(pos, pos+1,
+                                           std::memory_order_relaxed))
+      {
+        break;
+      }
+    }
+    else if (diff < 0)
+    {
+      // The cell still holds an element from one round before: full
+      return false;
+    }
+    else
+    {
+      // Another producer has claimed the cell
+      pos = enqueuePos.load(std::memory_order_relaxed);
+    }
+  }
+
+  cell->event = std::move(ev);
+  cell->sequence.store(pos+1, std::memory_order_release);
+
+  numPushed.fetch_add(1, std::memory_order_relaxed);
+  size_t currentSize = (std::min)(pos + 1 - dequeuePos.load(std::memory_order_relaxed),
+                                  capacity());
+  size_t prevMax = maxSize.load(std::memory_order_relaxed);
+  while ((currentSize > prevMax) &&
+         !maxSize.compare_exchange_weak(prevMax, currentSize,
+                                        std::memory_order_relaxed))
+  {
+  }
+
+  return true;
+}
+
+bool EventQueue::tryPop(Event& ev)
+{
+  size_t pos = dequeuePos.load(std::memory_order_relaxed);
+  Cell* cell = &cells[pos & mask];
+  size_t seq = cell->sequence.load(std::memory_order_acquire);
+
+  if (seq != pos+1)
+  {
+    return false;
+  }
+
+  ev = std::move(cell->event);
+  cell->event = nullptr;
+  cell->sequence.store(pos+mask+1, std::memory_order_release);
+  dequeuePos.store(pos+1, std::memory_order_relaxed);
+
+  return true;
+}
+
+size_t EventQueue::size() const
+{
+  size_t tail = dequeuePos.load(std::memory_order_relaxed);
+  size_t head = enqueuePos.load(std::memory_order_relaxed);
+  return head > tail ? (std::min)(head - tail, capacity()) : 0;
+}
+
+size_t EventQueue::capacity() const
+{
+  return mask + 1;
+}
+
+size_t EventQueue::getMaxSize() const
+{
+  return maxSize.load(std::memory_order_relaxed);
+}
+
+size_t EventQueue::getNumPushed() const
+{
+  return numPushed.load(std::memory_order_relaxed);
+}
+
+void EventQueue::resetStatistics()
+{
+  maxSize.store(0, std::memory_order_relaxed);
+  numPushed.store(0, std::memory_order_relaxed);
+}
+
+}   // namespace aff
@@ -0,0 +1,114 @@
+/*******************************************************************************
+
+  Copyright (c) Honda Research Institute Europe GmbH.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+  IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT,
+  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+  OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+#ifndef AFF_EVENTQUEUE_H
+#define AFF_EVENTQUEUE_H
+
+#include <atomic>
+#include <functional>
+#include <memory>
+
+
+namespace aff
+{
+
+/*! \brief Bounded lock-free queue with many producers and a single consumer.
+ *         It follows D. Vyukov's bounded queue: Each cell carries a sequence
+ *         number that tells whether it is free for the producer or filled for
+ *         the consumer, so that producers only compete on one atomic index
+ *         and never block each other or the consumer. Elements of one
+ *         producer are popped in the order they have been pushed.
+ *
+ *         The consumer does not wait for a producer that has claimed a cell
+ *         but not yet filled it. tryPop() then returns false, and the
+ *         remaining elements are popped in a later call.
+ */
+class EventQueue
+{
+public:
+
+  typedef std::function<void()> Event;
+
+  /*! \brief The capacity is rounded up to the next power of 2.
+   */
+  EventQueue(size_t capacity);
+  ~EventQueue();
+
+  /*! \brief Appends the event if there is space left, and returns false
+   *         otherwise. In that case, ev is left untouched. Thread-safe.
+   */
+  bool tryPush(Event& ev);
+
+  /*! \brief Moves the oldest event into ev. Must only be called from one
+   *         thread at a time.
+   */
+  bool tryPop(Event& ev);
+
+  /*! \brief Number of elements at the time of the call (approximate if
+   *         called concurrently to push or pop).
+   */
+  size_t size() const;
+  size_t capacity() const;
+
+  /*! \brief Statistics since construction or the last reset: Maximum number
+   *         of elements and number of pushed elements. Failed pushes are not
+   *         counted, since the caller decides whether it retries.
+   */
+  size_t getMaxSize() const;
+  size_t getNumPushed() const;
+  void resetStatistics();
+
+private:
+
+  EventQueue(const EventQueue&) = delete;
+  EventQueue& operator=(const EventQueue&) = delete;
+
+  struct Cell
+  {
+    std::atomic<size_t> sequence;
+    Event event;
+  };
+
+  std::unique_ptr<Cell[]> cells;
+  size_t mask;
+
+  // On separate cache lines, since they are written by different threads
+  alignas(64) std::atomic<size_t> enqueuePos;
+  alignas(64) std::atomic<size_t> dequeuePos;
+  alignas(64) std::atomic<size_t> maxSize;
+  std::atomic<size_t> numPushed;
+};
+
+}   // namespace aff
+
+#endif // AFF_EVENTQUEUE_H
@@ -0,0 +1,380 @@
+/*******************************************************************************
+
+  Copyright (c) Honda Research Institute Europe GmbH.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+  IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT,
+  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+  OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+#include "GazeSolver.h"
+
+#include <Rcs_typedef.h>
+#include <Rcs_math.h>
+#include <Rcs_macros.h>
+
+#include <cmath>
+
+#define GAZE_MAX_STEP (0.2)        // Max. joint step per Newton iteration [rad]
+#define GAZE_DAMPING (1.0e-8)
+
+
+
+/*******************************************************************************
+ * Rotates src about the axis through org with direction axis (unit length)
+ * by angle (Rodrigues formula). If org is NULL, src is treated as direction.
+ ******************************************************************************/
+static void rotateAbout(double dst[3], const double src[3], const double org[3],
+                        const double axis[3], double angle)
+{
+  double v[3], cross[3];
+
+  if (org)
+  {
+    Vec3d_sub(v, src, org);
+  }
+  else
+  {
+    Vec3d_copy(v, src);
+  }
+
+  const double ca = cos(angle), sa = sin(angle);
+  const double av = Vec3d_innerProduct(axis, v);
+  Vec3d_crossProduct(cross, axis, v);
+
+  for (int i = 0; i < 3; ++i)
+  {
+    dst[i] = ca*v[i] + sa*cross[i] + (1.0-ca)*av*axis[i] + (org ? org[i] : 0.0);
+  }
+}
+
+/*******************************************************************************
+ * Angle about the axis that aligns the projections of view and dir onto the
+ * plane orthogonal to the axis.
+ ******************************************************************************/
+static double alignAngle(const double axis[3], const double view_[3],
+                         const double dir_[3])
+{
+  double view[3], dir[3], cross[3];
+  const double vn = Vec3d_innerProduct(view_, axis);
+  const double dn = Vec3d_innerProduct(dir_, axis);
+
+  for (int i = 0; i < 3; ++i)
+  {
+    view[i] = view_[i] - vn*axis[i];
+    dir[i] = dir_[i] - dn*axis[i];
+  }
+
+  Vec3d_crossProduct(cross, view, dir);
+
+  return atan2(Vec3d_innerProduct(cross, axis), Vec3d_innerProduct(view, dir));
+}
+
+/*******************************************************************************
+ * Returns true if jnt is on the path from ancestor to the root.
+ ******************************************************************************/
+static bool isSuccessor(const RcsGraph* graph, const RcsJoint* jnt,
+                        const RcsJoint* ancestor)
+{
+  for (int id = jnt->prevId; id != -1; id = RCSJOINT_BY_ID(graph, id)->prevId)
+  {
+    if (id == ancestor->id)
+    {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+namespace aff
+{
+
+GazeSolver::GazeSolver(const std::string& panJoint,
+                       const std::string& tiltJoint,
+                       const std::string& camera) :
+  panJointName(panJoint), tiltJointName(tiltJoint), cameraFrame(camera),
+  panJointId(-1), tiltJointId(-1), cameraId(-1)
+{
+  lastPanTilt[0] = 0.0;
+  lastPanTilt[1] = 0.0;
+}
+
+GazeSolver::~GazeSolver()
+{
+}
+
+/*******************************************************************************
+ * The camera is rotated about the inner axis, and then about the outer axis.
+ ******************************************************************************/
+void GazeSolver::Chain::cameraPose(const double dq[2], double org[3],
+                                   double view[3]) const
+{
+  rotateAbout(org, A_camera.org, innerOrg, innerAxis, dq[1]);
+  rotateAbout(org, org, outerOrg, outerAxis, dq[0]);
+  rotateAbout(view, A_camera.rot[2], NULL, innerAxis, dq[1]);
+  rotateAbout(view, view, NULL, outerAxis, dq[0]);
+}
+
+void GazeSolver::Chain::innerAxisAt(double dqOuter, double org[3],
+                                    double axis[3]) const
+{
+  rotateAbout(org, innerOrg, outerOrg, outerAxis, dqOuter);
+  rotateAbout(axis, innerAxis, NULL, outerAxis, dqOuter);
+}
+
+/*******************************************************************************
+ * Instead of moving the camera, the target is rotated backwards into the
+ * camera frame at q0. x is the x-y position of the target in the camera
+ * frame, J its derivative w.r.t. dq.
+ ******************************************************************************/
+void GazeSolver::Chain::computeX(const double dq[2], const double target[3],
+                                 double x[2], double J[2][2]) const
+{
+  double t1[3], t2[3], dOuter[3], dInner[3], tmp[3];
+
+  rotateAbout(t1, target, outerOrg, outerAxis, -dq[0]);
+  rotateAbout(t2, t1, innerOrg, innerAxis, -dq[1]);
+
+  Vec3d_sub(tmp, t1, outerOrg);
+  Vec3d_crossProduct(dOuter, tmp, outerAxis);
+  rotateAbout(dOuter, dOuter, NULL, innerAxis, -dq[1]);
+
+  Vec3d_sub(tmp, t2, innerOrg);
+  Vec3d_crossProduct(dInner, tmp, innerAxis);
+
+  Vec3d_sub(tmp, t2, A_camera.org);
+
+  for (int i = 0; i < 2; ++i)
+  {
+    x[i] = Vec3d_innerProduct(A_camera.rot[i], tmp);
+    J[i][0] = Vec3d_innerProduct(A_camera.rot[i], dOuter);
+    J[i][1] = Vec3d_innerProduct(A_camera.rot[i], dInner);
+  }
+}
+
+/*******************************************************************************
+ * The joint and body indices are looked up by name only if the cached ones
+ * don't match (e.g. after a graph with a different topology is passed).
+ ******************************************************************************/
+bool GazeSolver::extractChain(const RcsGraph* graph, Chain& chain)
+{
+  if ((panJointId < 0) || (panJointId >= (int)graph->dof) ||
+      (panJointName != graph->joints[panJointId].name))
+  {
+    const RcsJoint* jnt = RcsGraph_getJointByName(graph, panJointName.c_str());
+    panJointId = jnt ? jnt->id : -1;
+  }
+
+  if ((tiltJointId < 0) || (tiltJointId >= (int)graph->dof) ||
+      (tiltJointName != graph->joints[tiltJointId].name))
+  {
+    const RcsJoint* jnt = RcsGraph_getJointByName(graph, tiltJointName.c_str());
+    tiltJointId = jnt ? jnt->id : -1;
+  }
+
+  if ((cameraId < 0) || (cameraId >= (int)graph->nBodies) ||
+      (cameraFrame != graph->bodies[cameraId].name))
+  {
+    const RcsBody* bdy = RcsGraph_getBodyByName(graph, cameraFrame.c_str());
+    cameraId = bdy ? bdy->id : -1;
+  }
+
+  if (panJointId < 0)
+  {
+    RLOG(1, "Pan joint '%s' not found", panJointName.c_str());
+    return false;
+  }
+
+  if (tiltJointId < 0)
+  {
+    RLOG(1, "Tilt joint '%s' not found", tiltJointName.c_str());
+    return false;
+  }
+
+  if (cameraId < 0)
+  {
+    RLOG(1, "Camera frame '%s' not found", cameraFrame.c_str());
+    return false;
+  }
+
+  const RcsJoint* panJoint = &graph->joints[panJointId];
+  const RcsJoint* tiltJoint = &graph->joints[tiltJointId];
+
+  if (panJoint->constrained || tiltJoint->constrained)
+  {
+    RLOG(1, "Pan or tilt joint is constrained");
+    return false;
+  }
+
+  if ((panJoint->type != RCSJOINT_ROT_X) && (panJoint->type != RCSJOINT_ROT_Y) &&
+      (panJoint->type != RCSJOINT_ROT_Z))
+  {
+    RLOG(1, "Pan joint '%s' is not rotational", panJointName.c_str());
+    return false;
+  }
+
+  if ((tiltJoint->type != RCSJOINT_ROT_X) && (tiltJoint->type != RCSJOINT_ROT_Y) &&
+      (tiltJoint->type != RCSJOINT_ROT_Z))
+  {
+    RLOG(1, "Tilt joint '%s' is not rotational", tiltJointName.c_str());
+    return false;
+  }
+
+  if (isSuccessor(graph, tiltJoint, panJoint))
+  {
+    chain.panIsOuter = true;
+  }
+  else if (isSuccessor(graph, panJoint, tiltJoint))
+  {
+    chain.panIsOuter = false;
+  }
+  else
+  {
+    RLOG(1, "Pan and tilt joint are not in the same kinematic chain");
+    return false;
+  }
+
+  const RcsJoint* outer = chain.panIsOuter ? panJoint : tiltJoint;
+  const RcsJoint* inner = chain.panIsOuter ? tiltJoint : panJoint;
+
+  // A revolute joint's axis doesn't move with its own angle
+  Vec3d_copy(chain.outerOrg, outer->A_JI.org);
+  Vec3d_copy(chain.outerAxis, outer->A_JI.rot[outer->dirIdx]);
+  Vec3d_copy(chain.innerOrg, inner->A_JI.org);
+  Vec3d_copy(chain.innerAxis, inner->A_JI.rot[inner->dirIdx]);
+  HTr_copy(&chain.A_camera, &graph->bodies[cameraId].A_BI);
+  chain.q0[0] = graph->q->ele[panJoint->jointIndex];
+  chain.q0[1] = graph->q->ele[tiltJoint->jointIndex];
+
+  return true;
+}
+
+int GazeSolver::solve(const RcsGraph* graph, const std::string& gazeTarget,
+                      double panTilt[2], size_t maxIter, double eps,
+                      double err[2])
+{
+  std::lock_guard<std::mutex> lock(mtx);
+
+  const RcsBody* gazeBdy = RcsGraph_getBodyByName(graph, gazeTarget.c_str());
+  if (!gazeBdy)
+  {
+    RLOG(1, "gaze body '%s' not found", gazeTarget.c_str());
+    return -1;
+  }
+
+  Chain chain;
+  if (!extractChain(graph, chain))
+  {
+    return -1;
+  }
+
+  const double* target = gazeBdy->A_BI.org;
+  const int pan = chain.panIsOuter ? 0 : 1;
+  const int tilt = 1 - pan;
+  double dq[2] = { 0.0, 0.0 };
+
+  // Warm start from the last solution for the same target
+  if (lastTarget == gazeTarget)
+  {
+    dq[pan] = lastPanTilt[0] - chain.q0[0];
+    dq[tilt] = lastPanTilt[1] - chain.q0[1];
+  }
+
+  double x[2], J[2][2];
+  chain.computeX(dq, target, x, J);
+
+  if ((fabs(x[0]) >= eps) || (fabs(x[1]) >= eps))
+  {
+    double org[3], view[3], dir[3], axisOrg[3], axis[3];
+
+    chain.cameraPose(dq, org, view);
+    Vec3d_sub(dir, target, org);
+    dq[0] += alignAngle(chain.outerAxis, view, dir);
+
+    chain.cameraPose(dq, org, view);
+    chain.innerAxisAt(dq[0], axisOrg, axis);
+    Vec3d_sub(dir, target, org);
+    dq[1] += alignAngle(axis, view, dir);
+
+    // Stay within one revolution of the current angles
+    dq[0] = atan2(sin(dq[0]), cos(dq[0]));
+    dq[1] = atan2(sin(dq[1]), cos(dq[1]));
+
+    chain.computeX(dq, target, x, J);
+  }
+
+  // Damped Newton iterations on the 2 x 2 Jacobian of the chain
+  size_t iter = 0;
+
+  for (iter = 0; iter < maxIter; ++iter)
+  {
+    if ((fabs(x[0]) < eps) && (fabs(x[1]) < eps))
+    {
+      break;
+    }
+
+    const double a = J[0][0];
+    const double b = J[0][1];
+    const double c = J[1][0];
+    const double d = J[1][1];
+
+    // dq = J^T (J J^T + lambda I)^-1 (-x)
+    const double m00 = a*a + b*b + GAZE_DAMPING;
+    const double m01 = a*c + b*d;
+    const double m11 = c*c + d*d + GAZE_DAMPING;
+    const double det = m00*m11 - m01*m01;
+
+    if (fabs(det) < 1.0e-16)
+    {
+      break;
+    }
+
+    const double y0 = (-m11*x[0] + m01*x[1])/det;
+    const double y1 = (m01*x[0] - m00*x[1])/det;
+    dq[0] += Math_clip(a*y0 + c*y1, -GAZE_MAX_STEP, GAZE_MAX_STEP);
+    dq[1] += Math_clip(b*y0 + d*y1, -GAZE_MAX_STEP, GAZE_MAX_STEP);
+    chain.computeX(dq, target, x, J);
+  }
+
+  panTilt[0] = chain.q0[0] + dq[pan];
+  panTilt[1] = chain.q0[1] + dq[tilt];
+
+  lastTarget = gazeTarget;
+  lastPanTilt[0] = panTilt[0];
+  lastPanTilt[1] = panTilt[1];
+
+  if (err)
+  {
+    err[0] = fabs(x[0]);
+    err[1] = fabs(x[1]);
+  }
+
+  return iter;
+}
+
+}   // namespace aff
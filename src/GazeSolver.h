@@ -0,0 +1,117 @@
+/*******************************************************************************
+
+  Copyright (c) Honda Research Institute Europe GmbH.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+  IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT,
+  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+  OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+#ifndef AFF_GAZESOLVER_H
+#define AFF_GAZESOLVER_H
+
+#include <Rcs_graph.h>
+
+#include <mutex>
+#include <string>
+
+namespace aff
+{
+
+/*! \brief Computes the pan and tilt angles of a pan-tilt unit so that the
+ *         camera frame looks at a target body. On each call, the two joint
+ *         axes, the camera frame and the target position are read once from
+ *         the graph. The solver then only works on this two-joint chain: The
+ *         camera is moved by rotating it about the axes, so that the graph is
+ *         neither copied nor its state recomputed, and the Jacobian is the
+ *         analytic 2 x 2 Jacobian of the chain.
+ *
+ *         The angles are initialized with the last solution for the same
+ *         target (warm start), followed by an analytic step that rotates the
+ *         camera's optical axis (z-axis) towards the target around each joint
+ *         axis. This is exact if the camera is located at the intersection of
+ *         both axes. The remaining error (target position in the camera's
+ *         x-y plane) is removed with a few damped Newton iterations. All calls
+ *         are serialized by a mutex.
+ */
+class GazeSolver
+{
+public:
+
+  GazeSolver(const std::string& panJoint="ptu_pan_joint",
+             const std::string& tiltJoint="ptu_tilt_joint",
+             const std::string& cameraFrame="head_kinect_rgb_link");
+  ~GazeSolver();
+
+  /*! \brief Returns the number of Newton iterations, or -1 in case of an
+   *         error (e.g. the target or the joints don't exist). The arrays
+   *         panTilt and err (if not NULL) are written on success. The graph
+   *         is not modified.
+   */
+  int solve(const RcsGraph* graph, const std::string& gazeTarget,
+            double panTilt[2], size_t maxIter, double eps, double err[2]);
+
+private:
+
+  GazeSolver(const GazeSolver&) = delete;
+  GazeSolver& operator=(const GazeSolver&) = delete;
+
+  /*! \brief Two revolute joints and the camera frame at the joint angles
+   *         q0. The outer joint is the one closer to the root. The angles
+   *         dq are offsets to q0.
+   */
+  struct Chain
+  {
+    double outerOrg[3], outerAxis[3];
+    double innerOrg[3], innerAxis[3];
+    HTr A_camera;
+    double q0[2];
+    bool panIsOuter;
+
+    void cameraPose(const double dq[2], double org[3], double view[3]) const;
+    void innerAxisAt(double dqOuter, double org[3], double axis[3]) const;
+    void computeX(const double dq[2], const double target[3], double x[2],
+                  double J[2][2]) const;
+  };
+
+  bool extractChain(const RcsGraph* graph, Chain& chain);
+
+  std::string panJointName;
+  std::string tiltJointName;
+  std::string cameraFrame;
+
+  std::mutex mtx;
+  int panJointId;
+  int tiltJointId;
+  int cameraId;
+  std::string lastTarget;
+  double lastPanTilt[2];
+};
+
+}   // namespace aff
+
+#endif // AFF_GAZESOLVER_H
@@ -33,6 +33,7 @@
 
 #include "GraphicsWindow.h"
 #include "EntityBase.h"
+#include "TransformRing.h"
 
 #include <Rcs_macros.h>
 #include <Rcs_typedef.h>
@@ -83,15 +84,32 @@ public:
       return;
     }
 
-    std::lock_guard<std::mutex> lock(stateCopyingMtx);
+    // Resizeable nodes also need the shapes, so that we copy the full graph
+    if (resizeable)
+    {
+      std::lock_guard<std::mutex> lock(stateCopyingMtx);
+      RcsGraph_copy(graph, other);
+      return;
+    }
 
-    // \todo: This might have concurrency issues. We better copy into a class
-    //        internal buffer, than directly into the internal graph.
-    RcsGraph_copy(graph, other);
+    transforms.write(other);
   }
 
+  // Applies the newest transforms in the render thread. The map is shared by
+  // all windows, therefore a second window skips the items that are pasted.
   void pasteState()
   {
+    if (!realized())
+    {
+      return;
+    }
+
+    std::unique_lock<std::mutex> lock(pasteMtx, std::try_to_lock);
+
+    if (lock.owns_lock())
+    {
+      transforms.read(graph);
+    }
   }
 
   static void realizeNodeInThread(GraphicsWindow* window, std::string eventName,
@@ -200,7 +218,10 @@ public:
     {
       for (auto it = eventMap.begin(); it != eventMap.end(); ++it)
       {
-        RLOG(0, "RenderGraph(%d) = %s", count++, it->first.c_str());
+        const TransformRing& tr = it->second->transforms;
+        RLOG(0, "RenderGraph(%d) = %s: %zu frames, %zu stale",
+             count++, it->first.c_str(), tr.getNumWritten(),
+             tr.getNumStale());
       }
     }
   }
@@ -304,7 +325,9 @@ private:
 
   mutable std::mutex realizeMtx;
   mutable std::mutex stateCopyingMtx;
+  std::mutex pasteMtx;
   RcsGraph* graph;
+  TransformRing transforms;
 
   static std::map<std::string,osg::ref_ptr<MapItem>> eventMap;
   static std::vector<std::string> deactivatedBodies;
@@ -353,6 +376,7 @@ GraphicsWindow::GraphicsWindow(EntityBase* parent, bool startWithStartEvent,
   resizeable(false)
 {
   pthread_mutex_init(&frameMtx, NULL);
+  getEntity()->attachViewer();
 
 #if defined(_MSC_VER)
   setWindowSize(12, 36, 640, 480);
@@ -417,6 +441,7 @@ GraphicsWindow::~GraphicsWindow()
 {
   stop();
   MapItem::clear(this);
+  getEntity()->detachViewer();
   pthread_mutex_destroy(&frameMtx);
 }
 
@@ -806,8 +831,8 @@ void GraphicsWindow::onRender(std::string graphId, const RcsGraph* other)
     MapItem::realizeNodeInThread(this, graphId, other, getResizeable(), getEntity());
   }
 
-  // Copies the joint and sensor values for all realized GraphNodes. This is
-  // mutex-protected against the pasteState() method in the frame() function.
+  // Writes the transforms of all realized GraphNodes into their ring. The
+  // render thread picks them up in the pasteState() method in frame().
   mi->copyState(other, getResizeable());
 }
 
@@ -859,28 +884,14 @@ void GraphicsWindow::frame()
   // forward kinematics is computed.
   auto cpyOfMap = MapItem::getEventMap();
 
+  // Takes the newest transforms that the event loop has written without
+  // locking, older ones are dropped.
   for (auto it = cpyOfMap.begin(); it != cpyOfMap.end(); it++)
   {
     auto& mi = it->second;
     mi->pasteState();
   }
 
-  lock();
-
-  // Mutex only around map copying so that we don't need to wait until
-  // forward kinematics is computed.
-  for (auto it = cpyOfMap.begin(); it != cpyOfMap.end(); it++)
-  {
-    auto mi = it->second;
-
-    if (mi->realized())
-    {
-      //RcsGraph_setState(mi->getGraph(), NULL, NULL);
-    }
-
-  }
-  unlock();
-
   Viewer::frame();
   handleKeys();
 }
@@ -0,0 +1,181 @@
+/*******************************************************************************
+
+  Copyright (c) Honda Research Institute Europe GmbH.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+  IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT,
+  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+  OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+#include "HardwareDispatcher.h"
+#include "ComponentBase.h"
+#include "ConcurrentExecutor.h"
+
+#include <Rcs_typedef.h>
+#include <Rcs_macros.h>
+
+#include <algorithm>
+#include <typeinfo>
+
+
+namespace aff
+{
+
+HardwareDispatcher::HardwareDispatcher() : numComponents(0)
+{
+}
+
+HardwareDispatcher::~HardwareDispatcher()
+{
+  join();
+}
+
+bool HardwareDispatcher::add(ComponentBase* component, const RcsGraph* graph)
+{
+  join();
+  std::lock_guard<std::mutex> lock(mtx);
+  const std::string name = EventProfiler::demangle(typeid(*component).name());
+  std::vector<std::string> jointNames = component->getWrittenJoints();
+
+  if (jointNames.empty())
+  {
+    RLOG_CPP(1, name << " does not tell its joints - updating it sequentially");
+    return false;
+  }
+
+  std::vector<unsigned int> jointIndices;
+
+  for (const auto& jointName : jointNames)
+  {
+    const RcsJoint* jnt = RcsGraph_getJointByName(graph, jointName.c_str());
+
+    if (!jnt)
+    {
+      RLOG_CPP(1, name << ": joint \"" << jointName << "\" not found - "
+               << "updating it sequentially");
+      return false;
+    }
+
+    auto owner = jointOwners.find(jnt->jointIndex);
+    if (owner != jointOwners.end())
+    {
+      RLOG_CPP(1, name << ": joint \"" << jointName << "\" is also written by "
+               << owner->second << " - updating it sequentially");
+      return false;
+    }
+
+    jointIndices.push_back(jnt->jointIndex);
+  }
+
+  // Sequential subscribers of the same events run while the dispatched ones
+  // are called, therefore they must not write the same joints.
+  for (const std::string eventName : { "UpdateGraph", "SetJointCommand" })
+  {
+    for (auto other : component->getEntity()->getSubscribedComponents(eventName))
+    {
+      if ((other == component) ||
+          (std::find(components.begin(), components.end(), other) != components.end()))
+      {
+        continue;
+      }
+
+      const std::string otherName = EventProfiler::demangle(typeid(*other).name());
+      std::vector<std::string> otherJoints = other->getWrittenJoints();
+
+      if (otherJoints.empty())
+      {
+        RLOG_CPP(1, name << ": " << otherName << " is called sequentially on "
+                 << eventName << " and does not tell its joints - updating "
+                 << "it sequentially");
+        return false;
+      }
+
+      for (const auto& jointName : otherJoints)
+      {
+        if (std::find(jointNames.begin(), jointNames.end(), jointName) != jointNames.end())
+        {
+          RLOG_CPP(1, name << ": joint \"" << jointName << "\" is also written by "
+                   << otherName << " - updating it sequentially");
+          return false;
+        }
+      }
+    }
+  }
+
+  for (auto idx : jointIndices)
+  {
+    jointOwners[idx] = name;
+  }
+
+  component->setDispatcher("UpdateGraph", this);
+  component->setDispatcher("SetJointCommand", this);
+  components.push_back(component);
+  numComponents++;
+
+  // One thread per component, so that all of them run at the same time
+  this->executor.reset(new ConcurrentExecutor(numComponents));
+
+  RLOG_CPP(0, "Updating " << name << " concurrently ("
+           << jointIndices.size() << " joints)");
+
+  return true;
+}
+
+void HardwareDispatcher::dispatch(std::function<void()> call)
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  pending.push_back(executor->enqueue(call));
+}
+
+void HardwareDispatcher::join()
+{
+  std::vector<std::future<void>> calls;
+  {
+    std::lock_guard<std::mutex> lock(mtx);
+    calls.swap(pending);
+  }
+
+  for (auto& call : calls)
+  {
+    try
+    {
+      call.get();
+    }
+    catch (const std::exception& e)
+    {
+      RLOG(1, "Dispatched hardware call failed: %s", e.what());
+    }
+  }
+}
+
+size_t HardwareDispatcher::getNumComponents() const
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  return numComponents;
+}
+
+}   // namespace aff
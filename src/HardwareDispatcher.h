@@ -0,0 +1,108 @@
+/*******************************************************************************
+
+  Copyright (c) Honda Research Institute Europe GmbH.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+  IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT,
+  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+  OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+#ifndef AFF_HARDWAREDISPATCHER_H
+#define AFF_HARDWAREDISPATCHER_H
+
+#include <Rcs_graph.h>
+
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+namespace aff
+{
+
+class ComponentBase;
+class ConcurrentExecutor;
+
+/*! \brief Calls the UpdateGraph and SetJointCommand subscribers of several
+ *         hardware components concurrently, so that the latencies of their
+ *         devices don't add up. A component can only be added if it tells
+ *         which joints it writes (see ComponentBase::getWrittenJoints()),
+ *         and if none of them is written by a component added before.
+ *         In addition, all other components that are subscribed to the
+ *         same events must tell their joints, and they must not overlap,
+ *         since they are called while the dispatched ones run. Otherwise,
+ *         the component is called sequentially as before. Components that
+ *         subscribe after the registration are not checked.
+ *
+ *         The subscribers of added components return immediately when the
+ *         event is called, and their work is done in a thread pool. The
+ *         caller of the event must call join() before using the results,
+ *         for instance before ComputeKinematics.
+ */
+class HardwareDispatcher
+{
+public:
+
+  HardwareDispatcher();
+  ~HardwareDispatcher();
+
+  /*! \brief Returns false if the component can't be dispatched concurrently.
+   *         The graph is needed to resolve the joint names.
+   */
+  bool add(ComponentBase* component, const RcsGraph* graph);
+
+  /*! \brief Runs the call in the thread pool. Called by the subscribers of
+   *         the added components.
+   */
+  void dispatch(std::function<void()> call);
+
+  /*! \brief Waits until all dispatched calls are done.
+   */
+  void join();
+
+  size_t getNumComponents() const;
+
+private:
+
+  HardwareDispatcher(const HardwareDispatcher&) = delete;
+  HardwareDispatcher& operator=(const HardwareDispatcher&) = delete;
+
+  std::unique_ptr<ConcurrentExecutor> executor;
+  std::vector<std::future<void>> pending;
+  std::map<unsigned int, std::string> jointOwners;
+  std::vector<const ComponentBase*> components;
+  size_t numComponents;
+  mutable std::mutex mtx;
+};
+
+}   // namespace aff
+
+#endif // AFF_HARDWAREDISPATCHER_H
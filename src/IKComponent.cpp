@@ -38,6 +38,8 @@
 #include <Rcs_typedef.h>
 #include <Rcs_macros.h>
 
+#include <unordered_set>
+
 
 namespace aff
 {
@@ -85,6 +87,7 @@ void IKComponent::subscribeAll()
   subscribe("TriggerInitFromDesiredState", &IKComponent::onTriggerInitFromDesiredState);
   subscribe("Print", &IKComponent::print);
   subscribe("ChangeTaskVector", &IKComponent::onTaskVectorChange);
+  subscribe("SetActiveJoints", &IKComponent::onSetActiveJoints);
 }
 
 void IKComponent::onTaskCommand(const MatNd* a, const MatNd* x)
@@ -120,9 +123,11 @@ void IKComponent::onTaskCommand(const MatNd* a, const MatNd* x)
 
 
   std::string resMsg;
+  maskInactiveJoints();
   int ikOk = TrajectoryPredictor::computeIK(ikSolver, a, x, getEntity()->getDt(), alpha*blending,
                                             lambda, qFilt, phase, speedLimitCheck, jointLimitCheck,
                                             collisionCheck, applySpeedAndAccLimits, true, NULL, resMsg);
+  unmaskInactiveJoints();
 
   // We only print this once after the e-stop being triggered, therefore the
   // second comparison
@@ -267,6 +272,97 @@ void IKComponent::onTaskVectorChange(std::vector<std::string> taskVec,
   // the next incoming activation command.
   MatNd_destroy(this->a_prev);
   this->a_prev = NULL;
+
+  // The active joints of the previous task vector might not cover the new
+  // one, so that we fall back to solving for all joints.
+  this->manipulators = channels;
+  this->inactiveJoints.clear();
+}
+
+void IKComponent::onSetActiveJoints(std::vector<std::string> jointNames)
+{
+  this->inactiveJoints.clear();
+
+  if (jointNames.empty())
+  {
+    return;
+  }
+
+  RcsGraph* graph = controller->getGraph();
+  std::unordered_set<std::string> keep(jointNames.begin(), jointNames.end());
+  MatNd* keepMask = MatNd_create(graph->nJ, 1);
+  MatNd* tmpMask = MatNd_create(graph->nJ, 1);
+
+  for (const auto& m : manipulators)
+  {
+    const RcsBody* mBdy = RcsGraph_getBodyByName(graph, m.c_str());
+    if (mBdy)
+    {
+      RcsGraph_computeJointRecursionMask(graph, mBdy, tmpMask);
+      MatNd_addSelf(keepMask, tmpMask);
+    }
+  }
+
+  RCSGRAPH_FOREACH_JOINT(graph)
+  {
+    if (JNT->constrained || (keepMask->ele[JNT->jacobiIndex] > 0.0) ||
+        (keep.find(JNT->name) != keep.end()))
+    {
+      continue;
+    }
+
+    inactiveJoints.push_back(JNT->id);
+  }
+
+  MatNd_destroyN(2, keepMask, tmpMask);
+
+  RLOG(1, "Solving IK for %zu of %u joints", graph->nJ - inactiveJoints.size(),
+       graph->nJ);
+}
+
+/*******************************************************************************
+ * Constrains the inactive joints for the duration of one IK step, so that
+ * the Jacobians and the IK solution only have the active joints' dimension.
+ * Only the joints that were not constrained before are touched, and their
+ * flags are restored right after the step. Therefore, the graph never leaves
+ * this component with our constraints (e.g. when it is copied or rendered).
+ ******************************************************************************/
+void IKComponent::maskInactiveJoints()
+{
+  RcsGraph* graph = controller->getGraph();
+
+  for (int id : inactiveJoints)
+  {
+    RcsJoint* jnt = RCSJOINT_BY_ID(graph, id);
+    if (!jnt->constrained)
+    {
+      jnt->constrained = true;
+      maskedJoints.push_back(id);
+    }
+  }
+
+  if (!maskedJoints.empty())
+  {
+    RcsGraph_makeJointsConsistent(graph);
+  }
+}
+
+void IKComponent::unmaskInactiveJoints()
+{
+  if (maskedJoints.empty())
+  {
+    return;
+  }
+
+  RcsGraph* graph = controller->getGraph();
+
+  for (int id : maskedJoints)
+  {
+    RCSJOINT_BY_ID(graph, id)->constrained = false;
+  }
+
+  maskedJoints.clear();
+  RcsGraph_makeJointsConsistent(graph);
 }
 
 void IKComponent::setAlpha(double value)
@@ -81,6 +81,13 @@ namespace aff
  *                                        state.
  *         - Print: Prints this classes collision model (if exists) and model
  *                  state (taken from the current q-vector) to the console.
+ *         - SetActiveJoints: Restricts the IK to the given joints and to the
+ *                            joints between the manipulators of the last
+ *                            task vector and the root. All other joints are
+ *                            excluded from the IK steps until the next
+ *                            ChangeTaskVector or SetActiveJoints event with
+ *                            an empty list. The joints' constraint flags
+ *                            of the graph are not changed.
  *
  *         \todo:
  *         - In future, this class should be extended with an API to set and
@@ -212,6 +219,9 @@ private:
   void onLinkGenericBody(int gBodyId, std::string bodyName);
   void onTaskVectorChange(std::vector<std::string> taskVec,
                           std::vector<std::string> channels);
+  void onSetActiveJoints(std::vector<std::string> jointNames);
+  void maskInactiveJoints();
+  void unmaskInactiveJoints();
   void print() const;
 
   Rcs::ControllerBase* controller;
@@ -229,6 +239,9 @@ private:
   bool jointLimitCheck;   ///< Default is on
   bool collisionCheck;    ///< Default is on
   bool applySpeedAndAccLimits;    ///< Default is on
+  std::vector<std::string> manipulators;   ///< Of the current task vector
+  std::vector<int> inactiveJoints;   ///< Joint ids excluded from the IK
+  std::vector<int> maskedJoints;     ///< Joint ids constrained during a step
 
   /*! \brief We disallow copying and assigning this class.
    */
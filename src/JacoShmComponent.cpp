@@ -254,6 +254,11 @@ void JacoShmComponent::updateSensors(RcsGraph* graph)
 
 }
 
+const std::vector<std::string>& JacoShmComponent::getJointNames() const
+{
+  return jntNames;
+}
+
 void JacoShmComponent::setCommand(const MatNd* q_des)
 {
   std::vector<double> q_cmd(jntNames.size());
@@ -346,6 +351,11 @@ RoboJacoShmComponent::RoboJacoShmComponent(EntityBase* parent,
   subscribe("EnableCommands", &RoboJacoShmComponent::onEnableCommands);
 }
 
+std::vector<std::string> RoboJacoShmComponent::getWrittenJoints() const
+{
+  return getJointNames();
+}
+
 void RoboJacoShmComponent::onInitFromState(const RcsGraph* target)
 {
   RLOG(0, "RoboJacoComponent::onInitFromState()");
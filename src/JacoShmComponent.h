@@ -60,6 +60,7 @@ public:
   virtual ~JacoShmComponent();
   void updateSensors(RcsGraph* graph);
   void setCommand(const MatNd* q);
+  const std::vector<std::string>& getJointNames() const;
 
 protected:
 
@@ -127,6 +128,7 @@ public:
   RoboJacoShmComponent(EntityBase* parent,
                        const RcsGraph* graph,
                        JacoType jt);
+  std::vector<std::string> getWrittenJoints() const;
 
 private:
 
@@ -0,0 +1,233 @@
+/*******************************************************************************
+
+  Copyright (c) Honda Research Institute Europe GmbH.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+  IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT,
+  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+  OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+#include "LoopScheduler.h"
+
+#include <Rcs_timer.h>
+#include <Rcs_macros.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+
+
+namespace aff
+{
+
+LoopScheduler::LoopScheduler() : clock(0.0), numSteps(0), numDeadlineMisses(0)
+{
+}
+
+void LoopScheduler::addStage(const std::string& name,
+                             std::function<void()> function, double rate)
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  Stage stage;
+  stage.name = name;
+  stage.function = function;
+  stage.period = (rate > 0.0) ? 1.0/rate : 0.0;
+  stage.lastSlot = std::numeric_limits<long long>::min();
+  stage.called = false;
+  stage.numCalls = 0;
+  stage.numMisses = 0;
+  stage.numStepMisses = 0;
+  stage.accumulatedTime = 0.0;
+  stage.maxTime = 0.0;
+  stages.push_back(stage);
+}
+
+LoopScheduler::Stage* LoopScheduler::find(const std::string& name)
+{
+  for (auto& stage : stages)
+  {
+    if (stage.name == name)
+    {
+      return &stage;
+    }
+  }
+
+  return NULL;
+}
+
+const LoopScheduler::Stage* LoopScheduler::find(const std::string& name) const
+{
+  for (const auto& stage : stages)
+  {
+    if (stage.name == name)
+    {
+      return &stage;
+    }
+  }
+
+  return NULL;
+}
+
+bool LoopScheduler::setRate(const std::string& name, double rate)
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  Stage* stage = find(name);
+
+  if (!stage)
+  {
+    RLOG_CPP(1, "Stage \"" << name << "\" not found");
+    return false;
+  }
+
+  stage->period = (rate > 0.0) ? 1.0/rate : 0.0;
+  stage->lastSlot = std::numeric_limits<long long>::min();
+
+  return true;
+}
+
+double LoopScheduler::getRate(const std::string& name) const
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  const Stage* stage = find(name);
+
+  if ((!stage) || (stage->period <= 0.0))
+  {
+    return 0.0;
+  }
+
+  return 1.0/stage->period;
+}
+
+void LoopScheduler::step(double dt)
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  double stepTime = 0.0, slowestTime = 0.0;
+  Stage* slowest = NULL;
+
+  for (auto& stage : stages)
+  {
+    stage.called = false;
+
+    if (stage.period > 0.0)
+    {
+      // The small offset avoids that round-off errors of the accumulated
+      // clock make us miss a period.
+      const long long slot = (long long) std::floor(clock/stage.period + 1.0e-8);
+
+      if (slot == stage.lastSlot)
+      {
+        continue;
+      }
+
+      stage.lastSlot = slot;
+    }
+
+    const double t0 = Timer_getSystemTime();
+    stage.function();
+    const double duration = Timer_getSystemTime() - t0;
+
+    stage.called = true;
+    stage.numCalls++;
+    stage.accumulatedTime += duration;
+    stage.maxTime = std::max(stage.maxTime, duration);
+
+    if (duration > std::max(stage.period, dt))
+    {
+      stage.numMisses++;
+    }
+
+    if ((!slowest) || (duration > slowestTime))
+    {
+      slowest = &stage;
+      slowestTime = duration;
+    }
+
+    stepTime += duration;
+  }
+
+  clock += dt;
+  numSteps++;
+
+  if ((stepTime > dt) && slowest)
+  {
+    numDeadlineMisses++;
+    slowest->numStepMisses++;
+    RLOG(4, "Step took %.1f msec, slowest stage: %s",
+         1.0e3*stepTime, slowest->name.c_str());
+  }
+}
+
+bool LoopScheduler::wasCalled(const std::string& name) const
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  const Stage* stage = find(name);
+  return stage ? stage->called : false;
+}
+
+size_t LoopScheduler::getDeadlineMisses() const
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  return numDeadlineMisses;
+}
+
+void LoopScheduler::resetStatistics()
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  numSteps = 0;
+  numDeadlineMisses = 0;
+
+  for (auto& stage : stages)
+  {
+    stage.numCalls = 0;
+    stage.numMisses = 0;
+    stage.numStepMisses = 0;
+    stage.accumulatedTime = 0.0;
+    stage.maxTime = 0.0;
+  }
+}
+
+void LoopScheduler::print() const
+{
+  std::lock_guard<std::mutex> lock(mtx);
+
+  RLOG_CPP(0, numSteps << " steps, " << numDeadlineMisses
+           << " missed the deadline");
+
+  for (const auto& stage : stages)
+  {
+    const double meanTime = stage.numCalls>0 ? stage.accumulatedTime/stage.numCalls : 0.0;
+    RLOG_CPP(0, std::setw(20) << stage.name << ": rate "
+             << (stage.period > 0.0 ? 1.0/stage.period : 0.0) << " Hz, "
+             << stage.numCalls << " calls, mean: " << 1.0e3*meanTime
+             << " msec, max: " << 1.0e3*stage.maxTime << " msec, "
+             << stage.numMisses << " stage misses, slowest in "
+             << stage.numStepMisses << " step misses");
+  }
+}
+
+}   // namespace aff
@@ -0,0 +1,120 @@
+/*******************************************************************************
+
+  Copyright (c) Honda Research Institute Europe GmbH.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+  IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT,
+  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+  OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+#ifndef AFF_LOOPSCHEDULER_H
+#define AFF_LOOPSCHEDULER_H
+
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+namespace aff
+{
+
+/*! \brief Calls the stages of a loop step, each at its own rate. The loop
+ *         runs at the fastest rate (given by its time step), and a stage
+ *         with a lower rate is called once per period. The scheduler keeps
+ *         its own clock that advances by the time step in each step, so that
+ *         stages keep running if the entity's time is frozen. Periods are
+ *         aligned to the first step, so that stages with the same rate are
+ *         always called in the same steps, and in the order they were added.
+ *         A rate of 0 calls the stage in each step.
+ *
+ *         A stage misses its deadline if it takes longer than its period (or
+ *         the time step if it is called in each step). A step misses its
+ *         deadline if all stages together take longer than the time step.
+ *         Then, the miss is attributed to its slowest stage.
+ */
+class LoopScheduler
+{
+public:
+
+  LoopScheduler();
+
+  /*! \brief Adds a stage. Stages are identified by their name.
+   */
+  void addStage(const std::string& name, std::function<void()> stage,
+                double rate=0.0);
+
+  /*! \brief Sets the rate of the stage in Hz. Returns false if there is no
+   *         stage with this name.
+   */
+  bool setRate(const std::string& name, double rate);
+  double getRate(const std::string& name) const;
+
+  /*! \brief Calls all stages that are due and advances the clock by dt.
+   *         The time step dt is also the deadline for the whole step.
+   */
+  void step(double dt);
+
+  /*! \brief Returns true if the stage has been called in the last step.
+   */
+  bool wasCalled(const std::string& name) const;
+
+  /*! \brief Returns the number of steps that took longer than dt.
+   */
+  size_t getDeadlineMisses() const;
+  void resetStatistics();
+  void print() const;
+
+private:
+
+  struct Stage
+  {
+    std::string name;
+    std::function<void()> function;
+    double period;
+    long long lastSlot;
+    bool called;
+    size_t numCalls;
+    size_t numMisses;
+    size_t numStepMisses;
+    double accumulatedTime;
+    double maxTime;
+  };
+
+  Stage* find(const std::string& name);
+  const Stage* find(const std::string& name) const;
+
+  std::vector<Stage> stages;
+  double clock;
+  size_t numSteps;
+  size_t numDeadlineMisses;
+  mutable std::mutex mtx;
+};
+
+}   // namespace aff
+
+#endif // AFF_LOOPSCHEDULER_H
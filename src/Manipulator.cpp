@@ -62,12 +62,19 @@ namespace aff
  *
  ******************************************************************************/
 
-Manipulator::Manipulator()
+Manipulator::Manipulator() : typeMask(0)
 {
 }
 
-Manipulator::Manipulator(const xmlNodePtr node)
+Manipulator::Manipulator(const xmlNodePtr node,
+                         std::shared_ptr<CapabilityArena> arena) :
+  capabilityArena(arena), typeMask(0)
 {
+  if (!capabilityArena)
+  {
+    capabilityArena = std::make_shared<CapabilityArena>();
+  }
+
   name = Rcs::getXMLNodePropertySTLString(node, "name");
   id = Rcs::getXMLNodePropertySTLString(node, "id");
   type = Rcs::getXMLNodePropertySTLString(node, "type");
@@ -95,49 +102,46 @@ Manipulator::Manipulator(const xmlNodePtr node)
     }
     else if (isXMLNodeNameNoCase(child, "PowergraspCapability"))
     {
-      capabilities.push_back(new PowergraspCapability(child));
+      capabilities.push_back(capabilityArena->create<PowergraspCapability>(child));
     }
     else if (isXMLNodeNameNoCase(child, "PincergraspCapability"))
     {
-      capabilities.push_back(new PincergraspCapability(child));
+      capabilities.push_back(capabilityArena->create<PincergraspCapability>(child));
     }
     else if (isXMLNodeNameNoCase(child, "TwistgraspCapability"))
     {
-      capabilities.push_back(new TwistgraspCapability(child));
+      capabilities.push_back(capabilityArena->create<TwistgraspCapability>(child));
     }
     else if (isXMLNodeNameNoCase(child, "CirculargraspCapability"))
     {
-      capabilities.push_back(new CirculargraspCapability(child));
+      capabilities.push_back(capabilityArena->create<CirculargraspCapability>(child));
     }
     else if (isXMLNodeNameNoCase(child, "PalmgraspCapability"))
     {
-      capabilities.push_back(new PalmgraspCapability(child));
+      capabilities.push_back(capabilityArena->create<PalmgraspCapability>(child));
     }
     else if (isXMLNodeNameNoCase(child, "FingerpushCapability"))
     {
-      capabilities.push_back(new FingerpushCapability(child));
+      capabilities.push_back(capabilityArena->create<FingerpushCapability>(child));
     }
     else if (isXMLNodeNameNoCase(child, "GazeCapability"))
     {
-      capabilities.push_back(new GazeCapability(child));
+      capabilities.push_back(capabilityArena->create<GazeCapability>(child));
     }
 
     child = child->next;
   }
 
+  updateTypeMasks();
 }
 
 Manipulator::Manipulator(const Manipulator& other) :
-  name(other.name), id(other.id), type(other.type), fingerJoints(other.fingerJoints)
+  name(other.name), id(other.id), agent(other.agent), type(other.type),
+  fingerJoints(other.fingerJoints), capabilities(other.capabilities),
+  capabilityArena(other.capabilityArena),
+  capabilityMasks(other.capabilityMasks), affordanceMasks(other.affordanceMasks),
+  typeMask(other.typeMask)
 {
-  RLOG(0, "Copying manipulator");
-
-  for (size_t i=0; i<other.capabilities.size(); ++i)
-  {
-    Capability* ci = other.capabilities[i]->clone();
-    capabilities.push_back(ci);
-  }
-
 }
 
 Manipulator& Manipulator::operator= (const Manipulator& copyFromMe)
@@ -154,26 +158,19 @@ Manipulator& Manipulator::operator= (const Manipulator& copyFromMe)
   type = copyFromMe.type;
   fingerJoints = copyFromMe.fingerJoints;
 
-  for (size_t i=0; i<capabilities.size(); ++i)
-  {
-    delete capabilities[i];
-  }
-  capabilities.clear();
+  // Only the references are copied, the capabilities are shared.
+  capabilities = copyFromMe.capabilities;
+  capabilityArena = copyFromMe.capabilityArena;
 
-  for (size_t i=0; i<copyFromMe.capabilities.size(); ++i)
-  {
-    capabilities.push_back(copyFromMe.capabilities[i]->clone());
-  }
+  capabilityMasks = copyFromMe.capabilityMasks;
+  affordanceMasks = copyFromMe.affordanceMasks;
+  typeMask = copyFromMe.typeMask;
 
   return *this;
 }
 
 Manipulator::~Manipulator()
 {
-  for (auto c : capabilities)
-  {
-    delete c;
-  }
 }
 
 void Manipulator::print() const
@@ -187,6 +184,21 @@ void Manipulator::print() const
   }
 }
 
+void Manipulator::updateTypeMasks()
+{
+  capabilityMasks.clear();
+  affordanceMasks.clear();
+  typeMask = 0;
+
+  for (const Capability* c : capabilities)
+  {
+    capabilityMasks.push_back(Capability::typeBit(c->classType));
+    affordanceMasks.push_back(Affordance::maskFromTypes(c->affordanceTypes));
+    typeMask |= capabilityMasks.back();
+  }
+
+}
+
 bool Manipulator::check(const RcsGraph* graph) const
 {
   bool success = true;
@@ -50,6 +50,8 @@ namespace aff
 
 class ActionScene;
 
+typedef ObjectArena<Capability> CapabilityArena;
+
 class Manipulator
 {
 public:
@@ -61,12 +63,28 @@ public:
   std::vector<std::string> fingerJoints;
   std::vector<Capability*> capabilities;
 
+  // The capabilities are immutable after parsing and owned by
+  // capabilityArena, which is shared between all copies of a manipulator,
+  // and usually between all manipulators of a scene.
+  std::shared_ptr<CapabilityArena> capabilityArena;
+
+  // Precomputed type masks for the matching functions in ActionScene.h. The
+  // vectors have the same order as capabilities. Call updateTypeMasks()
+  // after modifying the capabilities.
+  std::vector<Capability::TypeMask> capabilityMasks;   // Bit of classType
+  std::vector<Affordance::TypeMask> affordanceMasks;   // affordanceTypes
+  Capability::TypeMask typeMask;                       // Union of all classTypes
+
   Manipulator();
-  Manipulator(const xmlNodePtr node);
+  // The capabilities are created in the given arena. If it is NULL, the
+  // manipulator creates its own one.
+  Manipulator(const xmlNodePtr node,
+              std::shared_ptr<CapabilityArena> arena=nullptr);
   Manipulator(const Manipulator& other);
   Manipulator& operator = (const Manipulator&);
   virtual ~Manipulator();
   void print() const;
+  void updateTypeMasks();
   virtual bool check(const RcsGraph* graph) const;
   bool isEmpty(const RcsGraph* graph) const;
   size_t getNumFingers() const;
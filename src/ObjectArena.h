@@ -0,0 +1,148 @@
+/*******************************************************************************
+
+  Copyright (c) Honda Research Institute Europe GmbH.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+  IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT,
+  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+  OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+#ifndef AFF_OBJECTARENA_H
+#define AFF_OBJECTARENA_H
+
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <utility>
+
+namespace aff
+{
+
+/*! \brief Arena for polymorphic objects derived from Base. Objects are
+ *         placement-constructed into large memory blocks in the order of
+ *         creation, so that objects created one after the other (e.g. the
+ *         affordances of one entity) are contiguous in memory. All objects
+ *         are destroyed together with the arena, individual objects can't
+ *         be freed. Base must have a virtual destructor. The class is not
+ *         thread-safe, it is meant to be filled once during parsing.
+ */
+template <typename Base>
+class ObjectArena
+{
+public:
+
+  ObjectArena(size_t blockSize_=4096) : blockSize(blockSize_), blockFill(0)
+  {
+  }
+
+  ~ObjectArena()
+  {
+    // Destroy in reverse order of creation
+    for (auto it = objects.rbegin(); it != objects.rend(); ++it)
+    {
+      (*it)->~Base();
+    }
+
+    for (auto block : blocks)
+    {
+      std::free(block);
+    }
+  }
+
+  ObjectArena(const ObjectArena&) = delete;
+  ObjectArena& operator = (const ObjectArena&) = delete;
+
+  // Defined in the header because it is a template function
+  template <typename T, typename... Args>
+  T* create(Args&& ...args)
+  {
+    // Reserve first, so that push_back can't throw after construction.
+    // The capacity is doubled, reserving one more each time is quadratic.
+    if (objects.size() == objects.capacity())
+    {
+      objects.reserve(objects.empty() ? 64 : 2*objects.capacity());
+    }
+    void* mem = allocate(sizeof(T), alignof(T));
+    T* obj = new (mem) T(std::forward<Args>(args)...);
+    objects.push_back(obj);
+    return obj;
+  }
+
+  // Takes ownership of a heap-allocated object (e.g. from clone()). It is
+  // deleted when the arena is destroyed.
+  Base* adopt(Base* obj)
+  {
+    std::unique_ptr<Base> owned(obj);
+    adopted.push_back(std::move(owned));
+    return obj;
+  }
+
+  size_t size() const
+  {
+    return objects.size() + adopted.size();
+  }
+
+  size_t getNumBlocks() const
+  {
+    return blocks.size();
+  }
+
+private:
+
+  void* allocate(size_t size, size_t alignment)
+  {
+    size_t offset = (blockFill + alignment - 1) & ~(alignment - 1);
+
+    if (blocks.empty() || (offset + size > blockSize))
+    {
+      // Objects larger than the block size get their own block
+      const size_t newBlockSize = size > blockSize ? size : blockSize;
+      void* block = std::malloc(newBlockSize);
+      if (!block)
+      {
+        throw std::bad_alloc();
+      }
+      blocks.push_back(block);
+      blockFill = 0;
+      offset = 0;
+    }
+
+    blockFill = offset + size;
+    return static_cast<char*>(blocks.back()) + offset;
+  }
+
+  size_t blockSize;
+  size_t blockFill;
+  std::vector<void*> blocks;
+  std::vector<Base*> objects;
+  std::vector<std::unique_ptr<Base>> adopted;
+};
+
+} // namespace aff
+
+#endif // AFF_OBJECTARENA_H
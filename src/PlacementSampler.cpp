@@ -0,0 +1,315 @@
+/*******************************************************************************
+
+  Copyright (c) Honda Research Institute Europe GmbH.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+  IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT,
+  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+  OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+#include "PlacementSampler.h"
+#include "BodyBVH.h"
+
+#include <Rcs_typedef.h>
+#include <Rcs_shape.h>
+#include <Rcs_body.h>
+#include <Rcs_math.h>
+#include <Rcs_macros.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#define MAX_GRID_CELLS (256)          // Per dimension
+#define SURFACE_CLEARANCE (0.005)     // Bodies below are part of the surface
+
+
+
+namespace aff
+{
+
+PlacementSampler::PlacementSampler(const RcsGraph* graph_,
+                                   const RcsBody* object,
+                                   std::vector<const RcsBody*> ignoreBodies_,
+                                   double cellSize_) :
+  graph(graph_), ignoreBodies(ignoreBodies_), cellSize(cellSize_),
+  footprintRadius(0.0), height(0.0)
+{
+  RCHECK(object);
+  ignoreBodies.push_back(object);
+  ignoreBodies.erase(std::remove(ignoreBodies.begin(), ignoreBodies.end(),
+                                 (const RcsBody*) NULL), ignoreBodies.end());
+
+  double xyzMin[3], xyzMax[3];
+  if (RcsGraph_computeBodyAABB(graph, object->id, RCSSHAPE_COMPUTE_DISTANCE,
+                               xyzMin, xyzMax, NULL))
+  {
+    footprintRadius = 0.5*std::max(xyzMax[0]-xyzMin[0], xyzMax[1]-xyzMin[1]);
+    height = xyzMax[2]-xyzMin[2];
+  }
+}
+
+double PlacementSampler::getFootprintRadius() const
+{
+  return footprintRadius;
+}
+
+double PlacementSampler::getHeight() const
+{
+  return height;
+}
+
+bool PlacementSampler::isIgnored(const RcsBody* bdy, const RcsBody* surface) const
+{
+  // The surface and the bodies it is attached to (e.g. the table)
+  if ((bdy == surface) || RcsBody_isChild(graph, surface, bdy))
+  {
+    return true;
+  }
+
+  for (const RcsBody* ignore : ignoreBodies)
+  {
+    if ((bdy == ignore) || RcsBody_isChild(graph, bdy, ignore))
+    {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/*******************************************************************************
+ * Returns the footprints of all bodies that overlap with the volume above
+ * the given rectangle of the surface, up to the height of the object. The
+ * bounding boxes are computed in world coordinates and transformed into the
+ * surface frame, which is conservative for rotated surfaces.
+ ******************************************************************************/
+std::vector<PlacementSampler::Rect>
+PlacementSampler::getObstacles(const RcsBody* surface,
+                               const double xyMin[2],
+                               const double xyMax[2]) const
+{
+  const double zMin = SURFACE_CLEARANCE, zMax = std::max(height, 0.01);
+  const HTr* A_SI = &surface->A_BI;
+  double boxMin[3], boxMax[3];
+  Vec3d_set(boxMin, DBL_MAX, DBL_MAX, DBL_MAX);
+  Vec3d_set(boxMax, -DBL_MAX, -DBL_MAX, -DBL_MAX);
+
+  for (int i = 0; i < 8; ++i)
+  {
+    double corner[3], corner_I[3];
+    Vec3d_set(corner, (i & 1) ? xyMax[0] : xyMin[0],
+              (i & 2) ? xyMax[1] : xyMin[1], (i & 4) ? zMax : zMin);
+    Vec3d_transform(corner_I, A_SI, corner);
+    for (int j = 0; j < 3; ++j)
+    {
+      boxMin[j] = std::min(boxMin[j], corner_I[j]);
+      boxMax[j] = std::max(boxMax[j], corner_I[j]);
+    }
+  }
+
+  std::vector<Rect> obstacles;
+
+  for (int id : BodyBVH::threadInstance().overlap(graph, boxMin, boxMax))
+  {
+    const RcsBody* bdy = RCSBODY_BY_ID(graph, id);
+
+    if (isIgnored(bdy, surface))
+    {
+      continue;
+    }
+
+    double bdyMin[3], bdyMax[3];
+    if (!RcsGraph_computeBodyAABB(graph, id, RCSSHAPE_COMPUTE_DISTANCE,
+                                  bdyMin, bdyMax, NULL))
+    {
+      continue;
+    }
+
+    Rect rect;
+    double zLocalMin = DBL_MAX, zLocalMax = -DBL_MAX;
+    rect.xyMin[0] = rect.xyMin[1] = DBL_MAX;
+    rect.xyMax[0] = rect.xyMax[1] = -DBL_MAX;
+
+    for (int i = 0; i < 8; ++i)
+    {
+      double corner_I[3], corner[3];
+      Vec3d_set(corner_I, (i & 1) ? bdyMax[0] : bdyMin[0],
+                (i & 2) ? bdyMax[1] : bdyMin[1], (i & 4) ? bdyMax[2] : bdyMin[2]);
+      Vec3d_invTransform(corner, A_SI, corner_I);
+      for (int j = 0; j < 2; ++j)
+      {
+        rect.xyMin[j] = std::min(rect.xyMin[j], corner[j]);
+        rect.xyMax[j] = std::max(rect.xyMax[j], corner[j]);
+      }
+      zLocalMin = std::min(zLocalMin, corner[2]);
+      zLocalMax = std::max(zLocalMax, corner[2]);
+    }
+
+    // Bodies underneath the surface or above the object don't obstruct
+    if ((zLocalMax < zMin) || (zLocalMin > zMax))
+    {
+      continue;
+    }
+
+    obstacles.push_back(rect);
+  }
+
+  return obstacles;
+}
+
+std::vector<PlacementSampler::Placement>
+PlacementSampler::sample(const RcsBody* surface,
+                         double extentsX, double extentsY,
+                         const double preferredPos[3],
+                         size_t maxPlacements) const
+{
+  std::vector<Placement> placements;
+
+  // Object centers must keep the footprint radius to the border
+  const double xyMin[2] = { -0.5*extentsX, -0.5*extentsY };
+  const double xyMax[2] = { 0.5*extentsX, 0.5*extentsY };
+  const double freeMin[2] = { xyMin[0]+footprintRadius, xyMin[1]+footprintRadius };
+  const double freeMax[2] = { xyMax[0]-footprintRadius, xyMax[1]-footprintRadius };
+
+  if ((freeMin[0] > freeMax[0]) || (freeMin[1] > freeMax[1]) || (maxPlacements == 0))
+  {
+    return placements;
+  }
+
+  // Grid over the area of valid object centers
+  const double cs = std::max(cellSize, std::max(freeMax[0]-freeMin[0],
+                                                freeMax[1]-freeMin[1])/MAX_GRID_CELLS);
+  const int nx = (int)((freeMax[0]-freeMin[0])/cs) + 1;
+  const int ny = (int)((freeMax[1]-freeMin[1])/cs) + 1;
+  std::vector<unsigned char> occupied(nx*ny, 0);
+
+  auto cellX = [&](double x)
+  {
+    return Math_iClip((int) floor((x-freeMin[0])/cs + 0.5), 0, nx-1);
+  };
+
+  auto cellY = [&](double y)
+  {
+    return Math_iClip((int) floor((y-freeMin[1])/cs + 0.5), 0, ny-1);
+  };
+
+  // Mark the obstacles, dilated by the footprint of the object
+  for (const Rect& r : getObstacles(surface, xyMin, xyMax))
+  {
+    const double x0 = r.xyMin[0]-footprintRadius, x1 = r.xyMax[0]+footprintRadius;
+    const double y0 = r.xyMin[1]-footprintRadius, y1 = r.xyMax[1]+footprintRadius;
+
+    if ((x1 < freeMin[0]) || (x0 > freeMax[0]) || (y1 < freeMin[1]) || (y0 > freeMax[1]))
+    {
+      continue;
+    }
+
+    for (int iy = cellY(y0); iy <= cellY(y1); ++iy)
+    {
+      for (int ix = cellX(x0); ix <= cellX(x1); ++ix)
+      {
+        occupied[iy*nx+ix] = 1;
+      }
+    }
+  }
+
+  // Free cells sorted by the distance to the preferred position
+  double prefLocal[3];
+  Vec3d_invTransform(prefLocal, &surface->A_BI, preferredPos);
+
+  for (int iy = 0; iy < ny; ++iy)
+  {
+    for (int ix = 0; ix < nx; ++ix)
+    {
+      if (occupied[iy*nx+ix])
+      {
+        continue;
+      }
+
+      Placement p;
+      Vec3d_set(p.pos, std::min(freeMin[0]+ix*cs, freeMax[0]),
+                std::min(freeMin[1]+iy*cs, freeMax[1]), 0.0);
+      p.cost = sqrt(Math_sqr(p.pos[0]-prefLocal[0]) + Math_sqr(p.pos[1]-prefLocal[1]));
+      placements.push_back(p);
+    }
+  }
+
+  std::sort(placements.begin(), placements.end(),
+            [](const Placement& a, const Placement& b)
+  {
+    return a.cost < b.cost;
+  });
+
+  // Keep placements that are spread over the surface, so that they are
+  // not all blocked by the same reason during prediction.
+  const double minSeparation = std::max(2.0*footprintRadius, cs);
+  std::vector<Placement> selected;
+
+  for (const Placement& p : placements)
+  {
+    bool isSeparated = true;
+    for (const Placement& s : selected)
+    {
+      if (Math_sqr(p.pos[0]-s.pos[0]) + Math_sqr(p.pos[1]-s.pos[1]) < Math_sqr(minSeparation))
+      {
+        isSeparated = false;
+        break;
+      }
+    }
+
+    if (isSeparated)
+    {
+      selected.push_back(p);
+      if (selected.size() == maxPlacements)
+      {
+        break;
+      }
+    }
+  }
+
+  return selected;
+}
+
+bool PlacementSampler::isFree(const RcsBody* surface, const double pos[3]) const
+{
+  const double xyMin[2] = { pos[0]-footprintRadius, pos[1]-footprintRadius };
+  const double xyMax[2] = { pos[0]+footprintRadius, pos[1]+footprintRadius };
+
+  for (const Rect& r : getObstacles(surface, xyMin, xyMax))
+  {
+    if ((r.xyMax[0] > xyMin[0]) && (r.xyMin[0] < xyMax[0]) &&
+        (r.xyMax[1] > xyMin[1]) && (r.xyMin[1] < xyMax[1]))
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+}   // namespace aff
@@ -0,0 +1,113 @@
+/*******************************************************************************
+
+  Copyright (c) Honda Research Institute Europe GmbH.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+  IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT,
+  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+  OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+#ifndef AFF_PLACEMENTSAMPLER_H
+#define AFF_PLACEMENTSAMPLER_H
+
+#include <Rcs_graph.h>
+
+#include <vector>
+
+namespace aff
+{
+
+/*! \brief Samples free placement poses for an object on rectangular support
+ *         surfaces (Supportables with extents). For each surface, a 2D
+ *         occupancy grid is computed in the surface frame from the bodies
+ *         that are located above it (queried through the BodyBVH). The
+ *         occupied cells are dilated by the footprint radius of the object,
+ *         so that each free cell is a valid placement of the object's center.
+ *
+ *         The footprint and height of the object are taken from its
+ *         axis-aligned bounding box when the sampler is constructed. The
+ *         object, the given ignore bodies and all their children, as well as
+ *         the bodies that the surface is attached to, are not considered as
+ *         obstacles.
+ */
+class PlacementSampler
+{
+public:
+
+  struct Placement
+  {
+    double pos[3];   // Object position in the surface frame
+    double cost;     // Distance to the preferred position
+  };
+
+  PlacementSampler(const RcsGraph* graph, const RcsBody* object,
+                   std::vector<const RcsBody*> ignoreBodies=std::vector<const RcsBody*>(),
+                   double cellSize=0.01);
+
+  /*! \brief Returns up to maxPlacements free placements on the rectangle
+   *         with size extentsX x extentsY centered at the origin of
+   *         surface. They are sorted by their distance to preferredPos
+   *         (in world coordinates, projected onto the surface) and are at
+   *         least one footprint diameter apart from each other.
+   */
+  std::vector<Placement> sample(const RcsBody* surface,
+                                double extentsX, double extentsY,
+                                const double preferredPos[3],
+                                size_t maxPlacements) const;
+
+  /*! \brief Returns true if the object can be placed at position pos given
+   *         in the frame of the surface without overlapping another body.
+   */
+  bool isFree(const RcsBody* surface, const double pos[3]) const;
+
+  double getFootprintRadius() const;
+  double getHeight() const;
+
+private:
+
+  // Footprint of an obstacle in the surface frame
+  struct Rect
+  {
+    double xyMin[2];
+    double xyMax[2];
+  };
+
+  std::vector<Rect> getObstacles(const RcsBody* surface,
+                                 const double xyMin[2],
+                                 const double xyMax[2]) const;
+  bool isIgnored(const RcsBody* bdy, const RcsBody* surface) const;
+
+  const RcsGraph* graph;
+  std::vector<const RcsBody*> ignoreBodies;
+  double cellSize;
+  double footprintRadius;
+  double height;
+};
+
+}   // namespace aff
+
+#endif // AFF_PLACEMENTSAMPLER_H
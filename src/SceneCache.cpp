@@ -0,0 +1,951 @@
+/*******************************************************************************
+
+  Copyright (c) Honda Research Institute Europe GmbH.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+  IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT,
+  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+  OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+#include "SceneCache.h"
+#include "ActionScene.h"
+
+#include <Rcs_resourcePath.h>
+#include <Rcs_macros.h>
+
+#include <libxml/parser.h>
+#include <libxml/uri.h>
+
+#include <vector>
+#include <set>
+#include <map>
+#include <mutex>
+#include <functional>
+#include <fstream>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+
+#if !defined (_MSC_VER)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#endif
+
+
+
+namespace aff
+{
+
+static std::mutex cacheDirMtx;
+
+static std::string& cacheDirectory()
+{
+  static std::string dir = getenv("AFF_SCENE_CACHE_DIR") ?
+                           getenv("AFF_SCENE_CACHE_DIR") : "";
+  return dir;
+}
+
+void SceneCache::setDirectory(const std::string& directory)
+{
+  std::lock_guard<std::mutex> lock(cacheDirMtx);
+  cacheDirectory() = directory;
+}
+
+std::string SceneCache::getDirectory()
+{
+  std::lock_guard<std::mutex> lock(cacheDirMtx);
+  return cacheDirectory();
+}
+
+bool SceneCache::isEnabled()
+{
+  const char* env = getenv("AFF_SCENE_CACHE");
+
+  if (env && (strcmp(env, "0")==0))
+  {
+    return false;
+  }
+
+  return !getDirectory().empty();
+}
+
+#if !defined (_MSC_VER)
+
+/*******************************************************************************
+ * Binary layout of the cache file. All tables follow the header in this
+ * order. Node and attribute names and values are offsets into the string
+ * table, which is a sequence of zero-terminated strings. The nodes are stored
+ * in document order, so that each node's parent comes before the node.
+ ******************************************************************************/
+static const char cacheMagic[8] = "AFFSCN";
+static const uint32_t cacheVersion = 2;
+
+struct CacheHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t numFiles;
+  uint32_t numNodes;
+  uint32_t numAttributes;
+  uint32_t numSequences;
+  uint32_t stringBytes;
+};
+
+struct CacheFile
+{
+  uint32_t path;
+  uint32_t reserved;
+  int64_t mtime;     // Nanoseconds
+  uint64_t size;
+  uint64_t hash;
+};
+
+struct CacheNode
+{
+  uint32_t name;
+  int32_t parent;    // -1 for nodes below the root
+  uint32_t firstAttribute;
+  uint32_t numAttributes;
+};
+
+struct CacheAttribute
+{
+  uint32_t name;
+  uint32_t value;
+};
+
+struct CacheSequence
+{
+  uint32_t name;
+  uint32_t text;
+};
+
+static_assert(sizeof(CacheHeader)%8==0 && sizeof(CacheFile)%8==0 &&
+              sizeof(CacheNode)%8==0 && sizeof(CacheAttribute)%8==0 &&
+              sizeof(CacheSequence)%8==0,
+              "Cache tables must keep 8 byte alignment");
+
+// Pointers into the mapped cache file after validation.
+struct CacheTables
+{
+  const CacheHeader* hdr;
+  const CacheFile* files;
+  const CacheNode* nodes;
+  const CacheAttribute* attrs;
+  const CacheSequence* sequences;
+  const char* strings;
+};
+
+// In-memory representation of the cache file during writing.
+struct CacheImage
+{
+  std::vector<CacheFile> files;
+  std::vector<CacheNode> nodes;
+  std::vector<CacheAttribute> attributes;
+  std::vector<CacheSequence> sequences;
+  std::string strings;
+  std::map<std::string, uint32_t> stringIndex;
+
+  uint32_t addString(const char* str)
+  {
+    auto it = stringIndex.find(str);
+    if (it != stringIndex.end())
+    {
+      return it->second;
+    }
+
+    uint32_t offset = strings.size();
+    strings.append(str);
+    strings.push_back('\0');
+    stringIndex[str] = offset;
+    return offset;
+  }
+};
+
+/*******************************************************************************
+ * FNV-1a hash
+ ******************************************************************************/
+static uint64_t hashBytes(const char* data, size_t len, uint64_t hash=14695981039346656037ULL)
+{
+  for (size_t i = 0; i < len; ++i)
+  {
+    hash ^= (unsigned char) data[i];
+    hash *= 1099511628211ULL;
+  }
+
+  return hash;
+}
+
+static bool hashFile(const std::string& path, uint64_t* hash)
+{
+  std::ifstream fd(path, std::ios::binary);
+
+  if (!fd)
+  {
+    return false;
+  }
+
+  std::vector<char> buf(1 << 16);
+  *hash = hashBytes(NULL, 0);
+
+  while (fd)
+  {
+    fd.read(buf.data(), buf.size());
+    *hash = hashBytes(buf.data(), fd.gcount(), *hash);
+  }
+
+  return true;
+}
+
+static bool statFile(const std::string& path, int64_t* mtime, uint64_t* size)
+{
+  struct stat st;
+
+  if (stat(path.c_str(), &st) != 0)
+  {
+    return false;
+  }
+
+  *mtime = (int64_t) st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+  *size = st.st_size;
+  return true;
+}
+
+static std::string absolutePath(const std::string& fileName)
+{
+  char* path = realpath(fileName.c_str(), NULL);
+
+  if (!path)
+  {
+    return std::string();
+  }
+
+  std::string absPath(path);
+  free(path);
+  return absPath;
+}
+
+static std::string resolveFileName(const std::string& xmlFile)
+{
+  char fullName[RCS_MAX_FILENAMELEN] = "";
+
+  if (!Rcs_getAbsoluteFileName(xmlFile.c_str(), fullName))
+  {
+    return std::string();
+  }
+
+  return absolutePath(fullName);
+}
+
+static std::string getCacheDirectory(bool create)
+{
+  std::string dir = SceneCache::getDirectory();
+
+  if (create && !dir.empty())
+  {
+    mkdir(dir.c_str(), 0755);
+  }
+
+  return dir;
+}
+
+/*******************************************************************************
+ * Collects the file and all files it includes through XInclude, recursively.
+ * The files are only parsed, the includes are not processed.
+ ******************************************************************************/
+static bool collectFiles(const std::string& fileName,
+                         std::vector<std::string>& files,
+                         std::set<std::string>& visited);
+
+static bool collectIncludes(const xmlNodePtr parentNode, const xmlChar* baseUrl,
+                            std::vector<std::string>& files,
+                            std::set<std::string>& visited)
+{
+  bool success = true;
+
+  for (xmlNodePtr node = parentNode; node; node = node->next)
+  {
+    if (node->type != XML_ELEMENT_NODE)
+    {
+      continue;
+    }
+
+    if ((xmlStrcmp(node->name, BAD_CAST "include")==0) && node->ns &&
+        xmlStrstr(node->ns->href, BAD_CAST "XInclude"))
+    {
+      xmlChar* href = xmlGetProp(node, BAD_CAST "href");
+
+      if (href)
+      {
+        xmlChar* uri = xmlBuildURI(href, baseUrl);
+        success = uri && collectFiles((const char*) uri, files, visited) && success;
+        xmlFree(uri);
+        xmlFree(href);
+      }
+    }
+    else
+    {
+      success = collectIncludes(node->children, baseUrl, files, visited) && success;
+    }
+  }
+
+  return success;
+}
+
+static bool collectFiles(const std::string& fileName,
+                         std::vector<std::string>& files,
+                         std::set<std::string>& visited)
+{
+  std::string absPath = absolutePath(fileName);
+
+  if (absPath.empty())
+  {
+    RLOG_CPP(1, "Can't resolve included file " << fileName);
+    return false;
+  }
+
+  if (!visited.insert(absPath).second)
+  {
+    return true;
+  }
+
+  files.push_back(absPath);
+
+  xmlDocPtr doc = xmlReadFile(absPath.c_str(), NULL,
+                              XML_PARSE_NONET | XML_PARSE_NOERROR | XML_PARSE_NOWARNING);
+  if (!doc)
+  {
+    // Non-xml includes (parse="text") are hashed, but not descended into.
+    return true;
+  }
+
+  bool success = collectIncludes(xmlDocGetRootElement(doc), doc->URL, files, visited);
+  xmlFreeDoc(doc);
+
+  return success;
+}
+
+/*******************************************************************************
+ * Collects the files that have been included into the XInclude-processed
+ * document. These are the xml:base of the included root elements, and the
+ * targets of the XInclude start nodes that libxml2 leaves in place of the
+ * include elements, which also covers text includes. Returns false if a file
+ * can't be resolved.
+ ******************************************************************************/
+static bool addIncludedFile(const xmlChar* uri, std::vector<std::string>& files,
+                            std::set<std::string>& visited)
+{
+  std::string absPath = uri ? absolutePath((const char*) uri) : std::string();
+
+  if (absPath.empty())
+  {
+    RLOG(1, "Can't resolve included file %s", uri ? (const char*) uri : "NULL");
+    return false;
+  }
+
+  if (visited.insert(absPath).second)
+  {
+    files.push_back(absPath);
+  }
+
+  return true;
+}
+
+static bool collectIncludedFiles(const xmlNodePtr parentNode,
+                                 std::vector<std::string>& files,
+                                 std::set<std::string>& visited)
+{
+  bool success = true;
+
+  for (xmlNodePtr node = parentNode; node; node = node->next)
+  {
+    if (node->type == XML_XINCLUDE_START)
+    {
+      // xmlGetProp() only accepts element nodes
+      xmlChar* href = NULL;
+      for (xmlAttrPtr attr = node->properties; attr && !href; attr = attr->next)
+      {
+        if (xmlStrcmp(attr->name, BAD_CAST "href")==0)
+        {
+          href = xmlNodeListGetString(node->doc, attr->children, 1);
+        }
+      }
+
+      // Start nodes of nested includes have no attributes. Their files are
+      // found through the xml:base of the included elements.
+      if (href)
+      {
+        xmlChar* base = xmlNodeGetBase(node->doc, node);
+        xmlChar* uri = xmlBuildURI(href, base);
+        success = addIncludedFile(uri, files, visited) && success;
+        xmlFree(uri);
+        xmlFree(base);
+        xmlFree(href);
+      }
+    }
+    else if (node->type == XML_ELEMENT_NODE)
+    {
+      if (xmlHasNsProp(node, BAD_CAST "base", XML_XML_NAMESPACE))
+      {
+        xmlChar* base = xmlNodeGetBase(node->doc, node);
+        success = addIncludedFile(base, files, visited) && success;
+        xmlFree(base);
+      }
+
+      success = collectIncludedFiles(node->children, files, visited) && success;
+    }
+  }
+
+  return success;
+}
+
+/*******************************************************************************
+ * Copies all nodes that are needed by ActionScene::parseRecursive() and
+ * ActionScene::parseAgents() into the image, including all their children.
+ ******************************************************************************/
+static bool isSceneNode(const xmlNodePtr node)
+{
+  return (xmlStrcmp(node->name, BAD_CAST "AffordanceModel")==0) ||
+         (xmlStrcmp(node->name, BAD_CAST "Manipulator")==0) ||
+         (xmlStrcmp(node->name, BAD_CAST "Agent")==0);
+}
+
+static void compileNodes(const xmlNodePtr parentNode, int parentIdx,
+                         bool keep, CacheImage& img)
+{
+  for (xmlNodePtr node = parentNode; node; node = node->next)
+  {
+    if (node->type != XML_ELEMENT_NODE)
+    {
+      continue;
+    }
+
+    if (!keep && !isSceneNode(node))
+    {
+      compileNodes(node->children, -1, false, img);
+      continue;
+    }
+
+    CacheNode cn;
+    cn.name = img.addString((const char*) node->name);
+    cn.parent = parentIdx;
+    cn.firstAttribute = img.attributes.size();
+    cn.numAttributes = 0;
+
+    for (xmlAttrPtr attr = node->properties; attr; attr = attr->next)
+    {
+      // Skips namespaced attributes such as the xml:base added by XInclude
+      if (attr->ns)
+      {
+        continue;
+      }
+
+      xmlChar* value = xmlNodeListGetString(node->doc, attr->children, 1);
+      CacheAttribute ca;
+      ca.name = img.addString((const char*) attr->name);
+      ca.value = img.addString(value ? (const char*) value : "");
+      xmlFree(value);
+      img.attributes.push_back(ca);
+      cn.numAttributes++;
+    }
+
+    img.nodes.push_back(cn);
+    compileNodes(node->children, img.nodes.size()-1, true, img);
+  }
+}
+
+// Same as ActionSequence::parseRecursive()
+static void compileSequences(const xmlNodePtr parentNode, CacheImage& img)
+{
+  for (xmlNodePtr node = parentNode; node; node = node->next)
+  {
+    if (node->type != XML_ELEMENT_NODE)
+    {
+      continue;
+    }
+
+    if (xmlStrcmp(node->name, BAD_CAST "ActionSequence")==0)
+    {
+      xmlChar* name = xmlGetProp(node, BAD_CAST "name");
+      xmlChar* text = xmlGetProp(node, BAD_CAST "text");
+      CacheSequence cs;
+      cs.name = img.addString(name ? (const char*) name : "");
+      cs.text = img.addString(text ? (const char*) text : "");
+      xmlFree(name);
+      xmlFree(text);
+      img.sequences.push_back(cs);
+    }
+
+    compileSequences(node->children, img);
+  }
+}
+
+/*******************************************************************************
+ * Checks the mapped image against the current state of the included files,
+ * and sets up the table pointers. Files that have only been touched are
+ * returned in touchedFiles with their index and new modification time.
+ ******************************************************************************/
+static bool validateImage(const char* mem, size_t memSize,
+                          const std::string& xmlFile, CacheTables& tables,
+                          std::vector<std::pair<uint32_t, int64_t>>& touchedFiles)
+{
+  const CacheHeader* hdr = (const CacheHeader*) mem;
+
+  if ((memcmp(hdr->magic, cacheMagic, sizeof(cacheMagic)) != 0) ||
+      (hdr->version != cacheVersion) || (hdr->numFiles == 0))
+  {
+    return false;
+  }
+
+  const uint64_t fileOffset = sizeof(CacheHeader);
+  const uint64_t nodeOffset = fileOffset + (uint64_t) hdr->numFiles*sizeof(CacheFile);
+  const uint64_t attrOffset = nodeOffset + (uint64_t) hdr->numNodes*sizeof(CacheNode);
+  const uint64_t seqOffset = attrOffset + (uint64_t) hdr->numAttributes*sizeof(CacheAttribute);
+  const uint64_t strOffset = seqOffset + (uint64_t) hdr->numSequences*sizeof(CacheSequence);
+
+  if ((strOffset + hdr->stringBytes != memSize) || (hdr->stringBytes == 0) ||
+      (mem[memSize-1] != '\0'))
+  {
+    RLOG(1, "Scene cache file for %s is corrupted", xmlFile.c_str());
+    return false;
+  }
+
+  const CacheFile* files = (const CacheFile*)(mem + fileOffset);
+  const CacheNode* nodes = (const CacheNode*)(mem + nodeOffset);
+  const CacheAttribute* attrs = (const CacheAttribute*)(mem + attrOffset);
+  const CacheSequence* sequences = (const CacheSequence*)(mem + seqOffset);
+  const char* strings = mem + strOffset;
+
+  // Validate all offsets before touching anything
+  for (uint32_t i = 0; i < hdr->numFiles; ++i)
+  {
+    if (files[i].path >= hdr->stringBytes)
+    {
+      return false;
+    }
+  }
+
+  for (uint32_t i = 0; i < hdr->numNodes; ++i)
+  {
+    if ((nodes[i].name >= hdr->stringBytes) || (nodes[i].parent >= (int32_t) i) ||
+        (nodes[i].parent < -1) ||
+        ((uint64_t) nodes[i].firstAttribute + nodes[i].numAttributes > hdr->numAttributes))
+    {
+      return false;
+    }
+  }
+
+  for (uint32_t i = 0; i < hdr->numAttributes; ++i)
+  {
+    if ((attrs[i].name >= hdr->stringBytes) || (attrs[i].value >= hdr->stringBytes))
+    {
+      return false;
+    }
+  }
+
+  for (uint32_t i = 0; i < hdr->numSequences; ++i)
+  {
+    if ((sequences[i].name >= hdr->stringBytes) || (sequences[i].text >= hdr->stringBytes))
+    {
+      return false;
+    }
+  }
+
+  // The first file is the scene file itself. This catches collisions of the
+  // cache file name.
+  if (resolveFileName(xmlFile) != std::string(strings + files[0].path))
+  {
+    return false;
+  }
+
+  // The modification time is compared first. Only if it differs, the file
+  // content is hashed, so that touching a file doesn't invalidate the cache.
+  // The new modification time is written back by readImage().
+  for (uint32_t i = 0; i < hdr->numFiles; ++i)
+  {
+    const std::string path = strings + files[i].path;
+    int64_t mtime;
+    uint64_t size, hash;
+
+    if (!statFile(path, &mtime, &size) || (size != files[i].size))
+    {
+      RLOG(1, "Scene cache is outdated: %s changed", path.c_str());
+      return false;
+    }
+
+    if (mtime != files[i].mtime)
+    {
+      if (!hashFile(path, &hash) || (hash != files[i].hash))
+      {
+        RLOG(1, "Scene cache is outdated: %s changed", path.c_str());
+        return false;
+      }
+
+      touchedFiles.push_back(std::make_pair(i, mtime));
+    }
+  }
+
+  tables.hdr = hdr;
+  tables.files = files;
+  tables.nodes = nodes;
+  tables.attrs = attrs;
+  tables.sequences = sequences;
+  tables.strings = strings;
+
+  return true;
+}
+
+/*******************************************************************************
+ * Writes the new modification times of touched files into their entries of
+ * the file table, so that the next load doesn't hash them again. Each stamp
+ * is a single aligned 8 byte write. A reader that sees an old stamp only
+ * falls back to the hash comparison.
+ ******************************************************************************/
+static void updateFileStamps(const std::string& cacheFile,
+                             const std::vector<std::pair<uint32_t, int64_t>>& touchedFiles)
+{
+  int fd = open(cacheFile.c_str(), O_WRONLY);
+
+  if (fd == -1)
+  {
+    RLOG(1, "Failed to update scene cache file %s", cacheFile.c_str());
+    return;
+  }
+
+  for (const auto& f : touchedFiles)
+  {
+    const off_t offset = sizeof(CacheHeader) + (off_t) f.first*sizeof(CacheFile) +
+                         offsetof(CacheFile, mtime);
+
+    if (pwrite(fd, &f.second, sizeof(f.second), offset) != (ssize_t) sizeof(f.second))
+    {
+      RLOG(1, "Failed to update scene cache file %s", cacheFile.c_str());
+      break;
+    }
+  }
+
+  close(fd);
+}
+
+/*******************************************************************************
+ * Maps the cache file of xmlFile and calls visit with its tables if it is
+ * valid.
+ ******************************************************************************/
+static bool readImage(const std::string& xmlFile,
+                      std::function<void(const CacheTables&)> visit)
+{
+  if (!SceneCache::isEnabled())
+  {
+    return false;
+  }
+
+  std::string cacheFile = SceneCache::getCacheFileName(xmlFile);
+
+  if (cacheFile.empty())
+  {
+    return false;
+  }
+
+  int fd = open(cacheFile.c_str(), O_RDONLY);
+
+  if (fd == -1)
+  {
+    return false;
+  }
+
+  struct stat st;
+
+  if ((fstat(fd, &st) != 0) || (st.st_size < (off_t) sizeof(CacheHeader)))
+  {
+    close(fd);
+    return false;
+  }
+
+  void* mem = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+
+  if (mem == MAP_FAILED)
+  {
+    return false;
+  }
+
+  CacheTables tables;
+  std::vector<std::pair<uint32_t, int64_t>> touchedFiles;
+  bool success = validateImage((const char*) mem, st.st_size, xmlFile, tables,
+                               touchedFiles);
+
+  if (success)
+  {
+    visit(tables);
+  }
+
+  munmap(mem, st.st_size);
+
+  if (success && !touchedFiles.empty())
+  {
+    updateFileStamps(cacheFile, touchedFiles);
+  }
+
+  return success;
+}
+
+std::string SceneCache::getCacheFileName(const std::string& xmlFile)
+{
+  std::string absPath = resolveFileName(xmlFile);
+  std::string dir = getCacheDirectory(false);
+
+  if (absPath.empty() || dir.empty())
+  {
+    return std::string();
+  }
+
+  char hashStr[32];
+  snprintf(hashStr, sizeof(hashStr), "%016llx",
+           (unsigned long long) hashBytes(absPath.c_str(), absPath.size()));
+
+  return dir + "/scene_" + hashStr + ".bin";
+}
+
+bool SceneCache::load(const std::string& xmlFile, ActionScene* scene)
+{
+  return readImage(xmlFile, [scene](const CacheTables& t)
+  {
+    xmlDocPtr doc = xmlNewDoc(BAD_CAST "1.0");
+    xmlNodePtr root = xmlNewDocNode(doc, NULL, BAD_CAST "Graph", NULL);
+    xmlDocSetRootElement(doc, root);
+    std::vector<xmlNodePtr> xmlNodes(t.hdr->numNodes);
+
+    for (uint32_t i = 0; i < t.hdr->numNodes; ++i)
+    {
+      const CacheNode& n = t.nodes[i];
+      xmlNodePtr parent = (n.parent == -1) ? root : xmlNodes[n.parent];
+      xmlNodes[i] = xmlNewChild(parent, NULL, BAD_CAST (t.strings + n.name), NULL);
+
+      for (uint32_t j = 0; j < n.numAttributes; ++j)
+      {
+        const CacheAttribute& a = t.attrs[n.firstAttribute+j];
+        xmlNewProp(xmlNodes[i], BAD_CAST (t.strings + a.name),
+                   BAD_CAST (t.strings + a.value));
+      }
+    }
+
+    ActionScene::parseRecursive(root, scene);
+    ActionScene::parseAgents(root, scene);
+    xmlFreeDoc(doc);
+  });
+}
+
+bool SceneCache::loadSequences(const std::string& xmlFile,
+                               std::vector<std::pair<std::string, std::string>>& sequences)
+{
+  return readImage(xmlFile, [&sequences](const CacheTables& t)
+  {
+    for (uint32_t i = 0; i < t.hdr->numSequences; ++i)
+    {
+      sequences.push_back(std::make_pair(std::string(t.strings + t.sequences[i].name),
+                                         std::string(t.strings + t.sequences[i].text)));
+    }
+  });
+}
+
+bool SceneCache::store(const std::string& xmlFile, const xmlNodePtr root)
+{
+  if (!isEnabled())
+  {
+    return false;
+  }
+
+  std::string absPath = resolveFileName(xmlFile);
+
+  if (absPath.empty() || getCacheDirectory(true).empty())
+  {
+    return false;
+  }
+
+  CacheImage img;
+  compileNodes(root, -1, false, img);
+  compileSequences(root, img);
+
+  std::vector<std::string> fileNames(1, absPath);
+  std::set<std::string> visited;
+  visited.insert(absPath);
+
+  if (!collectIncludedFiles(root, fileNames, visited))
+  {
+    RLOG(1, "Failed to collect included files of %s - not caching scene",
+         absPath.c_str());
+    return false;
+  }
+
+  for (const auto& fileName : fileNames)
+  {
+    CacheFile cf;
+    cf.path = img.addString(fileName.c_str());
+    cf.reserved = 0;
+
+    if (!statFile(fileName, &cf.mtime, &cf.size) || !hashFile(fileName, &cf.hash))
+    {
+      return false;
+    }
+
+    img.files.push_back(cf);
+  }
+
+  CacheHeader hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, cacheMagic, sizeof(cacheMagic));
+  hdr.version = cacheVersion;
+  hdr.numFiles = img.files.size();
+  hdr.numNodes = img.nodes.size();
+  hdr.numAttributes = img.attributes.size();
+  hdr.numSequences = img.sequences.size();
+  hdr.stringBytes = img.strings.size();
+
+  // Written to a temporary file and renamed, so that concurrently starting
+  // processes never see a partially written cache.
+  std::string cacheFile = getCacheFileName(xmlFile);
+  std::string tmpFile = cacheFile + "." + std::to_string(getpid());
+  FILE* out = fopen(tmpFile.c_str(), "wb");
+
+  if (!out)
+  {
+    RLOG(1, "Failed to open scene cache file %s", tmpFile.c_str());
+    return false;
+  }
+
+  bool success = fwrite(&hdr, sizeof(hdr), 1, out) == 1;
+  success = success && (img.files.empty() ||
+                        fwrite(img.files.data(), sizeof(CacheFile), img.files.size(), out) == img.files.size());
+  success = success && (img.nodes.empty() ||
+                        fwrite(img.nodes.data(), sizeof(CacheNode), img.nodes.size(), out) == img.nodes.size());
+  success = success && (img.attributes.empty() ||
+                        fwrite(img.attributes.data(), sizeof(CacheAttribute), img.attributes.size(), out) == img.attributes.size());
+  success = success && (img.sequences.empty() ||
+                        fwrite(img.sequences.data(), sizeof(CacheSequence), img.sequences.size(), out) == img.sequences.size());
+  success = success && fwrite(img.strings.data(), 1, img.strings.size(), out) == img.strings.size();
+  success = (fclose(out) == 0) && success;
+  success = success && (rename(tmpFile.c_str(), cacheFile.c_str()) == 0);
+
+  if (!success)
+  {
+    RLOG(1, "Failed to write scene cache file %s", cacheFile.c_str());
+    remove(tmpFile.c_str());
+    return false;
+  }
+
+  RLOG(1, "Wrote scene cache %s: %zu files, %zu nodes, %zu sequences",
+       cacheFile.c_str(), img.files.size(), img.nodes.size(), img.sequences.size());
+
+  return true;
+}
+
+std::vector<std::string> SceneCache::getIncludedFiles(const std::string& xmlFile)
+{
+  std::vector<std::string> fileNames;
+  std::set<std::string> visited;
+  std::string absPath = resolveFileName(xmlFile);
+
+  if (absPath.empty() || !collectFiles(absPath, fileNames, visited))
+  {
+    fileNames.clear();
+  }
+
+  return fileNames;
+}
+
+bool SceneCache::getFileStamp(const std::string& path, int64_t* mtime, uint64_t* size)
+{
+  return statFile(path, mtime, size);
+}
+
+void SceneCache::invalidate(const std::string& xmlFile)
+{
+  std::string cacheFile = getCacheFileName(xmlFile);
+
+  if (!cacheFile.empty())
+  {
+    remove(cacheFile.c_str());
+  }
+}
+
+#else   // _MSC_VER
+
+// The cache relies on mmap and is not supported on Windows.
+std::string SceneCache::getCacheFileName(const std::string&)
+{
+  return std::string();
+}
+
+bool SceneCache::load(const std::string&, ActionScene*)
+{
+  return false;
+}
+
+bool SceneCache::loadSequences(const std::string&,
+                               std::vector<std::pair<std::string, std::string>>&)
+{
+  return false;
+}
+
+bool SceneCache::store(const std::string&, const xmlNodePtr)
+{
+  return false;
+}
+
+std::vector<std::string> SceneCache::getIncludedFiles(const std::string&)
+{
+  return std::vector<std::string>();
+}
+
+// Only second resolution
+bool SceneCache::getFileStamp(const std::string& path, int64_t* mtime, uint64_t* size)
+{
+  struct _stat64 st;
+
+  if (_stat64(path.c_str(), &st) != 0)
+  {
+    return false;
+  }
+
+  *mtime = (int64_t) st.st_mtime * 1000000000;
+  *size = st.st_size;
+  return true;
+}
+
+void SceneCache::invalidate(const std::string&)
+{
+}
+
+#endif   // _MSC_VER
+
+} // namespace aff
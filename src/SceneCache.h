@@ -0,0 +1,120 @@
+/*******************************************************************************
+
+  Copyright (c) Honda Research Institute Europe GmbH.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+  IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT,
+  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+  OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+#ifndef AFF_SCENECACHE_H
+#define AFF_SCENECACHE_H
+
+#include <libxml/tree.h>
+
+#include <string>
+#include <cstdint>
+#include <vector>
+#include <utility>
+
+/*
+
+Compiled binary cache of the scene description. Parsing the scene's xml
+file with all its includes dominates the start-up time, while ActionScene
+only needs a small part of it: the AffordanceModel, Manipulator and Agent
+nodes, and the name and text of the action sequences. After a successful
+parse, these are written in a flat binary image (node, attribute, sequence
+and string tables) together with the modification time, size and hash of all
+files that were included into the scene. On the next load, the image is
+memory-mapped and the files are checked. The sequences are copied out
+directly, and the nodes are handed to the same parsing functions as the
+original xml tree, so that the resulting ActionScene is identical.
+
+The cache is disabled by default. It is enabled by setting a directory for
+the cache files with setDirectory() or through the environment variable
+AFF_SCENE_CACHE_DIR. Setting AFF_SCENE_CACHE=0 disables it in any case.
+
+*/
+
+namespace aff
+{
+
+class ActionScene;
+
+class SceneCache
+{
+public:
+
+  /*! \brief Fills the scene from the cache file of xmlFile. Returns false if
+   *         there is no valid cache file, for instance if any of the
+   *         included xml files changed. In this case, the scene is
+   *         unchanged.
+   */
+  static bool load(const std::string& xmlFile, ActionScene* scene);
+
+  /*! \brief Appends the name and text of all action sequences of xmlFile
+   *         from its cache file. Returns false if there is no valid cache
+   *         file. In this case, the sequences are unchanged.
+   */
+  static bool loadSequences(const std::string& xmlFile,
+                            std::vector<std::pair<std::string, std::string>>& sequences);
+
+  /*! \brief Writes the cache file of xmlFile. The root node is the one of the
+   *         XInclude-processed document of xmlFile. The included files are
+   *         determined from its XInclude and xml:base information, so that
+   *         none of them needs to be parsed again. Returns false on failure.
+   */
+  static bool store(const std::string& xmlFile, const xmlNodePtr root);
+
+  /*! \brief Deletes the cache file of xmlFile if it exists.
+   */
+  static void invalidate(const std::string& xmlFile);
+
+  /*! \brief Returns the absolute paths of the file and all files it
+   *         includes through XInclude, recursively. Returns an empty vector
+   *         on failure.
+   */
+  static std::vector<std::string> getIncludedFiles(const std::string& xmlFile);
+
+  /*! \brief Returns the modification time of the file in nanoseconds and its
+   *         size, as used for checking the cache. Returns false if the file
+   *         can't be accessed.
+   */
+  static bool getFileStamp(const std::string& path, int64_t* mtime, uint64_t* size);
+
+  /*! \brief Sets the directory of the cache files. It is created if it does
+   *         not exist, but not its parent directories. An empty string
+   *         disables the cache.
+   */
+  static void setDirectory(const std::string& directory);
+  static std::string getDirectory();
+  static bool isEnabled();
+  static std::string getCacheFileName(const std::string& xmlFile);
+};
+
+} // namespace aff
+
+#endif // AFF_SCENECACHE_H
@@ -47,36 +47,67 @@ namespace aff
 {
 
 /*******************************************************************************
- *
+ * Physics shapes of the body. In world frame, the Euler angles are the ones of
+ * the body (as they always have been), otherwise the ones of the shape.
  ******************************************************************************/
-void getSceneState(nlohmann::json& stateJson,
-                   const ActionScene* scene,
-                   const RcsGraph* graph)
+static nlohmann::json getCollisionShapes(RcsBody* bdy, bool worldFrame)
 {
-  std::string fb;
-  std::string logStr;
-
-  // Step 1: Collect manipulator data
-  for (const auto& m : scene->manipulators)
+  /*
+    "collision_shapes" : [{"type": "BOX",    "position": [0, 0, 1], "euler_xyzr": [1, 2, 3], "extents":  [1, 2, 3]},
+                          {"type": "SPHERE", "position": [0, 0, 1], "euler_xyzr": [1, 2, 3], "extents":  [1, 2, 3]},
+                          {"type": "MESH",   "position": [0, 0, 1], "euler_xyzr": [1, 2, 3], "file":  "meshfile.stl"}]
+  */
+  nlohmann::json shapeJson;
+
+  RCSBODY_TRAVERSE_SHAPES(bdy)
   {
-    logStr += m.name + "; ";
+    if (!RcsShape_isOfComputeType(SHAPE, RCSSHAPE_COMPUTE_PHYSICS))
+    {
+      continue;
+    }
 
-    std::vector<std::string> collectedChildren = m.getChildrenOfManipulator(scene, graph, false);
+    HTr A_CI;
+    double ea[3];
 
-    stateJson[m.name]["type"] = m.type;
-    stateJson[m.name]["holdsObject"] = collectedChildren;
-    stateJson[m.name]["isHeldByObject"] = std::vector<std::string>();
+    if (worldFrame)
+    {
+      HTr_transform(&A_CI, &bdy->A_BI, &SHAPE->A_CB);
+      Mat3d_toEulerAngles(ea, bdy->A_BI.rot);
+    }
+    else
+    {
+      HTr_copy(&A_CI, &SHAPE->A_CB);
+      Mat3d_toEulerAngles(ea, A_CI.rot);
+    }
+
+    nlohmann::json j2 =
+    {
+      {"type", RcsShape_name(SHAPE->type)},
+      {"position", std::vector<double>(A_CI.org, A_CI.org+3)},
+      {"euler_xyzr", std::vector<double>(ea, ea+3)},
+      {"extents", std::vector<double>(SHAPE->extents, SHAPE->extents+3)},
+    };
+    shapeJson += j2;
   }
 
-  RLOG_CPP(1, "Manipulators: " << logStr);
-  logStr.clear();
+  return shapeJson;
+}
 
-  // Step 2: Collect affordance entity data
-  for (const auto& e : scene->entities)
+/*******************************************************************************
+ *
+ ******************************************************************************/
+void getStaticSceneState(nlohmann::json& stateJson,
+                         const ActionScene* scene,
+                         const RcsGraph* graph,
+                         bool shapesInWorldFrame)
+{
+  for (const auto& m : scene->manipulators)
   {
-    logStr += e.name + "; ";
-
+    stateJson[m.name]["type"] = m.type;
+  }
 
+  for (const auto& e : scene->entities)
+  {
     RcsBody* bdy = RcsGraph_getBodyByName(graph, e.bdyName.c_str());
     RCHECK(bdy);
 
@@ -101,60 +132,65 @@ void getSceneState(nlohmann::json& stateJson,
 
     stateJson[e.name]["type"] = e.type;
     stateJson[e.name]["color"] = bodyColor;
+    stateJson[e.name]["collision_shapes"] = getCollisionShapes(bdy, shapesInWorldFrame);
+  }
 
+  // TODO (CP) - currently hardcoded
+  // "lab": {
+  //   "type": "room",
+  //   "holdsObject": ["table"],
+  //   "isHeldByObject" : []
+  // }
+  {
+    stateJson["lab"]["type"] = "room";
+    stateJson["lab"]["holdsObject"] = std::vector<std::string>({"table", "shelf"});
+    stateJson["lab"]["isHeldByObject"] = std::vector<std::string>();
+  }
 
-    // Add shapes with position and Euler angles
-    /*
+  // TODO (CP) - currently hardcoded
+  // "robot": {
+  //   "type": "robot",
+  //   "holdsObject": ["gaze","hand_left","hand_right"],
+  //   "isHeldByObject": ["lab"]
+  // }
+  {
+    stateJson["robot"]["type"] = "robot";
+    stateJson["robot"]["holdsObject"] = std::vector<std::string>({"gaze", "hand_left", "hand_right"});
+    stateJson["robot"]["isHeldByObject"] = std::vector<std::string>({"lab"});
+  }
+}
 
+/*******************************************************************************
+ *
+ ******************************************************************************/
+void getDynamicSceneState(nlohmann::json& stateJson,
+                          const ActionScene* scene,
+                          const RcsGraph* graph)
+{
+  // Step 1: Collect manipulator data
+  for (const auto& m : scene->manipulators)
+  {
+    std::vector<std::string> collectedChildren = m.getChildrenOfManipulator(scene, graph, false);
+    stateJson[m.name]["holdsObject"] = collectedChildren;
+    stateJson[m.name]["isHeldByObject"] = std::vector<std::string>();
+  }
+
+  // Step 2: Collect affordance entity data
+  /*
     "salt_bottle": {
-        "color": "WHITE",
         "euler_xyzr": [ 0.0, 0.0, 0.0 ],
         "fillLevel": 0.5,
         "holdsLiquid": [ "salt" ],
         "holdsObject": [],
         "isHeldByObject": [ "shelf" ],
         "position": [ 0.03, -0.1, 0.971 ],
-        "type": "bottle",
-        "volume": 0.5,
-        "collision_shapes" : [{"type": "BOX",    "position": [0, 0, 1], "euler_xyzr": [1, 2, 3], "extents":  [1, 2, 3]},
-                              {"type": "SPHERE", "position": [0, 0, 1], "euler_xyzr": [1, 2, 3], "extents":  [1, 2, 3]},
-                              {"type": "BOX",    "position": [0, 0, 1], "euler_xyzr": [1, 2, 3], "extents":  [1, 2, 3]},
-                              {"type": "BOX",    "position": [0, 0, 1], "euler_xyzr": [1, 2, 3], "extents":  [1, 2, 3]},
-                              {"type": "BOX",    "position": [0, 0, 1], "euler_xyzr": [1, 2, 3], "extents":  [1, 2, 3]},
-                              {"type": "BOX",    "position": [0, 0, 1], "euler_xyzr": [1, 2, 3], "extents":  [1, 2, 3]},
-                              {"type": "MESH",   "position": [0, 0, 1], "euler_xyzr": [1, 2, 3], "file":  "meshfile.stl"}]
+        "volume": 0.5
     },
-
-    */
-
-    nlohmann::json shapeJson;
-    RCSBODY_TRAVERSE_SHAPES(bdy)
-    {
-      if (!RcsShape_isOfComputeType(SHAPE, RCSSHAPE_COMPUTE_PHYSICS))
-      {
-        continue;
-      }
-
-      HTr A_CI;
-      HTr_transform(&A_CI, &bdy->A_BI, &SHAPE->A_CB);
-      double ea[3];
-      Mat3d_toEulerAngles(ea, bdy->A_BI.rot);
-
-      nlohmann::json j2 =
-      {
-        {"type", RcsShape_name(SHAPE->type)},
-        {"position", std::vector<double>(A_CI.org, A_CI.org+3)},
-        {"euler_xyzr", std::vector<double>(ea, ea+3)},
-        {"extents", std::vector<double>(SHAPE->extents, SHAPE->extents+3)},
-      };
-      shapeJson += j2;
-    }
-    stateJson[e.name]["collision_shapes"] = shapeJson;
-
-
-
-    // std::vector<std::string> collectedChildren = getChildrenOfAffordanceEntity(&e);
-    // stateJson[e.name]["holdsObject"] = collectedChildren;
+  */
+  for (const auto& e : scene->entities)
+  {
+    RcsBody* bdy = RcsGraph_getBodyByName(graph, e.bdyName.c_str());
+    RCHECK(bdy);
 
     // Only direct children, not the whole sub-tree
     stateJson[e.name]["holdsObject"] = std::vector<std::string>();
@@ -165,9 +201,6 @@ void getSceneState(nlohmann::json& stateJson,
       stateJson[e.name]["holdsObject"].push_back(child->name);
     }
 
-
-
-
     const Manipulator* holdingHand = scene->getGraspingHand(graph, &e);
     const AffordanceEntity* holdingObject = scene->getParentAffordanceEntity(graph, &e);
     stateJson[e.name]["isHeldByObject"] = std::vector<std::string>();
@@ -177,7 +210,6 @@ void getSceneState(nlohmann::json& stateJson,
       stateJson[e.name]["isHeldByObject"].push_back(parentName);
     }
 
-
     // Populate the transformation field
     {
       stateJson[e.name]["position"] = std::vector<double>(bdy->A_BI.org, bdy->A_BI.org+3);
@@ -186,19 +218,7 @@ void getSceneState(nlohmann::json& stateJson,
       stateJson[e.name]["euler_xyzr"] = std::vector<double>(ea, ea+3);
     }
 
-
-    /* Here we populate the "holdsLiquid" and volume values
-    "tomato_sauce_bottle": {
-            "type": "bottle",
-            "volume": 0.5,
-            "fillLevel": 0.5,
-            "holdsLiquid": [ "tomato_sauce" ],
-            "isHoldByObject": [
-                "table" <-- Should be held by the table
-            ]
-        },
-     */
-
+    // Here we populate the "holdsLiquid" and volume values
     stateJson[e.name]["holdsLiquid"] = std::vector<std::string>();
     std::vector<Containable*> containables = getAffordances<Containable>(&e);
     double volume = 0.0;
@@ -238,11 +258,6 @@ void getSceneState(nlohmann::json& stateJson,
       }
     }
 
-
-
-
-
-
   }   // for (const auto& e : scene->entities)
 
 
@@ -278,32 +293,31 @@ void getSceneState(nlohmann::json& stateJson,
   }
 
   // TODO (CP) - currently hardcoded
-  // Step 4: Collect lab data
-
   stateJson["table"]["isHeldByObject"].push_back("lab");
+}
 
-  // "lab": {
-  //   "type": "room",
-  //   "holdsObject": ["table"],
-  //   "isHeldByObject" : []
-  // }
+/*******************************************************************************
+ *
+ ******************************************************************************/
+void getSceneState(nlohmann::json& stateJson,
+                   const ActionScene* scene,
+                   const RcsGraph* graph)
+{
+  getStaticSceneState(stateJson, scene, graph, true);
+  getDynamicSceneState(stateJson, scene, graph);
+
+  std::string logStr;
+  for (const auto& m : scene->manipulators)
   {
-    stateJson["lab"]["type"] = "room";
-    stateJson["lab"]["holdsObject"] = std::vector<std::string>({"table", "shelf"});
-    stateJson["lab"]["isHeldByObject"] = std::vector<std::string>();
+    logStr += m.name + "; ";
   }
-  // TODO (CP) - currently hardcoded
-  // Step 4: Collect robot data
 
-  // "robot": {
-  //   "type": "robot",
-  //   "holdsObject": ["gaze","hand_left","hand_right"],
-  //   "isHeldByObject": ["lab"]
-  // }
+  RLOG_CPP(1, "Manipulators: " << logStr);
+  logStr.clear();
+
+  for (const auto& e : scene->entities)
   {
-    stateJson["robot"]["type"] = "robot";
-    stateJson["robot"]["holdsObject"] = std::vector<std::string>({"gaze", "hand_left", "hand_right"});
-    stateJson["robot"]["isHeldByObject"] = std::vector<std::string>({"lab"});
+    logStr += e.name + "; ";
   }
 
   RLOG_CPP(1, "affordance entities: " << logStr);
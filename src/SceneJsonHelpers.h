@@ -41,10 +41,29 @@ namespace aff
 {
 
 
+/*! \brief Full state of the scene as returned by get_state.
+ */
 void getSceneState(nlohmann::json& stateJson,
                    const ActionScene* scene,
                    const RcsGraph* graph);
 
+/*! \brief Parts of the state that don't change without reloading the scene:
+ *         types, colors and collision shapes of the entities, and the lab and
+ *         robot entries. If shapesInWorldFrame is false, the shape poses are
+ *         relative to their entity.
+ */
+void getStaticSceneState(nlohmann::json& stateJson,
+                         const ActionScene* scene,
+                         const RcsGraph* graph,
+                         bool shapesInWorldFrame=false);
+
+/*! \brief Parts of the state that change while acting: poses, held / holds
+ *         relations, liquids and fill levels, closure and gaze.
+ */
+void getDynamicSceneState(nlohmann::json& stateJson,
+                          const ActionScene* scene,
+                          const RcsGraph* graph);
+
 
 
 }   // namespace aff
@@ -0,0 +1,211 @@
+/*******************************************************************************
+
+  Copyright (c) Honda Research Institute Europe GmbH.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+  IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT,
+  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+  OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+#include "SceneStateTracker.h"
+#include "SceneJsonHelpers.h"
+
+#include <Rcs_macros.h>
+
+#include <cmath>
+
+
+namespace aff
+{
+
+SceneStateTracker::SceneStateTracker(double positionTolerance_,
+                                     double angleTolerance_,
+                                     size_t historySize_) :
+  positionTolerance(positionTolerance_), angleTolerance(angleTolerance_),
+  historySize(historySize_ > 0 ? historySize_ : 1), version(0),
+  staticVersion(0)
+{
+}
+
+std::string SceneStateTracker::getState(const ActionScene* scene,
+                                        const RcsGraph* graph,
+                                        size_t knownVersion)
+{
+  nlohmann::json current;
+  getDynamicSceneState(current, scene, graph);
+
+  // Entities, manipulators and bodies that the static part depends on
+  std::string currentStructure = std::to_string(graph->nBodies) + ":";
+  for (const auto& m : scene->manipulators)
+  {
+    currentStructure += m.name + ";";
+  }
+  for (const auto& e : scene->entities)
+  {
+    currentStructure += e.name + "/" + e.bdyName + ";";
+  }
+
+  nlohmann::json res;
+  {
+    std::lock_guard<std::mutex> lock(mtx);
+
+    if (currentStructure != structure)
+    {
+      structure = currentStructure;
+      staticState = nlohmann::json::object();
+      getStaticSceneState(staticState, scene, graph);
+      history.clear();
+      history.emplace_back(++version, current);
+      staticVersion = version;
+      RLOG(1, "Scene structure changed - static state has version %zu", version);
+    }
+    else if (!getChanges(history.back().second, current).empty())
+    {
+      history.emplace_back(++version, current);
+
+      if (history.size() > historySize)
+      {
+        history.pop_front();
+      }
+    }
+
+    const nlohmann::json* base = NULL;
+    for (const auto& h : history)
+    {
+      if (h.first == knownVersion)
+      {
+        base = &h.second;
+        break;
+      }
+    }
+
+    res["version"] = version;
+
+    if ((knownVersion < staticVersion) || (!base))
+    {
+      res["full"] = true;
+      res["static"] = staticState;
+      res["state"] = history.back().second;
+    }
+    else
+    {
+      res["full"] = false;
+      res["baseVersion"] = knownVersion;
+      res["changed"] = getChanges(*base, history.back().second);
+    }
+  }
+
+  return res.dump();
+}
+
+size_t SceneStateTracker::getVersion() const
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  return version;
+}
+
+void SceneStateTracker::reset()
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  structure.clear();
+  staticState.clear();
+  history.clear();
+}
+
+bool SceneStateTracker::fieldChanged(const std::string& field,
+                                     const nlohmann::json& a,
+                                     const nlohmann::json& b) const
+{
+  const bool isPosition = (field == "position");
+  const bool isAngle = (field == "euler_xyzr");
+
+  if ((!isPosition && !isAngle) || !a.is_array() || !b.is_array() ||
+      (a.size() != b.size()))
+  {
+    return a != b;
+  }
+
+  const double tol = isPosition ? positionTolerance : angleTolerance;
+
+  for (size_t i = 0; i < a.size(); ++i)
+  {
+    if (fabs(a[i].get<double>() - b[i].get<double>()) > tol)
+    {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+nlohmann::json SceneStateTracker::getChanges(const nlohmann::json& from,
+                                             const nlohmann::json& to) const
+{
+  nlohmann::json changes = nlohmann::json::object();
+
+  for (auto it = to.begin(); it != to.end(); ++it)
+  {
+    auto prev = from.find(it.key());
+
+    if (prev == from.end())
+    {
+      changes[it.key()] = it.value();
+      continue;
+    }
+
+    for (auto field = it->begin(); field != it->end(); ++field)
+    {
+      auto prevField = prev->find(field.key());
+
+      if ((prevField == prev->end()) ||
+          fieldChanged(field.key(), *prevField, field.value()))
+      {
+        changes[it.key()][field.key()] = field.value();
+      }
+    }
+
+    for (auto field = prev->begin(); field != prev->end(); ++field)
+    {
+      if (!it->contains(field.key()))
+      {
+        changes[it.key()][field.key()] = nullptr;
+      }
+    }
+  }
+
+  for (auto it = from.begin(); it != from.end(); ++it)
+  {
+    if (!to.contains(it.key()))
+    {
+      changes[it.key()] = nullptr;
+    }
+  }
+
+  return changes;
+}
+
+}   // namespace aff
@@ -0,0 +1,114 @@
+/*******************************************************************************
+
+  Copyright (c) Honda Research Institute Europe GmbH.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+  IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT,
+  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+  OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+#ifndef AFF_SCENESTATETRACKER_H
+#define AFF_SCENESTATETRACKER_H
+
+#include "ActionScene.h"
+#include "json.hpp"
+
+#include <deque>
+#include <mutex>
+#include <string>
+
+
+namespace aff
+{
+
+/*! \brief Versioned scene state for clients that poll it frequently. Each
+ *         call of getState() compares the dynamic state (see
+ *         getDynamicSceneState()) with the latest version, and creates a new
+ *         version if anything changed. Positions and Euler angles only count
+ *         as changed if they differ by more than the tolerances.
+ *
+ *         A client passes the last version it knows, and gets only the fields
+ *         that changed since then:
+ *
+ *         {"version": 12, "baseVersion": 9, "full": false,
+ *          "changed": {"salt_bottle": {"position": [...],
+ *                                      "isHeldByObject": ["hand_left"]}}}
+ *
+ *         Fields or entries that no longer exist are null.
+ *
+ *         If the version is 0, too old, or older than the last change of the
+ *         scene's structure (e.g. after a reset with another scene), the
+ *         static part (see getStaticSceneState()) and the full dynamic part
+ *         are returned:
+ *
+ *         {"version": 12, "full": true, "static": {...}, "state": {...}}
+ *
+ *         The collision shapes in the static part are relative to their
+ *         entity, since they don't change with the entity's pose.
+ */
+class SceneStateTracker
+{
+public:
+
+  SceneStateTracker(double positionTolerance=1.0e-3,
+                    double angleTolerance=1.0e-2,
+                    size_t historySize=32);
+
+  /*! \brief Returns the changes since knownVersion as json string.
+   *         Thread-safe.
+   */
+  std::string getState(const ActionScene* scene, const RcsGraph* graph,
+                       size_t knownVersion);
+
+  size_t getVersion() const;
+
+  /*! \brief Forgets all versions, so that the next call returns the full
+   *         state. Version numbers keep increasing.
+   */
+  void reset();
+
+private:
+
+  bool fieldChanged(const std::string& field, const nlohmann::json& a,
+                    const nlohmann::json& b) const;
+  nlohmann::json getChanges(const nlohmann::json& from,
+                            const nlohmann::json& to) const;
+
+  double positionTolerance;
+  double angleTolerance;
+  size_t historySize;
+  size_t version;
+  size_t staticVersion;
+  std::string structure;
+  nlohmann::json staticState;
+  std::deque<std::pair<size_t, nlohmann::json>> history;
+  mutable std::mutex mtx;
+};
+
+}   // namespace aff
+
+#endif // AFF_SCENESTATETRACKER_H
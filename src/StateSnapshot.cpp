@@ -0,0 +1,209 @@
+/*******************************************************************************
+
+  Copyright (c) Honda Research Institute Europe GmbH.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+  IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT,
+  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+  OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+#include "StateSnapshot.h"
+
+#include <Rcs_typedef.h>
+#include <Rcs_macros.h>
+
+#include <chrono>
+
+
+// Number of buffers: One current, one being written, and one for each of
+// up to two readers that hold on to an older snapshot.
+#define NUM_SNAPSHOT_BUFFERS (4)
+
+
+namespace aff
+{
+
+StateSnapshot::StateSnapshot() : graph(NULL), version(0), time(0.0)
+{
+}
+
+StateSnapshot::~StateSnapshot()
+{
+  RcsGraph_destroy(this->graph);
+}
+
+StateSnapshotBuffer::StateSnapshotBuffer() :
+  latest(-1), requested(false), version(0), active(false),
+  loopThread(std::thread::id())
+{
+  for (size_t i = 0; i < NUM_SNAPSHOT_BUFFERS; ++i)
+  {
+    slots.push_back(std::make_shared<Slot>());
+    slots.back()->readers = 0;
+  }
+}
+
+/*******************************************************************************
+ * The reader count is checked with sequentially consistent ordering. A reader
+ * increments it before checking that its slot is still the latest one. Either
+ * we see its pin here, or it sees that we have published another slot and
+ * releases the pin again. We never write into the latest slot.
+ ******************************************************************************/
+bool StateSnapshotBuffer::publish(const RcsGraph* graph,
+                                  const ActionScene& scene,
+                                  double time,
+                                  bool force)
+{
+  if ((!requested.exchange(false)) && (!force))
+  {
+    return false;
+  }
+
+  const int current = latest.load();
+  int idx = -1;
+
+  for (size_t i = 0; i < slots.size(); ++i)
+  {
+    if (((int)i != current) && (slots[i]->readers.load() == 0))
+    {
+      idx = (int)i;
+      break;
+    }
+  }
+
+  if (idx == -1)
+  {
+    RLOG(1, "All %zu snapshot buffers are in use - skipping", slots.size());
+    requested = true;
+    return false;
+  }
+
+  StateSnapshot* snap = &slots[idx]->snapshot;
+
+  // The graph might have been reloaded with a different model
+  if (snap->graph && (snap->graph->nBodies == graph->nBodies) &&
+      (snap->graph->dof == graph->dof))
+  {
+    RcsGraph_copy(snap->graph, graph);
+  }
+  else
+  {
+    RcsGraph_destroy(snap->graph);
+    snap->graph = RcsGraph_clone(graph);
+  }
+
+  snap->scene = scene;
+  snap->time = time;
+  snap->version = version + 1;
+
+  // Publishes the completely written slot to the readers
+  latest.store(idx);
+  version++;
+
+  // Only reached if a reader has requested the snapshot, or if forced
+  std::lock_guard<std::mutex> lock(publishMtx);
+  publishCv.notify_all();
+
+  return true;
+}
+
+std::shared_ptr<const StateSnapshot> StateSnapshotBuffer::get(double timeout) const
+{
+  const size_t prevVersion = version;
+  requested = true;
+
+  if ((!active) || (std::this_thread::get_id() == loopThread.load()))
+  {
+    return getLatest();
+  }
+
+  if (requestCallback)
+  {
+    requestCallback();
+  }
+
+  // The version is changed before publish() takes the mutex, so that we
+  // either see it here, or are waiting when it notifies us.
+  std::unique_lock<std::mutex> lock(publishMtx);
+  publishCv.wait_for(lock, std::chrono::duration<double>(timeout), [&]
+  {
+    return (version != prevVersion) || (!active);
+  });
+  lock.unlock();
+
+  return getLatest();
+}
+
+std::shared_ptr<const StateSnapshot> StateSnapshotBuffer::getLatest() const
+{
+  while (true)
+  {
+    const int idx = latest.load();
+
+    if (idx == -1)
+    {
+      return nullptr;
+    }
+
+    std::shared_ptr<Slot> slot = slots[idx];
+    slot->readers.fetch_add(1);
+
+    if (latest.load() == idx)
+    {
+      return std::shared_ptr<const StateSnapshot>(&slot->snapshot,
+                                                  [slot](const StateSnapshot*)
+      {
+        slot->readers.fetch_sub(1);
+      });
+    }
+
+    // The writer has published another slot in between and might be
+    // writing into this one.
+    slot->readers.fetch_sub(1);
+  }
+}
+
+size_t StateSnapshotBuffer::getVersion() const
+{
+  return version;
+}
+
+void StateSnapshotBuffer::setRequestCallback(std::function<void()> callback)
+{
+  requestCallback = callback;
+}
+
+void StateSnapshotBuffer::setActive(bool active_)
+{
+  loopThread = active_ ? std::this_thread::get_id() : std::thread::id();
+
+  std::lock_guard<std::mutex> lock(publishMtx);
+  active = active_;
+  publishCv.notify_all();
+}
+
+}   // namespace aff
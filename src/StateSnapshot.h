@@ -0,0 +1,154 @@
+/*******************************************************************************
+
+  Copyright (c) Honda Research Institute Europe GmbH.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+  IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT,
+  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+  OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+#ifndef AFF_STATESNAPSHOT_H
+#define AFF_STATESNAPSHOT_H
+
+#include "ActionScene.h"
+
+#include <Rcs_graph.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace aff
+{
+
+/*! \brief Immutable copy of the graph and scene at the end of a control
+ *         loop tick.
+ */
+struct StateSnapshot
+{
+  StateSnapshot();
+  ~StateSnapshot();
+
+  RcsGraph* graph;
+  ActionScene scene;
+  size_t version;
+  double time;
+
+private:
+
+  StateSnapshot(const StateSnapshot&) = delete;
+  StateSnapshot& operator=(const StateSnapshot&) = delete;
+};
+
+/*! \brief Hands snapshots of the control loop state to concurrent readers
+ *         without blocking the loop. The loop calls publish() at the end of
+ *         each tick. It copies the state into a buffer that is neither the
+ *         latest one nor pinned by a reader, and then publishes its index
+ *         with an atomic store. Readers pin the latest buffer by
+ *         incrementing its reader count and checking that it is still the
+ *         latest one. The returned shared pointer releases the pin, so that
+ *         a buffer is never overwritten while being read. If all buffers are
+ *         pinned, publish() skips the tick.
+ *
+ *         Copying the scene is not free, therefore the state is only copied
+ *         if a reader has requested it since the last publish() call. The
+ *         loop never waits for a reader.
+ *
+ *         There must only be one writer at a time, e.g. by calling publish()
+ *         only within the loop's step mutex. The loop marks itself active
+ *         with setActive() while it is stepping. Otherwise, get() does not
+ *         wait for a snapshot that nobody publishes.
+ */
+class StateSnapshotBuffer
+{
+public:
+
+  StateSnapshotBuffer();
+
+  /*! \brief Copies graph and scene into a free buffer and makes it the
+   *         current snapshot, if requested. Returns true if a snapshot has
+   *         been published.
+   */
+  bool publish(const RcsGraph* graph, const ActionScene& scene, double time,
+               bool force=false);
+
+  /*! \brief Requests a snapshot and waits until the next publish() call,
+   *         but not longer than timeout seconds. It does not wait if the
+   *         loop is not active, or if it is called from the loop thread.
+   *         Returns the current snapshot afterwards, which is NULL if
+   *         nothing has been published yet.
+   */
+  std::shared_ptr<const StateSnapshot> get(double timeout=0.1) const;
+
+  /*! \brief Returns the current snapshot without requesting a new one.
+   */
+  std::shared_ptr<const StateSnapshot> getLatest() const;
+
+  size_t getVersion() const;
+
+  /*! \brief Called by get() after a snapshot has been requested, so that
+   *         an idle writer can be woken up. Must be set before concurrent
+   *         readers exist.
+   */
+  void setRequestCallback(std::function<void()> callback);
+
+  /*! \brief Must be called from the loop thread when it starts and stops
+   *         stepping. Waiting readers return when the loop stops.
+   */
+  void setActive(bool active);
+
+private:
+
+  struct Slot
+  {
+    StateSnapshot snapshot;
+    std::atomic<int> readers;
+  };
+
+  // Created in the constructor and never changed, so that readers can index
+  // it concurrently. The reader side keeps a slot alive through its pin.
+  std::vector<std::shared_ptr<Slot>> slots;
+  std::atomic<int> latest;   // Index of the current snapshot, -1 if none
+  mutable std::atomic<bool> requested;
+  std::atomic<size_t> version;
+  std::function<void()> requestCallback;
+  std::atomic<bool> active;
+  std::atomic<std::thread::id> loopThread;
+  mutable std::mutex publishMtx;
+  mutable std::condition_variable publishCv;
+
+  StateSnapshotBuffer(const StateSnapshotBuffer&) = delete;
+  StateSnapshotBuffer& operator=(const StateSnapshotBuffer&) = delete;
+};
+
+}   // namespace aff
+
+#endif // AFF_STATESNAPSHOT_H
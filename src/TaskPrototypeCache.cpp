@@ -0,0 +1,438 @@
+/*******************************************************************************
+
+  Copyright (c) Honda Research Institute Europe GmbH.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+  IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT,
+  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+  OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+#include "TaskPrototypeCache.h"
+
+#include <TaskFactory.h>
+#include <Rcs_typedef.h>
+#include <Rcs_macros.h>
+
+#include <algorithm>
+#include <cstring>
+
+
+// Upper bounds of prototypes per graph model and of graph models. If they are
+// exceeded, the least recently used entries are deleted.
+#define MAX_PROTOTYPES (4096)
+#define MAX_TOPOLOGIES (16)
+
+namespace aff
+{
+
+/*******************************************************************************
+ * TaskDescriptor
+ ******************************************************************************/
+TaskDescriptor::TaskDescriptor(const std::string& name_,
+                               const std::string& controlVariable_,
+                               const std::string& effector_,
+                               const std::string& refBdy_,
+                               const std::string& refFrame_) :
+  name(name_), controlVariable(controlVariable_), effector(effector_),
+  refBdy(refBdy_), refFrame(refFrame_)
+{
+}
+
+TaskDescriptor& TaskDescriptor::set(const std::string& attribute,
+                                    const std::string& value)
+{
+  attributes[attribute] = value;
+  return *this;
+}
+
+TaskDescriptor& TaskDescriptor::addChild(const std::string& xmlChild)
+{
+  children.push_back(xmlChild);
+  return *this;
+}
+
+std::string TaskDescriptor::toXML() const
+{
+  std::string xml = "<Task name=\"" + name + "\" controlVariable=\"" +
+                    controlVariable + "\"";
+
+  if (!effector.empty())
+  {
+    xml += " effector=\"" + effector + "\"";
+  }
+
+  if (!refBdy.empty())
+  {
+    xml += " refBdy=\"" + refBdy + "\"";
+  }
+
+  if (!refFrame.empty())
+  {
+    xml += " refFrame=\"" + refFrame + "\"";
+  }
+
+  // std::map keeps the attributes sorted, so the string is canonical
+  for (const auto& a : attributes)
+  {
+    xml += " " + a.first + "=\"" + a.second + "\"";
+  }
+
+  if (children.empty())
+  {
+    return xml + " />";
+  }
+
+  xml += " >";
+  for (const auto& c : children)
+  {
+    xml += c;
+  }
+
+  return xml + "</Task>";
+}
+
+bool TaskDescriptor::operator==(const TaskDescriptor& other) const
+{
+  return (name == other.name) && (controlVariable == other.controlVariable) &&
+         (effector == other.effector) && (refBdy == other.refBdy) &&
+         (refFrame == other.refFrame) && (attributes == other.attributes) &&
+         (children == other.children);
+}
+
+/*******************************************************************************
+ * FNV-1a
+ ******************************************************************************/
+static void hashBytes(uint64_t& hash, const void* data, size_t len)
+{
+  const unsigned char* bytes = (const unsigned char*) data;
+
+  for (size_t i = 0; i < len; ++i)
+  {
+    hash ^= bytes[i];
+    hash *= 1099511628211ULL;
+  }
+}
+
+// The terminating byte separates consecutive strings
+static void hashString(uint64_t& hash, const std::string& str)
+{
+  hashBytes(hash, str.data(), str.size());
+  hash ^= 0xff;
+  hash *= 1099511628211ULL;
+}
+
+size_t TaskDescriptor::Hash::operator()(const TaskDescriptor& desc) const
+{
+  uint64_t hash = 14695981039346656037ULL;
+  hashString(hash, desc.name);
+  hashString(hash, desc.controlVariable);
+  hashString(hash, desc.effector);
+  hashString(hash, desc.refBdy);
+  hashString(hash, desc.refFrame);
+
+  for (const auto& a : desc.attributes)
+  {
+    hashString(hash, a.first);
+    hashString(hash, a.second);
+  }
+
+  for (const auto& c : desc.children)
+  {
+    hashString(hash, c);
+  }
+
+  return hash;
+}
+
+/*******************************************************************************
+ * TaskPrototypeCache
+ ******************************************************************************/
+std::mutex TaskPrototypeCache::mtx;
+std::unordered_map<uint64_t, std::unique_ptr<TaskPrototypeCache::Topology>> TaskPrototypeCache::topologies;
+uint64_t TaskPrototypeCache::useCount = 0;
+size_t TaskPrototypeCache::numHits = 0;
+size_t TaskPrototypeCache::numMisses = 0;
+
+TaskPrototypeCache::Topology::Topology(const RcsGraph* graph_) :
+  graph(RcsGraph_clone(graph_)), lastUsed(0)
+{
+}
+
+TaskPrototypeCache::Topology::~Topology()
+{
+  // The prototypes refer to the graph and must be deleted first
+  xmlPrototypes.clear();
+  descPrototypes.clear();
+  RcsGraph_destroy(graph);
+}
+
+/*******************************************************************************
+ * Deletes the least recently used half of the entries. Removing half of them
+ * amortizes the linear selection over many insertions.
+ ******************************************************************************/
+template <typename Map>
+static void evictLeastRecentlyUsed(Map& entries)
+{
+  std::vector<uint64_t> stamps;
+  stamps.reserve(entries.size());
+
+  for (const auto& e : entries)
+  {
+    stamps.push_back(e.second.lastUsed);
+  }
+
+  auto median = stamps.begin() + stamps.size()/2;
+  std::nth_element(stamps.begin(), median, stamps.end());
+  const uint64_t threshold = *median;
+
+  for (auto it = entries.begin(); it != entries.end();)
+  {
+    it = (it->second.lastUsed < threshold) ? entries.erase(it) : std::next(it);
+  }
+}
+
+template <typename Map>
+static void evictLeastRecentlyUsedTopology(Map& topologies)
+{
+  auto oldest = topologies.begin();
+
+  for (auto it = topologies.begin(); it != topologies.end(); ++it)
+  {
+    if (it->second->lastUsed < oldest->second->lastUsed)
+    {
+      oldest = it;
+    }
+  }
+
+  topologies.erase(oldest);
+}
+
+/*******************************************************************************
+ * Graphs with the same hash have the same body and joint ids, so that tasks
+ * can be cloned between them. The names only change with the graph, so their
+ * hash is remembered for the last graph of each thread. The joint types and
+ * limits are read by the task constructors. They are cheap to hash and are
+ * therefore checked on each call, since they might be modified in place.
+ ******************************************************************************/
+uint64_t TaskPrototypeCache::modelHash(const RcsGraph* graph)
+{
+  thread_local const RcsGraph* lastGraph = NULL;
+  thread_local const RcsBody* lastBodies = NULL;
+  thread_local const RcsJoint* lastJoints = NULL;
+  thread_local unsigned int lastNBodies = 0;
+  thread_local unsigned int lastDof = 0;
+  thread_local uint64_t nameHash = 0;
+
+  if ((graph != lastGraph) || (graph->bodies != lastBodies) ||
+      (graph->joints != lastJoints) || (graph->nBodies != lastNBodies) ||
+      (graph->dof != lastDof))
+  {
+    nameHash = 14695981039346656037ULL;
+    hashBytes(nameHash, &graph->nBodies, sizeof(graph->nBodies));
+    hashBytes(nameHash, &graph->dof, sizeof(graph->dof));
+
+    RCSGRAPH_FOREACH_BODY(graph)
+    {
+      hashString(nameHash, BODY->name);
+    }
+
+    RCSGRAPH_FOREACH_JOINT(graph)
+    {
+      hashString(nameHash, JNT->name);
+    }
+
+    lastGraph = graph;
+    lastBodies = graph->bodies;
+    lastJoints = graph->joints;
+    lastNBodies = graph->nBodies;
+    lastDof = graph->dof;
+  }
+
+  uint64_t hash = nameHash;
+
+  RCSGRAPH_FOREACH_JOINT(graph)
+  {
+    hashBytes(hash, &JNT->type, sizeof(JNT->type));
+    hashBytes(hash, &JNT->q_min, sizeof(JNT->q_min));
+    hashBytes(hash, &JNT->q_max, sizeof(JNT->q_max));
+    hashBytes(hash, &JNT->q0, sizeof(JNT->q0));
+  }
+
+  return hash;
+}
+
+// Must be called with the mutex locked
+TaskPrototypeCache::Topology* TaskPrototypeCache::getTopology(const RcsGraph* graph)
+{
+  const uint64_t key = modelHash(graph);
+  auto it = topologies.find(key);
+
+  if (it == topologies.end())
+  {
+    if (topologies.size() >= MAX_TOPOLOGIES)
+    {
+      evictLeastRecentlyUsedTopology(topologies);
+    }
+
+    it = topologies.emplace(key, std::unique_ptr<Topology>(new Topology(graph))).first;
+  }
+
+  it->second->lastUsed = ++useCount;
+
+  return it->second.get();
+}
+
+// Must be called with the mutex locked
+template <typename Key, typename Map, typename XmlFunc>
+Rcs::Task* TaskPrototypeCache::createTask(Topology* topology, Map& prototypes,
+                                          const Key& key, XmlFunc toXML,
+                                          const RcsGraph* graph)
+{
+  auto it = prototypes.find(key);
+
+  if (it == prototypes.end())
+  {
+    const std::string xmlTask = toXML(key);
+    Rcs::Task* task = Rcs::TaskFactory::createTask(xmlTask, topology->graph);
+
+    if (!task)
+    {
+      RLOG_CPP(1, "Failed to create task from " << xmlTask);
+      return NULL;
+    }
+
+    if (prototypes.size() >= MAX_PROTOTYPES)
+    {
+      evictLeastRecentlyUsed(prototypes);
+    }
+
+    numMisses++;
+    Prototype prototype;
+    prototype.task.reset(task);
+    it = prototypes.emplace(key, std::move(prototype)).first;
+  }
+  else
+  {
+    numHits++;
+  }
+
+  it->second.lastUsed = ++useCount;
+
+  return it->second.task->clone(const_cast<RcsGraph*>(graph));
+}
+
+Rcs::Task* TaskPrototypeCache::createTask(const std::string& xmlTask,
+                                          const RcsGraph* graph)
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  Topology* topology = getTopology(graph);
+
+  return createTask(topology, topology->xmlPrototypes, xmlTask,
+                    [](const std::string& xml)
+  {
+    return xml;
+  }, graph);
+}
+
+std::vector<Rcs::Task*> TaskPrototypeCache::createTasks(const std::vector<std::string>& xmlTasks,
+                                                        const RcsGraph* graph)
+{
+  std::vector<Rcs::Task*> tasks;
+  std::lock_guard<std::mutex> lock(mtx);
+  Topology* topology = getTopology(graph);
+
+  for (const auto& xmlTask : xmlTasks)
+  {
+    Rcs::Task* task = createTask(topology, topology->xmlPrototypes, xmlTask,
+                                 [](const std::string& xml)
+    {
+      return xml;
+    }, graph);
+
+    if (!task)
+    {
+      for (auto t : tasks)
+      {
+        delete t;
+      }
+      return std::vector<Rcs::Task*>();
+    }
+
+    tasks.push_back(task);
+  }
+
+  return tasks;
+}
+
+std::vector<Rcs::Task*> TaskPrototypeCache::createTasks(const std::vector<TaskDescriptor>& descriptors,
+                                                        const RcsGraph* graph)
+{
+  std::vector<Rcs::Task*> tasks;
+  std::lock_guard<std::mutex> lock(mtx);
+  Topology* topology = getTopology(graph);
+
+  for (const auto& desc : descriptors)
+  {
+    Rcs::Task* task = createTask(topology, topology->descPrototypes, desc,
+                                 [](const TaskDescriptor& d)
+    {
+      return d.toXML();
+    }, graph);
+
+    if (!task)
+    {
+      for (auto t : tasks)
+      {
+        delete t;
+      }
+      return std::vector<Rcs::Task*>();
+    }
+
+    tasks.push_back(task);
+  }
+
+  return tasks;
+}
+
+void TaskPrototypeCache::clear()
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  topologies.clear();
+}
+
+size_t TaskPrototypeCache::getNumHits()
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  return numHits;
+}
+
+size_t TaskPrototypeCache::getNumMisses()
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  return numMisses;
+}
+
+} // namespace aff
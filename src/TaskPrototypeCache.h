@@ -0,0 +1,150 @@
+/*******************************************************************************
+
+  Copyright (c) Honda Research Institute Europe GmbH.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+  IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT,
+  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+  OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+#ifndef AFF_TASKPROTOTYPECACHE_H
+#define AFF_TASKPROTOTYPECACHE_H
+
+#include <Task.h>
+
+#include <vector>
+#include <string>
+#include <map>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+
+namespace aff
+{
+
+/*! \brief Typed description of an IK task. It replaces the manual
+ *         concatenation of xml strings in the actions' createTasksXML()
+ *         methods. The xml string returned by toXML() is canonical: the same
+ *         description always leads to the same string, so that it can be
+ *         used as key for the TaskPrototypeCache.
+ */
+struct TaskDescriptor
+{
+  TaskDescriptor(const std::string& name, const std::string& controlVariable,
+                 const std::string& effector=std::string(),
+                 const std::string& refBdy=std::string(),
+                 const std::string& refFrame=std::string());
+
+  TaskDescriptor& set(const std::string& attribute, const std::string& value);
+  TaskDescriptor& addChild(const std::string& xmlChild);
+  std::string toXML() const;
+  bool operator==(const TaskDescriptor& other) const;
+
+  struct Hash
+  {
+    size_t operator()(const TaskDescriptor& desc) const;
+  };
+
+  std::string name;
+  std::string controlVariable;
+  std::string effector;
+  std::string refBdy;
+  std::string refFrame;
+  std::map<std::string, std::string> attributes;   // e.g. axisDirection, jnts
+  std::vector<std::string> children;               // e.g. TaskRegion
+};
+
+/*! \brief Cache of parsed tasks. Each task description is parsed only once
+ *         per graph model into a prototype. Subsequent requests for the same
+ *         description are served by cloning the prototype into the requested
+ *         graph. Descriptors are used as keys directly, xml strings for the
+ *         actions that still create them. The graph model is identified by
+ *         the body and joint names, which are hashed once per graph, and by
+ *         the joint types and limits, which the tasks read when being
+ *         parsed. The prototypes are parsed against a private copy of the
+ *         first graph of a model, so that they don't depend on the lifetime
+ *         of the caller's graph. If a model has more than a maximum number
+ *         of prototypes, the least recently used half is deleted. All methods
+ *         are thread-safe.
+ */
+class TaskPrototypeCache
+{
+public:
+
+  /*! \brief Drop-in replacement for Rcs::TaskFactory::createTasks(). Returns
+   *         an empty vector if any of the tasks can't be created.
+   */
+  static std::vector<Rcs::Task*> createTasks(const std::vector<std::string>& xmlTasks,
+                                             const RcsGraph* graph);
+
+  static std::vector<Rcs::Task*> createTasks(const std::vector<TaskDescriptor>& tasks,
+                                             const RcsGraph* graph);
+
+  /*! \brief Returns NULL if the task can't be created.
+   */
+  static Rcs::Task* createTask(const std::string& xmlTask, const RcsGraph* graph);
+
+  static void clear();
+  static size_t getNumHits();
+  static size_t getNumMisses();
+
+private:
+
+  struct Prototype
+  {
+    std::unique_ptr<Rcs::Task> task;
+    uint64_t lastUsed;
+  };
+
+  struct Topology
+  {
+    Topology(const RcsGraph* graph);
+    ~Topology();
+
+    RcsGraph* graph;   // Private copy the prototypes refer to
+    uint64_t lastUsed;
+    std::unordered_map<std::string, Prototype> xmlPrototypes;
+    std::unordered_map<TaskDescriptor, Prototype, TaskDescriptor::Hash> descPrototypes;
+  };
+
+  template <typename Key, typename Map, typename XmlFunc>
+  static Rcs::Task* createTask(Topology* topology, Map& prototypes,
+                               const Key& key, XmlFunc toXML,
+                               const RcsGraph* graph);
+  static Topology* getTopology(const RcsGraph* graph);
+  static uint64_t modelHash(const RcsGraph* graph);
+
+  static std::mutex mtx;
+  static std::unordered_map<uint64_t, std::unique_ptr<Topology>> topologies;
+  static uint64_t useCount;
+  static size_t numHits;
+  static size_t numMisses;
+};
+
+} // namespace aff
+
+#endif // AFF_TASKPROTOTYPECACHE_H
@@ -32,8 +32,9 @@
 *******************************************************************************/
 
 #include "TrajectoryComponent.h"
+#include "TaskPrototypeCache.h"
+#include "BodyIndexCache.h"
 
-#include <TaskFactory.h>
 #include <Rcs_typedef.h>
 #include <Rcs_utils.h>
 #include <Rcs_body.h>
@@ -42,6 +43,7 @@
 #include <Rcs_timer.h>
 #include <Rcs_macros.h>
 
+#include <algorithm>
 #include <thread>
 #include <mutex>
 
@@ -58,10 +60,20 @@ TrajectoryComponent::TrajectoryComponent(EntityBase* parent,
                                          double horizon,
                                          bool checkTrajectory_) :
   ComponentBase(parent), tc(NULL), motionEndTime(0.0),
-  lastMotionEndTime(0.0), motionDuration(0.0), a_des(NULL), x_des(NULL),
+  lastMotionEndTime(0.0), motionDuration(0.0), overlapTime(0.0),
+  a_des(NULL), x_des(NULL),
   tPred(NULL), animationGraph(NULL), animationTic(0),
   enableTrajectoryCheck(checkTrajectory_), enableDbgRendering(true),
-  eStop(false)
+  eStop(false),
+  stringCompares(0), lastStringCompares(0),
+  trajectoryId(0),
+  revalidationRunning(false),
+  revalidationPeriod(0.0),
+  lastRevalidation(0.0),
+  stopOnRevalidationFailure(true),
+  numRevalidations(0),
+  revalidationTime(0.0),
+  revalidationStartTime(0.0)
 {
   this->a_des = MatNd_create((int) controller->getNumberOfTasks(), 1);
   this->x_des = MatNd_create((int) controller->getTaskDim(), 1);
@@ -69,6 +81,10 @@ TrajectoryComponent::TrajectoryComponent(EntityBase* parent,
 
   this->animationGraph = RcsGraph_clone(controller->getGraph());
 
+  // Published in each step, therefore not looked up by name each time
+  setBlendingEvent = getEntity()->getEventHandle<double>("SetBlending");
+  setPhaseEvent = getEntity()->getEventHandle<double>("SetPhase");
+
   if (via)
   {
     tc = new TrajectoryController<ViaPointTrajectory1D>(controller, horizon);
@@ -107,9 +123,10 @@ TrajectoryComponent::TrajectoryComponent(EntityBase* parent,
   subscribe("SimulateTrajectory", &TrajectoryComponent::onSimulateTrajectory);
   subscribe("SetDebugRendering", &TrajectoryComponent::enableDebugRendering);
   subscribe("SetTrajectoryCheck", &TrajectoryComponent::onEnableTrajectoryCheck);
-  subscribe("ChangeTaskVector", &TrajectoryComponent::onTaskVectorChangeSequential);
+  subscribe("ChangeTaskVector", &TrajectoryComponent::onTaskVectorChange);
   subscribe("Print", &TrajectoryComponent::onPrint);
   subscribe("ToggleFastPrediction", &TrajectoryComponent::onResetAnimationTic);
+  subscribe("SetTrajectoryRevalidation", &TrajectoryComponent::onSetRevalidationPeriod);
 
   if (enableTrajectoryCheck)
   {
@@ -131,6 +148,9 @@ TrajectoryComponent::~TrajectoryComponent()
 
 void TrajectoryComponent::stepTrajectory(RcsGraph* from)
 {
+  const size_t nCompares = BodyIndexCache::getStringCompares();
+  this->stringCompares = nCompares - lastStringCompares;
+  this->lastStringCompares = nCompares;
   this->lastMotionEndTime = motionEndTime;
   this->motionEndTime = tc->step(getEntity()->getDt());
 
@@ -153,6 +173,12 @@ void TrajectoryComponent::stepTrajectory(RcsGraph* from)
     getEntity()->publish("TrajectoryMoving", true);
   }
 
+  if ((overlapTime > 0.0) && (motionEndTime > 0.0) &&
+      (lastMotionEndTime > overlapTime) && (motionEndTime <= overlapTime))
+  {
+    getEntity()->publish("TrajectoryOverlap", motionEndTime);
+  }
+
   double blending = tc->computeBlending();
 
   // We disallow null space movements if there is no active task. This avoids null space
@@ -161,14 +187,23 @@ void TrajectoryComponent::stepTrajectory(RcsGraph* from)
   {
     blending = 0.0;
   }
-  getEntity()->publish("SetBlending", blending);
-  getEntity()->publish("SetPhase", phaseScale);
+  setBlendingEvent->publish(blending);
+  setPhaseEvent->publish(phaseScale);
+
+  if ((revalidationPeriod > 0.0) && (motionEndTime > 0.0) && (!eStop) && from &&
+      (getEntity()->getTime() - lastRevalidation >= revalidationPeriod))
+  {
+    startRevalidation(from);
+  }
 }
 
 void TrajectoryComponent::onClearTrajectory()
 {
   RLOG(0, "TrajectoryComponent::clearTrajectory()");
   tc->clear(true);
+  trajectoryId++;
+  pendingTaskVector.reset();
+  blendedTaskVectors.clear();
 }
 
 const MatNd* TrajectoryComponent::getActivationPtr() const
@@ -185,6 +220,7 @@ void TrajectoryComponent::onEmergencyStop()
 {
   RLOG(0, "TrajectoryComponent::EmergencyStop");
   tc->clear();
+  trajectoryId++;
   this->eStop = true;
   getEntity()->publish("ClearTrajectory");
   getEntity()->publish("ActionResult", false, 0.0, std::string("FATAL_ERROR REASON: Emergency stop triggered"));
@@ -209,6 +245,7 @@ void TrajectoryComponent::onInitFromState(const RcsGraph* target)
   tc->getController()->computeX(this->x_des);
   tc->clear();
   tc->init();
+  trajectoryId++;
 
   renderMtx.lock();
   enableDebugRendering(false);
@@ -237,8 +274,17 @@ void TrajectoryComponent::onSetTrajectory(TCS_sptr tSet)
     tc->getController()->toXML("onSetController.xml");
   }
 
+  auto blended = blendedTaskVectors.find(tSet.get());
+  if (blended != blendedTaskVectors.end())
+  {
+    RLOG(0, "Blending task vector into moving trajectory");
+    onTaskVectorChangeParallel(blended->second.taskVec, blended->second.channels);
+    blendedTaskVectors.erase(blended);
+  }
+
   RLOG(0, "Applying trajectory");
   tc->addAndApply(tSet);
+  trajectoryId++;
 
   motionDuration = tSet->getDuration();
 }
@@ -286,6 +332,18 @@ void TrajectoryComponent::onCheckAndSetTrajectory(TCS_sptr tSet)
 {
   double t_calc = Timer_getSystemTime();
 
+  // A deferred task vector belongs to this trajectory. It is applied in
+  // onSetTrajectory() if the trajectory passes the check.
+  if (pendingTaskVector)
+  {
+    blendedTaskVectors[tSet.get()] = *pendingTaskVector;
+    pendingTaskVector.reset();
+  }
+  else
+  {
+    blendedTaskVectors.erase(tSet.get());
+  }
+
   // If an emergendy stop has been detected, or checking has been disabled,
   // we ignore incoming trajectories and return.
   if (this->eStop==true)
@@ -316,10 +374,26 @@ void TrajectoryComponent::onCheckAndSetTrajectory(TCS_sptr tSet)
   //        is provided with a separate graph (e.g. instantiated during
   //        construction) that will only be linked. However, this requires
   //        touching the ControllerBase and TrajectoryController classes.
-  std::shared_ptr<TrajectoryPredictor> pred = std::make_shared<TrajectoryPredictor>(tc);
+  std::shared_ptr<TrajectoryPredictor> pred;
+  auto blended = blendedTaskVectors.find(tSet.get());
 
-  // Clears the predictor's trajectories and copies tSet
-  pred->setTrajectory(tSet);
+  // Clears the predictor's trajectories and copies tSet. If the trajectory is
+  // blended into a moving one, it is checked together with its remainder. The
+  // task replacement is applied to a copy of the controller only.
+  if (blended != blendedTaskVectors.end())
+  {
+    TrajectoryControllerBase blendedTc(*tc);
+    auto taskMap = effectorTaskMap;
+    replaceChannelTasks(&blendedTc, taskMap, blended->second.taskVec,
+                        blended->second.channels);
+    pred = std::make_shared<TrajectoryPredictor>(&blendedTc);
+    pred->addTrajectory(tSet);
+  }
+  else
+  {
+    pred = std::make_shared<TrajectoryPredictor>(tc);
+    pred->setTrajectory(tSet);
+  }
 
   // Commenting out the below line runs the checking within the event loop.
   // This breaks the real-time constraints and should only be done for testing
@@ -411,14 +485,114 @@ void TrajectoryComponent::enableDebugRendering(bool enable)
 
 void TrajectoryComponent::onStop()
 {
-  // Wait until the checkerThread has finished
+  // Wait until the checkerThread and revalidationThread have finished
   std::lock_guard<std::mutex> lock(checkerThreadMtx);
+  std::lock_guard<std::mutex> lock2(revalidationMtx);
   enableDebugRendering(false);
 }
 
+void TrajectoryComponent::setRevalidation(double period, bool stopOnFailure)
+{
+  RLOG(0, "Trajectory re-validation %s (period: %.3f sec)",
+       period > 0.0 ? "enabled" : "disabled", period);
+  this->revalidationPeriod = period;
+  this->stopOnRevalidationFailure = stopOnFailure;
+  this->lastRevalidation = 0.0;
+  this->numRevalidations = 0;
+  this->revalidationTime = 0.0;
+  this->revalidationStartTime = Timer_getSystemTime();
+}
+
+void TrajectoryComponent::onSetRevalidationPeriod(double period)
+{
+  setRevalidation(period, stopOnRevalidationFailure);
+}
+
+double TrajectoryComponent::getRevalidationLoad() const
+{
+  const double elapsed = Timer_getSystemTime() - revalidationStartTime;
+  return (elapsed > 0.0) ? revalidationTime / elapsed : 0.0;
+}
+
+/*******************************************************************************
+ * Clones the TrajectoryController including the remaining trajectory within
+ * the event loop, like in onCheckAndSetTrajectory(). The state is taken from
+ * the passed graph, which contains the latest perception updates. The
+ * prediction itself runs concurrently. If the previous re-validation has not
+ * yet finished, we skip and try again in the next step. A graph with
+ * different dof is not cloned, and checked again after the next period.
+ ******************************************************************************/
+void TrajectoryComponent::startRevalidation(const RcsGraph* state)
+{
+  if (revalidationRunning)
+  {
+    return;
+  }
+
+  // Wait for the next period, not for the next step, if it doesn't match
+  this->lastRevalidation = getEntity()->getTime();
+  const unsigned int dof = tc->getInternalController()->getGraph()->dof;
+
+  if (dof != state->dof)
+  {
+    RLOG(1, "Can't re-validate: Graph has %u dof, expected %u",
+         state->dof, dof);
+    return;
+  }
+
+  double t_calc = Timer_getSystemTime();
+  std::shared_ptr<TrajectoryPredictor> pred = std::make_shared<TrajectoryPredictor>(tc);
+  RcsGraph* predGraph = pred->tc->getInternalController()->getGraph();
+  RcsGraph_setState(predGraph, state->q, state->q_dot);
+  this->revalidationTime = revalidationTime + (Timer_getSystemTime() - t_calc);
+  this->revalidationRunning = true;
+
+  std::thread t1(&TrajectoryComponent::revalidationThread, this, pred,
+                 trajectoryId.load());
+  t1.detach();
+}
+
+void TrajectoryComponent::revalidationThread(std::shared_ptr<TrajectoryPredictor> predictor,
+                                             size_t predictedTrajectoryId)
+{
+  std::lock_guard<std::mutex> lock(revalidationMtx);
+
+  double t_calc = Timer_getSystemTime();
+  auto result = predictor->predict(getEntity()->getDt());
+  t_calc = Timer_getSystemTime() - t_calc;
+
+  this->revalidationTime = revalidationTime + t_calc;
+  this->numRevalidations++;
+  RLOG(1, "Re-validation %zu took %.1f msec (load: %.1f%%): %s",
+       numRevalidations.load(), t_calc*1.0e3, 100.0*getRevalidationLoad(),
+       result.success ? "valid" : result.message.c_str());
+
+  // A new trajectory might have been applied in the meantime. The result
+  // doesn't refer to it, and it has been checked before being applied.
+  if ((!result.success) && (predictedTrajectoryId == trajectoryId))
+  {
+    getEntity()->publish("TrajectoryWarning", result.message);
+
+    if (stopOnRevalidationFailure)
+    {
+      getEntity()->publish("ClearTrajectory");
+      getEntity()->publish("ActionResult", false, 0.0,
+                           "ERROR REASON: The executed motion became invalid "
+                           "SUGGESTION: Re-plan the action DEVELOPER: " +
+                           result.message);
+    }
+  }
+
+  this->revalidationRunning = false;
+}
+
 void TrajectoryComponent::onRender()
 {
-  renderMtx.lock();
+  // Skip this frame instead of waiting for the checker thread
+  if (!renderMtx.try_lock())
+  {
+    return;
+  }
 
   if ((this->tPred==NULL) || (this->enableDbgRendering==false))
   {
@@ -468,6 +642,43 @@ const TrajectoryControllerBase* TrajectoryComponent::getTrajectoryController() c
   return this->tc;
 }
 
+size_t TrajectoryComponent::getStringComparesPerStep() const
+{
+  return this->stringCompares;
+}
+
+void TrajectoryComponent::setOverlapTime(double overlapTime_)
+{
+  this->overlapTime = overlapTime_;
+}
+
+bool TrajectoryComponent::isBlending() const
+{
+  return (overlapTime > 0.0) && (motionEndTime > 0.0);
+}
+
+/*******************************************************************************
+ * While a motion is blended into the moving one, only the tasks of the
+ * incoming channels are replaced. This is deferred until the trajectory that
+ * follows the task vector has passed the check, so that a rejected one
+ * doesn't remove the tasks of the moving trajectory. Otherwise, all tasks are
+ * replaced.
+ ******************************************************************************/
+void TrajectoryComponent::onTaskVectorChange(std::vector<std::string> taskVec,
+                                             std::vector<std::string> channels)
+{
+  if (isBlending())
+  {
+    RLOG(0, "Deferring task vector to be blended into moving trajectory");
+    pendingTaskVector.reset(new TaskVectorChange{taskVec, channels});
+    return;
+  }
+
+  pendingTaskVector.reset();
+  blendedTaskVectors.clear();
+  onTaskVectorChangeSequential(taskVec, channels);
+}
+
 /*******************************************************************************
  * The array channels contains the effectors that the tasks are utilizing. We
  * maintain a map (effectorTaskMap) with keys being the effctors, and values
@@ -479,7 +690,7 @@ const TrajectoryControllerBase* TrajectoryComponent::getTrajectoryController() c
 void TrajectoryComponent::onTaskVectorChangeSequential(std::vector<std::string> taskVec,
                                                        std::vector<std::string> channels)
 {
-  std::vector<Rcs::Task*> tasks = Rcs::TaskFactory::createTasks(taskVec, tc->getInternalController()->getGraph());
+  std::vector<Rcs::Task*> tasks = TaskPrototypeCache::createTasks(taskVec, tc->getInternalController()->getGraph());
 
   if (tasks.empty())
   {
@@ -491,10 +702,17 @@ void TrajectoryComponent::onTaskVectorChangeSequential(std::vector<std::string>
 
   // Here we should delete only the tasks that are in out channels
   tc->getInternalController()->eraseTasks();
+  effectorTaskMap.clear();
 
   for (auto t : tasks)
   {
     tc->getInternalController()->add(t);
+
+    // Needed if a later task vector is blended in
+    for (const auto& chi : getTaskChannels(t, channels))
+    {
+      effectorTaskMap[chi].push_back(t->getName());
+    }
   }
 
 
@@ -523,6 +741,22 @@ void TrajectoryComponent::onTaskVectorChangeSequential(std::vector<std::string>
 
 void TrajectoryComponent::onTaskVectorChangeParallel(std::vector<std::string> taskVec,
                                                      std::vector<std::string> channels)
+{
+  if (!replaceChannelTasks(tc, effectorTaskMap, taskVec, channels))
+  {
+    return;
+  }
+
+  MatNd_realloc(a_des, tc->getInternalController()->getNumberOfTasks(), 1);
+  MatNd_realloc(x_des, tc->getInternalController()->getTaskDim(), 1);
+
+  RLOG(0, "Done task replacement");
+}
+
+bool TrajectoryComponent::replaceChannelTasks(TrajectoryControllerBase* tc,
+                                              std::map<std::string, std::vector<std::string>>& effectorTaskMap,
+                                              const std::vector<std::string>& taskVec,
+                                              const std::vector<std::string>& channels)
 {
   RLOG_CPP(0, "Changing task vector: " << channels.size() << " manipulators");
 
@@ -532,11 +766,11 @@ void TrajectoryComponent::onTaskVectorChangeParallel(std::vector<std::string> ta
   }
 
   const RcsGraph* tcGraph = tc->getInternalController()->getGraph();
-  std::vector<Rcs::Task*> tasks = Rcs::TaskFactory::createTasks(taskVec, tcGraph);
+  std::vector<Rcs::Task*> tasks = TaskPrototypeCache::createTasks(taskVec, tcGraph);
 
   if (tasks.empty())
   {
-    return;
+    return false;
   }
 
   // From this point on, the vector tasks contains valid tasks for the given
@@ -546,46 +780,54 @@ void TrajectoryComponent::onTaskVectorChangeParallel(std::vector<std::string> ta
   {
     auto effectorTaskVecPair = effectorTaskMap.find(channelName_i);
 
-    if (effectorTaskVecPair != effectorTaskMap.end())
+    if (effectorTaskVecPair == effectorTaskMap.end())
     {
-      for (auto& taskNameToDelete : effectorTaskVecPair->second)
-      {
-
-        // bool exists = false;
-        // for (auto tsk_i : tasks)
-        // {
-        //   RLOG_CPP(0, "Comparing " << taskNameToDelete << " - " << tsk_i->getName());
-        //   if (taskNameToDelete==tsk_i->getName())
-        //   {
-        //     exists = true;
-        //   }
-        // }
-
-        // if (exists)
-        // {
-        //   continue;
-        // }
-
-        // The trajectory must me deleted before the task, otherwise the
-        // task index (used for retrieving the trajectory index) is not
-        // valid any more.
-        bool ok2 = tc->eraseTrajectory(taskNameToDelete);
-        bool ok1 = tc->getInternalController()->eraseTask(taskNameToDelete);
-        RLOG_CPP(0, "Clearing task '" << taskNameToDelete << "' from channel '"
-                 << channelName_i << "': " << ok1 << ok2);
-      }
-
-      effectorTaskVecPair->second.clear();
+      continue;
     }
 
-  }
+    // Copy, since the task names are also removed from the list of this channel
+    const std::vector<std::string> tasksToDelete = effectorTaskVecPair->second;
 
+    for (const auto& taskNameToDelete : tasksToDelete)
+    {
 
+      // bool exists = false;
+      // for (auto tsk_i : tasks)
+      // {
+      //   RLOG_CPP(0, "Comparing " << taskNameToDelete << " - " << tsk_i->getName());
+      //   if (taskNameToDelete==tsk_i->getName())
+      //   {
+      //     exists = true;
+      //   }
+      // }
+
+      // if (exists)
+      // {
+      //   continue;
+      // }
+
+      // The trajectory must me deleted before the task, otherwise the
+      // task index (used for retrieving the trajectory index) is not
+      // valid any more.
+      bool ok2 = tc->eraseTrajectory(taskNameToDelete);
+      bool ok1 = tc->getInternalController()->eraseTask(taskNameToDelete);
+      RLOG_CPP(0, "Clearing task '" << taskNameToDelete << "' from channel '"
+               << channelName_i << "': " << ok1 << ok2);
+
+      // A task shared with other channels is gone for them as well
+      for (auto& entry : effectorTaskMap)
+      {
+        auto& names = entry.second;
+        names.erase(std::remove(names.begin(), names.end(), taskNameToDelete),
+                    names.end());
+      }
+    }
+  }
 
   // Update the effector - task map with the newly incoming effectors
   for (const auto& tsk : tasks)
   {
-    for (const auto& chi : channels)
+    for (const auto& chi : getTaskChannels(tsk, channels))
     {
       effectorTaskMap[chi].push_back(tsk->getName());
     }
@@ -602,15 +844,57 @@ void TrajectoryComponent::onTaskVectorChangeParallel(std::vector<std::string> ta
 
   // onPrint();
 
+  return true;
+}
 
-  // From here on, all tasks are valid.
-  // tc->eraseTrajectories();
-  // tc->populateTrajectories(1.0);// \todo: horizon?
+/*******************************************************************************
+ * A task belongs to the channels whose body is its effector, reference body
+ * or reference frame, or a parent of them. Tasks that don't refer to any of
+ * the channels (e.g. joint tasks) belong to all of them.
+ ******************************************************************************/
+std::vector<std::string> TrajectoryComponent::getTaskChannels(const Rcs::Task* task,
+                                                              const std::vector<std::string>& channels)
+{
+  const RcsGraph* graph = task->getGraph();
+  const RcsBody* frames[3] = { task->getEffector(), task->getRefBody(),
+                               task->getRefFrame()
+                             };
+  std::vector<std::string> taskChannels;
 
-  MatNd_realloc(a_des, tc->getInternalController()->getNumberOfTasks(), 1);
-  MatNd_realloc(x_des, tc->getInternalController()->getTaskDim(), 1);
+  for (const auto& ch : channels)
+  {
+    const RcsBody* chBdy = RcsGraph_getBodyByName(graph, ch.c_str());
 
-  RLOG(0, "Done task replacement");
+    if (!chBdy)
+    {
+      continue;
+    }
+
+    bool found = false;
+    for (const RcsBody* frame : frames)
+    {
+      for (int id = frame ? frame->id : -1; id != -1; id = graph->bodies[id].parentId)
+      {
+        if (id == chBdy->id)
+        {
+          found = true;
+          break;
+        }
+      }
+
+      if (found)
+      {
+        break;
+      }
+    }
+
+    if (found)
+    {
+      taskChannels.push_back(ch);
+    }
+  }
+
+  return taskChannels.empty() ? channels : taskChannels;
 }
 
 void TrajectoryComponent::onResetAnimationTic()
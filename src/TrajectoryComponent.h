@@ -38,6 +38,10 @@
 #include "ComponentBase.h"
 #include "TrajectoryPredictor.h"
 
+#include <atomic>
+#include <map>
+#include <memory>
+
 
 
 namespace aff
@@ -51,6 +55,10 @@ namespace aff
  *                             for stopped)
  *         - SetBlending: Current blending value, published in each
  *                        trajectory step.
+ *         - TrajectoryOverlap: Published once per motion when the remaining
+ *                              motion time falls below the overlap time
+ *                              (see setOverlapTime()). The argument is the
+ *                              remaining time.
  *
  *         The class subscribes to the following events:
  *         - ClearTrajectory
@@ -65,6 +73,21 @@ namespace aff
  *         - ComputeTrajectory: Steps the trajectory with the entitie's time
  *                              step.
  *         - SetTrajectory: Applies the published constraints to the trajectory.
+ *         - SetTrajectoryRevalidation: Sets the period (in seconds) in which
+ *                                      the executing trajectory is re-checked
+ *                                      against the current state. 0 disables
+ *                                      it.
+ *
+ *         While a trajectory is executed, it can be re-validated periodically.
+ *         The remaining part is predicted in a background thread, starting
+ *         from the graph passed to ComputeTrajectory. This graph carries the
+ *         latest perception updates. If the prediction fails, a
+ *         TrajectoryWarning event is published with the failure message
+ *         (ExampleActionsECS shows it in the HUD, ExampleLLMSim also sends it
+ *         to the websocket client). If
+ *         stopOnFailure is set, the trajectory is also cleared and a failed
+ *         ActionResult is published so that the action can be re-planned.
+ *         Only one re-validation runs at a time.
  *
  *  \todo: Re-think publishing SetBlending event in each step.
  */
@@ -114,6 +137,37 @@ public:
 
   const tropic::TrajectoryControllerBase* getTrajectoryController() const;
 
+  /*! \brief Returns the number of body name comparisons done through the
+   *         BodyIndexCache in the thread of the trajectory steps between
+   *         the last two steps. It should be 0 while no new trajectory is
+   *         applied.
+   */
+  size_t getStringComparesPerStep() const;
+
+  /*! \brief Enables the periodic re-validation of the executing trajectory.
+   *
+   * \param[in] period        Minimum time in seconds (entity time) between
+   *                          the start of two re-validations. 0 disables it.
+   * \param[in] stopOnFailure If true, the trajectory is cleared if the
+   *                          re-validation fails. Otherwise, only a warning
+   *                          is published.
+   */
+  void setRevalidation(double period, bool stopOnFailure=true);
+
+  /*! \brief Sets the time before the end of a motion at which the next
+   *         trajectory may be merged into the moving one. If it is larger
+   *         than 0, a ChangeTaskVector event during a motion only replaces
+   *         the tasks of the given manipulators, and the incoming trajectory
+   *         is checked together with the remainder of the moving one. 0
+   *         disables it (default).
+   */
+  void setOverlapTime(double overlapTime);
+
+  /*! \brief Returns the fraction of wall-clock time spent in re-validations
+   *         since they have been enabled.
+   */
+  double getRevalidationLoad() const;
+
 private:
 
   void stepTrajectory(RcsGraph* from);
@@ -129,19 +183,35 @@ private:
                                   std::vector<std::string> channels);
   void onTaskVectorChangeSequential(std::vector<std::string> taskVec,
                                     std::vector<std::string> channels);
+  void onTaskVectorChange(std::vector<std::string> taskVec,
+                          std::vector<std::string> channels);
+  bool isBlending() const;
+  static bool replaceChannelTasks(tropic::TrajectoryControllerBase* tc,
+                                  std::map<std::string, std::vector<std::string>>& effectorTaskMap,
+                                  const std::vector<std::string>& taskVec,
+                                  const std::vector<std::string>& channels);
+  static std::vector<std::string> getTaskChannels(const Rcs::Task* task,
+                                                  const std::vector<std::string>& channels);
   void onRender();
   void onStop();
   void onPrint();
   void onResetAnimationTic();
+  void onSetRevalidationPeriod(double period);
+  void startRevalidation(const RcsGraph* state);
+  void revalidationThread(std::shared_ptr<TrajectoryPredictor> predictor,
+                          size_t trajectoryId);
 
   void checkerThread(tropic::TCS_sptr tSet, bool simulateOnly,
                      std::shared_ptr<TrajectoryPredictor> predictor);
 
 
   tropic::TrajectoryControllerBase* tc;
+  EventHandle<double>* setBlendingEvent;
+  EventHandle<double>* setPhaseEvent;
   double motionEndTime;
   double lastMotionEndTime;
   double motionDuration;
+  double overlapTime;
   MatNd* a_des;
   MatNd* x_des;
 
@@ -153,11 +223,34 @@ private:
   bool enableTrajectoryCheck;
   bool enableDbgRendering;
   bool eStop;
+  size_t stringCompares;
+  size_t lastStringCompares;   // Counter of the stepping thread at last step
 
   std::mutex checkerThreadMtx;
 
+  // Re-validation of the executing trajectory
+  std::mutex revalidationMtx;
+  std::atomic<size_t> trajectoryId;   // Incremented for each change
+  std::atomic<bool> revalidationRunning;
+  double revalidationPeriod;
+  double lastRevalidation;
+  bool stopOnRevalidationFailure;
+  std::atomic<size_t> numRevalidations;
+  std::atomic<double> revalidationTime;   // Accumulated wall-clock time
+  double revalidationStartTime;           // Of enabling it
+
   std::map<std::string, std::vector<std::string>> effectorTaskMap;
 
+  // Task vectors of trajectories that are blended into the moving one. They
+  // are applied once their trajectory has passed the check.
+  struct TaskVectorChange
+  {
+    std::vector<std::string> taskVec;
+    std::vector<std::string> channels;
+  };
+  std::unique_ptr<TaskVectorChange> pendingTaskVector;   // Awaiting its trajectory
+  std::map<const tropic::ConstraintSet*, TaskVectorChange> blendedTaskVectors;
+
   TrajectoryComponent(const TrajectoryComponent&);
   TrajectoryComponent& operator=(const TrajectoryComponent&);
 };
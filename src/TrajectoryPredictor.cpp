@@ -31,6 +31,7 @@
 *******************************************************************************/
 
 #include "TrajectoryPredictor.h"
+#include "BodyIndexCache.h"
 
 #include <IkSolverConstraintRMR.h>
 #include <Rcs_typedef.h>
@@ -55,6 +56,30 @@ using namespace tropic;
 namespace aff
 {
 
+// Bodies used in the null space gradients. The predictions run in parallel
+// threads on their own graphs, therefore each thread has its own cache.
+enum NullspaceBody
+{
+  BaseFootprint = 0,
+  UpperarmLeft,
+  UpperarmRight,
+  ForearmLeft,
+  ForearmRight,
+  HandLeft,
+  HandRight,
+  NumNullspaceBodies
+};
+
+static void getNullspaceBodies(const RcsGraph* graph,
+                               const RcsBody* bodies[NumNullspaceBodies])
+{
+  static thread_local BodyIndexCache cache({"base_footprint",
+                                            "upperarm_left", "upperarm_right",
+                                            "forearm_left", "forearm_right",
+                                            "hand_left", "hand_right"});
+  cache.getBodies(graph, bodies);
+}
+
 TrajectoryPredictor::TrajectoryPredictor(const TrajectoryControllerBase* tc_) :
   tc(NULL), ikSolver(NULL), predSteps(0), tStack(NULL)
 {
@@ -423,6 +448,11 @@ void TrajectoryPredictor::setTrajectory(TCS_sptr tSet)
   tc->addAndApply(std::shared_ptr<ConstraintSet>(tSet->clone()));
 }
 
+void TrajectoryPredictor::addTrajectory(TCS_sptr tSet)
+{
+  tc->addAndApply(std::shared_ptr<ConstraintSet>(tSet->clone()));
+}
+
 bool TrajectoryPredictor::check(bool jointLimitCheck, bool collisionCheck,
                                 bool speedLimitCheck) const
 {
@@ -456,11 +486,13 @@ void TrajectoryPredictor::addElbowNullspace(const RcsGraph* graph, MatNd* dH)
   MatNd* J = MatNd_create(1, graph->nJ);
 
   // These we need: s: shoulder, b: base (HTr_invTransform(A_sb, A_bI, A_sI))
-  const RcsBody* base = RcsGraph_getBodyByName(graph, "base_footprint");
-  const RcsBody* left_elbow = RcsGraph_getBodyByName(graph, "forearm_left");
-  const RcsBody* right_elbow = RcsGraph_getBodyByName(graph, "forearm_right");
-  const RcsBody* sh_left = RcsGraph_getBodyByName(graph, "upperarm_left");
-  const RcsBody* sh_right = RcsGraph_getBodyByName(graph, "upperarm_right");
+  const RcsBody* bodies[NumNullspaceBodies];
+  getNullspaceBodies(graph, bodies);
+  const RcsBody* base = bodies[BaseFootprint];
+  const RcsBody* left_elbow = bodies[ForearmLeft];
+  const RcsBody* right_elbow = bodies[ForearmRight];
+  const RcsBody* sh_left = bodies[UpperarmLeft];
+  const RcsBody* sh_right = bodies[UpperarmRight];
 
   // Left elbow
   if (base && left_elbow && sh_left)
@@ -489,8 +521,8 @@ void TrajectoryPredictor::addElbowNullspace(const RcsGraph* graph, MatNd* dH)
   }
 
 #if 1
-  left_elbow = RcsGraph_getBodyByName(graph, "hand_left");
-  right_elbow = RcsGraph_getBodyByName(graph, "hand_right");
+  left_elbow = bodies[HandLeft];
+  right_elbow = bodies[HandRight];
   boundary = 0.0;
 
   // Left wrist
@@ -537,9 +569,11 @@ void TrajectoryPredictor::addWristNullspace(const RcsGraph* graph, MatNd* dH)
   HTr A_WB;   // From base to wrist
 
   // These we need
-  const RcsBody* left_wrist = RcsGraph_getBodyByName(graph, "hand_left");
-  const RcsBody* right_wrist = RcsGraph_getBodyByName(graph, "hand_right");
-  const RcsBody* base = RcsGraph_getBodyByName(graph, "base_footprint");
+  const RcsBody* bodies[NumNullspaceBodies];
+  getNullspaceBodies(graph, bodies);
+  const RcsBody* left_wrist = bodies[HandLeft];
+  const RcsBody* right_wrist = bodies[HandRight];
+  const RcsBody* base = bodies[BaseFootprint];
 
 
   // Left arm, A_WB.org is the vector to the wrist, represented in the base frame.
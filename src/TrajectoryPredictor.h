@@ -137,6 +137,12 @@ public:
    */
   void setTrajectory(tropic::TCS_sptr tSet);
 
+  /*! \brief Adds a deep copy of tSet to the class's internal trajectory
+   *         controller without clearing the trajectories that are already
+   *         there.
+   */
+  void addTrajectory(tropic::TCS_sptr tSet);
+
   PredictionResult predict(double dt);
   void getPredictionArray(MatNd* tPred) const;
   bool check(bool jointLimits=true, bool collisions=true,
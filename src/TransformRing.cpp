@@ -0,0 +1,116 @@
+/*******************************************************************************
+
+  Copyright (c) Honda Research Institute Europe GmbH.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+  IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT,
+  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+  OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+#include "TransformRing.h"
+
+#include <Rcs_macros.h>
+
+#include <algorithm>
+
+
+namespace aff
+{
+
+TransformRing::TransformRing() :
+  back(0), front(1), latest(2), numWritten(0), numStale(0)
+{
+}
+
+void TransformRing::write(const RcsGraph* graph)
+{
+  Slot& slot = slots[back];
+  slot.A_BI.resize(graph->nBodies);
+  slot.q.resize(graph->dof);
+
+  for (unsigned int i=0; i<graph->nBodies; ++i)
+  {
+    slot.A_BI[i] = graph->bodies[i].A_BI;
+  }
+
+  std::copy(graph->q->ele, graph->q->ele + graph->dof, slot.q.begin());
+
+  // Release our writes, and acquire the reader's last use of the slot that
+  // becomes our back buffer.
+  const unsigned int prev = latest.exchange(back | FreshBit,
+                                            std::memory_order_acq_rel);
+  back = prev & ~FreshBit;
+  numWritten++;
+
+  if (prev & FreshBit)
+  {
+    numStale++;
+  }
+}
+
+bool TransformRing::read(RcsGraph* graph)
+{
+  if (!(latest.load(std::memory_order_relaxed) & FreshBit))
+  {
+    return false;
+  }
+
+  front = latest.exchange(front, std::memory_order_acq_rel) & ~FreshBit;
+
+  const Slot& slot = slots[front];
+  const bool sizesMatch = (slot.A_BI.size() == graph->nBodies) &&
+                          (slot.q.size() == graph->dof);
+
+  if (sizesMatch)
+  {
+    for (unsigned int i=0; i<graph->nBodies; ++i)
+    {
+      graph->bodies[i].A_BI = slot.A_BI[i];
+    }
+
+    std::copy(slot.q.begin(), slot.q.end(), graph->q->ele);
+  }
+  else
+  {
+    RLOG(4, "Graph size changed: %zu bodies and %zu dof instead of %u and %u",
+         slot.A_BI.size(), slot.q.size(), graph->nBodies, graph->dof);
+  }
+
+  return sizesMatch;
+}
+
+size_t TransformRing::getNumWritten() const
+{
+  return numWritten;
+}
+
+size_t TransformRing::getNumStale() const
+{
+  return numStale;
+}
+
+}   // namespace aff
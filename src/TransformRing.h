@@ -0,0 +1,108 @@
+/*******************************************************************************
+
+  Copyright (c) Honda Research Institute Europe GmbH.
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are met:
+
+  1. Redistributions of source code must retain the above copyright notice,
+     this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright notice,
+     this list of conditions and the following disclaimer in the documentation
+     and/or other materials provided with the distribution.
+
+  3. Neither the name of the copyright holder nor the names of its
+     contributors may be used to endorse or promote products derived from
+     this software without specific prior written permission.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDER "AS IS" AND ANY EXPRESS OR
+  IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+  OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+  IN NO EVENT SHALL THE COPYRIGHT HOLDER BE LIABLE FOR ANY DIRECT, INDIRECT,
+  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+  OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+  NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+  EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+#ifndef AFF_TRANSFORMRING_H
+#define AFF_TRANSFORMRING_H
+
+#include <Rcs_graph.h>
+
+#include <atomic>
+#include <vector>
+
+
+namespace aff
+{
+
+/*! \brief Lock-free triple buffer of body transforms with a single producer
+ *         and a single consumer. The control loop writes the transforms and
+ *         joint angles of a graph, and the render thread applies the newest
+ *         of them to its own copy of the graph. The producer never waits:
+ *         It writes into its back buffer and swaps it with the latest one.
+ *         A snapshot that the render thread did not get to is overwritten
+ *         by the next one.
+ *
+ *         The buffers are only reallocated if the graph's size changes, so
+ *         that writing is a plain copy in the steady state.
+ */
+class TransformRing
+{
+public:
+
+  TransformRing();
+
+  /*! \brief Copies the state of the graph into the back buffer and makes it
+   *         the newest snapshot. Must only be called from one thread at a
+   *         time.
+   */
+  void write(const RcsGraph* graph);
+
+  /*! \brief Copies the newest state into the graph. Returns false if nothing
+   *         has been written since the last call, or if the written graph
+   *         has a different number of bodies or dofs. Must only be called
+   *         from one thread at a time.
+   */
+  bool read(RcsGraph* graph);
+
+  /*! \brief Statistics since construction: Number of written snapshots, and
+   *         snapshots that have been overwritten before read() got them.
+   */
+  size_t getNumWritten() const;
+  size_t getNumStale() const;
+
+private:
+
+  TransformRing(const TransformRing&) = delete;
+  TransformRing& operator=(const TransformRing&) = delete;
+
+  struct Slot
+  {
+    std::vector<HTr> A_BI;
+    std::vector<double> q;
+  };
+
+  // The index of the latest slot is or'ed with FreshBit until it is read
+  static const unsigned int FreshBit = 4;
+
+  Slot slots[3];
+  unsigned int back;    // Only used by the writer
+  unsigned int front;   // Only used by the reader
+
+  // On separate cache lines, since they are written by different threads
+  alignas(64) std::atomic<unsigned int> latest;
+  alignas(64) std::atomic<size_t> numWritten;
+  std::atomic<size_t> numStale;
+};
+
+}   // namespace aff
+
+#endif // AFF_TRANSFORMRING_H